@@ -0,0 +1,72 @@
+#pragma once
+// access_table.h - Tabla de decisión de acceso residente en RAM: UID -> rol y materias.
+//
+// En cada tarjeta el acceso normal necesita saber si el UID es alumno y/o
+// maestro y qué materias tiene. Antes se leían sus filas de USERS_FILE y
+// TEACHERS_FILE, se normalizaban los nombres y, para maestros, se recorría
+// además loadCourses(). Aquí se precalcula por UID:
+//   - alumno:  IDs de materia (catalog.h) de sus filas de USERS_FILE
+//   - maestro: IDs de materia de sus filas de TEACHERS_FILE más las de los
+//              cursos donde figura su nombre; y el ID de profesor de ese nombre
+// Las materias quedan en orden de alta (mats[0] es la que se registra fuera de
+// horario, como antes) y son pocas, así que la pertenencia es un recorrido corto.
+// Con la materia en curso (schedule_table.h) conceder o denegar son dos
+// búsquedas en RAM, sin abrir archivos.
+//
+// La clave es el UID en 64 bits (UidKey::hash(), uid_key.h): el núcleo de acceso
+// busca con los bytes leídos de la tarjeta, sin pasarlos a texto. Cada entrada
+// guarda además el UidKey completo y sólo se acepta si coincide: los UID de 8 a
+// 10 bytes usan un hash y dos tarjetas distintas podrían compartir la clave. Se guarda el nombre (lo muestra la pantalla al
+// decidir); la cuenta se lee de la fila del UID vía uid_index.h sólo para
+// escribir el registro.
+//
+// Se mantiene desde files_utils.cpp (filas añadidas: incremental; reescrituras)
+// y row_log.cpp (bajas/ediciones); éstas y los cambios de cursos marcan la tabla
+// para reconstruirla en accessTableLoop() (o en la siguiente consulta).
+//
+// El núcleo de acceso no comparte estas estructuras con el web: los cambios se
+// hacen sobre una copia de trabajo y accessTableLoop() publica una AccessView
+// inmutable (std::atomic_store de un shared_ptr) con alumnos, maestros y los
+// nombres de materia. accessTableView() la toma sin bloquear; la vista anterior
+// se libera cuando la suelta el último que la usa.
+
+#include <Arduino.h>
+#include <vector>
+#include <memory>
+#include "catalog.h"
+#include "uid_key.h"
+
+struct AccessEntry {
+  uint64_t key;                    // UidKey::hash() (orden de la tabla)
+  UidKey uid;                      // UID completo: se compara al encontrar la clave
+  CatalogId profesorId;            // maestros: ID de profesor de su nombre
+  std::vector<CatalogId> mats;     // en orden de alta, sin repetir
+  String name;                     // de su primera fila
+};
+
+struct AccessView {
+  std::vector<AccessEntry> students;   // ordenados por clave
+  std::vector<AccessEntry> teachers;
+  std::vector<String> materias;        // nombre por CatalogId (índice id - 1)
+  uint32_t generation = 0;             // sube con cada publicación
+
+  const AccessEntry *findStudent(const UidKey &uid) const;   // nullptr si no es alumno
+  const AccessEntry *findTeacher(const UidKey &uid) const;
+  const String &materiaName(CatalogId id) const;             // "" si no la conoce
+};
+
+void accessTableBegin();                                   // tras uidIndexBuild() y catalogBegin()
+void accessTableLoop();                                    // núcleo web: reconstruye y publica
+std::shared_ptr<const AccessView> accessTableView();       // última vista publicada (cualquier núcleo)
+
+// Hooks de files_utils.cpp / row_log.cpp
+void accessTableNoteRow(const char *path, const String &line);   // fila añadida
+void accessTableReset(const char *path);                         // reescritura o baja
+
+// Consultas del núcleo web (copia de trabajo, incluye lo aún no publicado)
+const AccessEntry *accessFindStudent(const UidKey &uid);   // nullptr si no es alumno
+const AccessEntry *accessFindTeacher(const UidKey &uid);   // nullptr si no es maestro
+bool accessHasMateria(const AccessEntry *e, CatalogId materiaId);
+
+size_t accessTableSize();                                  // alumnos + maestros (para /status)
+size_t accessTableRamBytes();
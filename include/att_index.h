@@ -0,0 +1,40 @@
+#pragma once
+// att_index.h - Índices secundarios (postings) del historial de asistencia.
+//
+// Los postings van en un número fijo de buckets: 64 para UIDs
+// ("/att/ix/uNN.csv", UidKey::hash() & 63) y 16 para materias ("/att/ix/mNN.csv",
+// id & 15), con una fila "day","offset","key" por registro: el segmento diario,
+// la posición de la fila dentro de él y la clave (hash del UID en hex o id de
+// materia). att_store los alimenta al escribir cada lote (un append por bucket y
+// lote), así que filtrar el historial por uid= o materia= lee sólo un bucket y
+// salta con seek() a cada fila de esa clave, en lugar de recorrer y partir todas
+// las filas de todos los días. El número de archivos no crece con los UIDs.
+//
+// attIndexForUid() compara el UID completo de la fila antes de entregarla (la
+// clave es un hash para UIDs largos). Un registro indexado dos veces
+// (re-indexado tras un corte) se descarta porque los offsets de un día sólo
+// crecen. Borrar historial no reescribe los buckets: los días sin segmento se
+// saltan al leer y un bucket sólo se recorta cuando lo muerto es la mitad.
+// Si falta el índice (primer arranque con esta versión o formato anterior de un
+// archivo por clave) se construye desde los segmentos; attIndexRebuild() lo
+// rehace a petición.
+
+#include <Arduino.h>
+#include <vector>
+#include <functional>
+#include "csv_reader.h"
+
+// Llamadas desde att_store.cpp
+void attIndexBegin();                                     // tras cargar el manifiesto
+void attIndexNoteLines(const std::vector<String> &lines, const std::vector<String> &days,
+                       const std::vector<uint32_t> &offsets);   // filas ya escritas
+void attIndexSegmentFrom(const String &day, uint32_t fromOffset); // re-indexar la cola de un segmento
+void attIndexDropBefore(const String &day);
+void attIndexClear();
+
+uint32_t attIndexRebuild();                               // recorre todos los segmentos
+
+// Filas del historial de un UID / materia, en orden de archivo, limitadas a los
+// días que cubre 'tsPrefix' (mismo criterio que attSegmentPathsFor).
+void attIndexForUid(const String &uid, const String &tsPrefix, const std::function<void(CsvReader &)> &fn);
+void attIndexForMateria(const String &materia, const String &tsPrefix, const std::function<void(CsvReader &)> &fn);
@@ -0,0 +1,45 @@
+#pragma once
+// att_rollup.h - Resumen incremental del historial de asistencia.
+//
+// Contadores que se actualizan con cada registro de attendance (att_store los
+// alimenta al escribir cada lote) para no recorrer los segmentos en cada consulta:
+//   - por día y materia: registros y alumnos distintos (sesión = materia en ese día;
+//     las entradas "entrada-teacher" cuentan como registro pero no como alumno)
+//   - por UID (clave de uid_key.h): registros totales en el historial conservado
+// Cada día se guarda en "/att/roll-YYYY-MM-DD.csv": sus filas día/materia y sus
+// registros por UID. Sólo cambia el día que recibe registros, así que guardar
+// (junto con el manifiesto, misma persistencia diferida, o al pasar a otro día)
+// reescribe un archivo pequeño; al borrar historial se descuentan los totales
+// con los archivos de esos días y se eliminan. Al arrancar se suman los archivos
+// y se comparan los registros por día con el manifiesto; si no cuadran (corte
+// antes de guardar) se reconstruye desde los segmentos. attRollupRebuild() hace
+// lo mismo a petición (/history_rollup_rebuild).
+//
+// Los alumnos distintos necesitan el conjunto de UIDs de la sesión: sólo se
+// mantiene en RAM el del día que está recibiendo registros (se rellena leyendo
+// ese segmento la primera vez que hace falta).
+
+#include <Arduino.h>
+#include <vector>
+#include "catalog.h"
+
+struct AttDayCount {
+  String day;             // YYYY-MM-DD
+  CatalogId materiaId;    // 0 = sin materia
+  uint32_t records;
+  uint16_t students;      // UIDs distintos (sin maestros)
+};
+
+// Llamadas desde att_store.cpp
+void attRollupBegin();                                           // tras cargar el manifiesto
+void attRollupNoteLines(const std::vector<String> &lines, const std::vector<String> &days); // ya escritas, antes de actualizar el manifiesto
+void attRollupDropBefore(const String &day);                     // antes de borrar esos segmentos
+void attRollupClear();
+void attRollupSave();                                            // si cambió (con el manifiesto)
+
+uint32_t attRollupRebuild();                                     // recorre todos los segmentos; devuelve registros
+
+std::vector<AttDayCount> attRollupForMateria(CatalogId materiaId); // ordenados por día
+uint32_t attRollupUidTotal(const String &uid);                   // por uidKeyHash(uid)
+size_t attRollupRows();                                          // filas día/materia (para /status)
+size_t attRollupUids();
@@ -0,0 +1,43 @@
+#pragma once
+// att_store.h - Historial de asistencia segmentado por día + manifiesto.
+//
+// En lugar de un único ATT_FILE creciente, cada día se guarda en su propio
+// segmento "/att/YYYY-MM-DD.csv" (con la cabecera de attendance). El manifiesto
+// "/att/manifest.csv" ("day","first_ts","last_ts","records","bytes") permite:
+//   - abrir sólo los segmentos de la fecha filtrada,
+//   - borrar/archivar historial viejo eliminando segmentos (sin reescrituras).
+// El manifiesto vive en RAM; se persiste al crear/borrar segmentos y de forma
+// diferida (attStoreLoop / reinicio). En el arranque se revalidan los segmentos
+// recientes contra su tamaño real por si hubo un corte antes de persistir.
+// ATT_FILE se conserva sólo como nombre lógico (appendLineToFile / descargas).
+// Los contadores por día/materia/UID (att_rollup.h) y los índices por UID/materia
+// (att_index.h) se mantienen desde aquí.
+
+#include <Arduino.h>
+#include <vector>
+
+struct AttSegment {
+  String day;       // YYYY-MM-DD
+  String firstTs;
+  String lastTs;
+  uint32_t records;
+  uint32_t bytes;
+};
+
+void attStoreBegin();                                   // carga manifiesto y migra ATT_FILE legado
+void attStoreLoop();                                    // persiste el manifiesto si cambió (diferido)
+void attStoreSaveManifest();                            // persiste ahora (reinicio)
+// Usado por log_writer al vaciar. false si alguna fila no se escribió (segmento
+// sin abrir, flash llena); 'failed' recibe sus índices para que sigan en la cola.
+bool attStoreAppendLines(const std::vector<String> &lines, std::vector<size_t> *failed = nullptr);
+
+const std::vector<AttSegment> &attSegments();           // ordenados por día
+String attSegmentPath(const String &day);
+bool attHasSegment(const String &day);
+// Rutas de segmentos cuyo día coincide con el prefijo de timestamp
+// ("" = todos, "2025-03" = mes, "2025-03-14" o más largo = ese día).
+std::vector<String> attSegmentPathsFor(const String &tsPrefix);
+
+void attStoreClear();                                   // borra todo el historial
+int attStoreDropBefore(const String &day);              // borra segmentos con día < 'day'; devuelve cuántos
+uint32_t attRecordCount();
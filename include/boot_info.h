@@ -0,0 +1,21 @@
+#pragma once
+// boot_info.h - Hitos del arranque por etapas (millis() desde el arranque; 0 = aún no).
+//
+// setup() levanta primero lo que necesita la puerta (SPIFFS, índices, lector,
+// pantalla, cerradura) y marca "acceso listo"; WiFi, NTP y el servidor web
+// arrancan después en segundo plano (tarea de red en el núcleo web). Las
+// lecturas anteriores a tener hora esperan en UNDATED_FILE con su millis() y se
+// registran con fecha cuando NTP sincroniza (ver rfidEventsLoop). /status
+// muestra los hitos.
+
+#include <Arduino.h>
+
+void bootMarkAccessReady();
+void bootMarkNetReady();
+void bootMarkTimeSynced();
+void bootMarkFirstTap();               // primera tarjeta decidida (núcleo de acceso)
+
+uint32_t bootAccessReadyMs();
+uint32_t bootNetReadyMs();
+uint32_t bootTimeSyncedMs();
+uint32_t bootFirstTapMs();
@@ -0,0 +1,47 @@
+#pragma once
+// card_journal.h - Lecturas decididas pendientes de registrar, en memoria RTC.
+//
+// El núcleo de acceso decide, abre y muestra; los registros (ATT_FILE,
+// DENIED_FILE, notificaciones) los escribe después el núcleo web. Entre una
+// cosa y otra la lectura vive en este anillo de un productor (núcleo de acceso)
+// y un consumidor (núcleo web), que está en RTC_NOINIT: sobrevive a un reinicio
+// por software, pánico o watchdog (no a un corte de alimentación).
+//   - cardJournalPush(): el núcleo de acceso deja la decisión (no bloquea).
+//   - cardJournalNext(): el núcleo web la toma y la registra vía log_writer.
+//   - cardJournalCommit(): cuando log_writer ya no tiene nada en RAM (lo vacía a
+//     lo sumo LOG_FLUSH_MS después), lo leído está en flash y las casillas se
+//     liberan. También al reiniciar, tras vaciar log_writer.
+// Al arrancar tras un reinicio suave lo no liberado se vuelve a entregar (y se
+// registra con la hora de la lectura). Un corte justo entre el vaciado y la
+// liberación puede repetir un registro: se prefiere a perderlo.
+
+#include <Arduino.h>
+#include "catalog.h"
+#include "uid_key.h"
+
+enum CardEventKind : uint8_t {
+  CARD_CAPTURE,          // modo captura / auto-registro: lo procesa entero el núcleo web
+  CARD_GRANTED,
+  CARD_DENIED_UNKNOWN,   // UID sin alumno ni maestro
+  CARD_DENIED_MATERIA,   // tiene materias, pero no la que está en curso
+  CARD_DENIED_NO_MATS,   // sin materias asignadas
+};
+
+struct CardEvent {
+  uint8_t kind;
+  bool teacher;
+  bool inSchedule;       // había clase en curso
+  CatalogId materiaId;   // concedido: materia registrada; denegado por materia: la que está en curso
+  UidKey uid;
+  uint32_t atMs;         // millis() de la lectura
+  uint32_t at;           // epoch de la lectura; 0 = sin hora (se fecha después con atMs)
+};
+
+void cardJournalBegin();                        // setup, antes de la tarea del lector
+bool cardJournalPush(const CardEvent &ev);      // núcleo de acceso; false si está lleno
+bool cardJournalNext(CardEvent &ev, bool &replayed);  // núcleo web; replayed = de antes del reinicio
+void cardJournalCommit();                       // núcleo web: lo entregado ya está en flash
+
+uint32_t cardJournalPending();                  // entregadas o no, aún sin liberar
+uint32_t cardJournalReplayed();                 // recuperadas al arrancar
+uint32_t cardJournalDrops();                    // descartadas con el anillo lleno
@@ -0,0 +1,43 @@
+#pragma once
+// catalog.h - Diccionario de materias, profesores y cursos con IDs enteros.
+//
+// Cada materia, profesor y curso (par materia+profesor, la antigua clave
+// "Materia||Profesor") recibe un ID pequeño y estable (1..65535; 0 = ninguno).
+// La tabla se guarda en /catalog.csv (sólo se añaden filas) y se carga al
+// arrancar, así que un ID no cambia entre reinicios.
+//
+// Los nombres se comparan sin espacios extremos y sin distinguir mayúsculas
+// (misma regla que usaba el acceso RFID con lowerCopy()); el nombre mostrado
+// es el de la primera vez que se registró.
+//
+// Los CSV (users/teachers/schedules/courses) conservan los nombres para que
+// las exportaciones y los datos existentes sigan siendo legibles; los IDs se
+// resuelven al cargar (loadCourses/loadSchedules rellenan Course/ScheduleEntry)
+// y el acceso y los filtros web comparan enteros.
+
+#include <Arduino.h>
+
+typedef uint16_t CatalogId;
+
+void catalogBegin();                                         // tras initFiles()
+
+// Búsqueda sin crear (0 si no existe). La versión (ptr,len) no reserva memoria.
+CatalogId catalogFindMateria(const char *name, size_t len);
+CatalogId catalogFindMateria(const String &name);
+CatalogId catalogFindProfesor(const char *name, size_t len);
+CatalogId catalogFindProfesor(const String &name);
+CatalogId catalogFindCourse(CatalogId materiaId, CatalogId profesorId);
+
+// Búsqueda creando la entrada si falta (nombre vacío -> 0).
+CatalogId catalogMateriaId(const String &name);
+CatalogId catalogProfesorId(const String &name);
+CatalogId catalogCourseId(CatalogId materiaId, CatalogId profesorId);
+
+// Dueño de un horario: "Materia" o "Materia||Profesor" (profesorId = 0 si no lo trae).
+void catalogParseOwner(const String &owner, CatalogId &materiaId, CatalogId &profesorId);
+
+const String &catalogMateriaName(CatalogId id);              // "" si no existe
+const String &catalogProfesorName(CatalogId id);
+size_t catalogMateriaCount();                                // IDs de materia: 1..count
+
+size_t catalogSize();                                        // entradas (para /status)
@@ -26,11 +26,24 @@ extern const char* NOTIF_FILE;
 extern const char* COURSES_FILE;
 extern const char* TEACHERS_FILE;       // <- agregado
 extern const char* CAPTURE_QUEUE_FILE;  // <- agregado (usado por rfid_handler batch capture)
+extern const char* UNDATED_FILE;        // lecturas sin hora esperando NTP (rfid_handler)
 
 // --- Timings ---
 extern const unsigned long DISPLAY_MS;
 extern const unsigned long POLL_INTERVAL;
 extern const unsigned long CAPTURE_DEBOUNCE_MS;
+extern const unsigned long REPEAT_TAP_WINDOW_MS;   // misma tarjeta y sesión: sin otro registro
+
+// --- Puerta (door.h) ---
+extern const unsigned long DOOR_HOLD_MS;     // abierta tras el último acceso concedido
+extern const unsigned long DOOR_TRAVEL_MS;   // recorrido del servo al abrir/cerrar
+extern const int DOOR_OPEN_ANGLE;
+extern const int DOOR_CLOSED_ANGLE;
+
+// --- Núcleos (ESP32): loop() queda como núcleo de acceso ---
+extern const int WEB_CORE;                   // servidor HTTP y escrituras al SPIFFS (junto a WiFi)
+extern const uint32_t WEB_TASK_STACK;
+extern const uint32_t NET_TASK_STACK;         // WiFi + NTP + server.begin() al arrancar
 
 // --- Horarios / grilla ---
 extern const String DAYS[6];         // {"LUN","MAR","MIE","JUE","VIE","SAB"}
@@ -0,0 +1,109 @@
+#pragma once
+// csv_reader.h - Lectura de CSV (campos entre comillas) sin reservar memoria.
+//
+// Sustituye al antiguo patrón readStringUntil('\n') + trim() + parseQuotedCSVLine(),
+// que creaba un String por línea y un std::vector<String> por fila. CsvReader
+// lee el File por bloques a un búfer fijo y entrega vistas (puntero+longitud)
+// a cada campo; sólo se copia a String lo que se va a conservar o mostrar.
+//
+//   File f = SPIFFS.open(USERS_FILE, FILE_READ);
+//   CsvReader r(f);                     // salta la cabecera
+//   while (r.next()) {
+//     if (r.size() < 4 || !r[USERS_MATERIA].equals(materia)) continue;
+//     String name = r.str(USERS_NAME);
+//   }
+//
+// Mismas reglas que el parseo anterior: un campo va de comilla a comilla; sin
+// comilla de cierre se toma el resto de la línea. Las líneas en blanco se saltan.
+// Una línea más larga que CSV_LINE_MAX se trunca para los campos (truncated()),
+// pero lineString() la devuelve completa releyéndola del archivo.
+// Recién construido con skipHeader, line()/lineString() devuelven la cabecera
+// (útil al reescribir el archivo con writeAllLines).
+// Las filas borradas con row_log (lápidas) se saltan de forma transparente.
+
+#include <Arduino.h>
+#include <FS.h>
+#include <string.h>
+#include <vector>
+
+static const size_t CSV_LINE_MAX = 512;   // bytes por línea en el búfer
+static const size_t CSV_MAX_FIELDS = 8;   // el esquema más ancho (attendance) tiene 6
+static const size_t CSV_CHUNK = 128;      // lectura por bloques del File
+
+// Columnas de cada esquema (users y teachers comparten columnas).
+enum UsersCol   { USERS_UID = 0, USERS_NAME, USERS_ACCOUNT, USERS_MATERIA, USERS_CREATED };
+enum AttCol     { ATT_TS = 0, ATT_UID, ATT_NAME, ATT_ACCOUNT, ATT_MATERIA, ATT_MODE };
+enum DeniedCol  { DENIED_TS = 0, DENIED_UID, DENIED_NOTE };
+enum SchedCol   { SCHED_MATERIA = 0, SCHED_DAY, SCHED_START, SCHED_END };
+enum CoursesCol { COURSES_MATERIA = 0, COURSES_PROFESOR, COURSES_CREATED };
+enum NotifCol   { NOTIF_TS = 0, NOTIF_UID, NOTIF_NAME, NOTIF_ACCOUNT, NOTIF_NOTE, NOTIF_SEQ };
+
+// Vista de un campo (no es dueña de la memoria; válida hasta la siguiente fila).
+struct CsvField {
+  const char *ptr;
+  size_t len;
+
+  bool empty() const { return len == 0; }
+  bool equals(const char *s) const;
+  bool equals(const String &s) const { return len == s.length() && memcmp(ptr, s.c_str(), len) == 0; }
+  bool equalsIgnoreCase(const String &s) const;
+  bool startsWith(const String &prefix) const { return len >= prefix.length() && memcmp(ptr, prefix.c_str(), prefix.length()) == 0; }
+  bool containsIgnoreCase(const String &needle) const;  // como toLowerCase()+indexOf() != -1
+  CsvField trimmed() const;                             // sin espacios al inicio/fin
+  long toInt() const;
+  String toString() const;
+};
+
+// Campos de una línea ya en memoria (p. ej. filas devueltas por uid_index).
+// 'line' debe seguir vivo mientras se usen los campos.
+class CsvFields {
+public:
+  size_t split(const char *line, size_t len);
+  size_t split(const String &line) { return split(line.c_str(), line.length()); }
+  size_t size() const { return _count; }
+  CsvField operator[](size_t i) const;                  // campo vacío si no existe
+  String str(size_t i) const { return (*this)[i].toString(); }
+
+protected:
+  const char *_base = nullptr;
+  uint16_t _start[CSV_MAX_FIELDS];
+  uint16_t _len[CSV_MAX_FIELDS];
+  size_t _count = 0;
+};
+
+// Lector de filas sobre un File abierto (el llamador lo abre y lo cierra).
+class CsvReader : public CsvFields {
+public:
+  explicit CsvReader(File &f, bool skipHeader = true);
+  bool next();                                          // siguiente fila no vacía
+  const char *line() const { return _line + _lineStart; } // línea sin \r\n ni espacios extremos
+  size_t lineLength() const { return _lineLen; }
+  String lineString();                                  // copia completa de la línea
+  uint32_t offset() const { return _rowOff; }           // posición de la fila en el archivo
+  bool truncated() const { return _truncated; }
+
+private:
+  bool readLine();
+
+  File &_f;
+  char _chunk[CSV_CHUNK];
+  size_t _chunkPos = 0;
+  size_t _chunkLen = 0;
+  uint32_t _chunkBase = 0;                              // posición en archivo de _chunk[0]
+  char _line[CSV_LINE_MAX];
+  size_t _lineStart = 0;
+  size_t _lineLen = 0;
+  uint32_t _rowOff = 0;
+  bool _truncated = false;
+  const std::vector<uint32_t> *_dead = nullptr;         // lápidas del archivo (row_log)
+};
+
+// Lectura desde el final: devuelve el offset a partir del cual un CsvReader(f, false)
+// entrega sólo las últimas 'limit' filas no vacías. Recorre el File hacia atrás por
+// bloques de CSV_CHUNK (seek), así que el coste depende de 'limit' y no del tamaño
+// del archivo. No cuenta la cabecera (skipHeader) ni las filas con lápida.
+//
+//   f.seek(csvTailOffset(f, 50));
+//   CsvReader r(f, false);
+//   while (r.next()) { ... }            // las 50 últimas, en orden de archivo
+uint32_t csvTailOffset(File &f, size_t limit, bool skipHeader = true);
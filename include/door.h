@@ -0,0 +1,22 @@
+#pragma once
+// door.h - Control de la cerradura (servo 'puerta') sin bloquear.
+//
+// Antes rfidLoopHandler hacía puerta.write(90), esperaba la pantalla de acceso
+// y puerta.write(0) en línea. Ahora es una máquina de estados que avanza desde
+// doorLoop() (loop principal):
+//   CERRADA --doorOpen()--> ABRIENDO --DOOR_TRAVEL_MS--> ABIERTA
+//   ABIERTA --DOOR_HOLD_MS sin accesos--> CERRANDO --DOOR_TRAVEL_MS--> CERRADA
+// Otro acceso concedido mientras está abierta sólo alarga la espera (cuenta
+// desde el último); durante el cierre vuelve a abrir. Así un grupo pasa en un
+// solo ciclo y ninguna tarjeta espera a que la puerta se cierre.
+
+#include <Arduino.h>
+
+void doorBegin();                 // attach del servo y posición cerrada (setup)
+void doorLoop();                  // avanza la máquina de estados (loop)
+void doorOpen();                  // acceso concedido: abrir o alargar la apertura
+
+bool doorIsOpen();                // abriendo o abierta
+const char *doorStateName();      // para /status
+uint32_t doorOpenCycles();        // ciclos apertura-cierre
+uint32_t doorRetriggers();        // accesos que alargaron una apertura en curso
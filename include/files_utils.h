@@ -6,19 +6,26 @@
 #include "globals.h"  
 
 // --- Parse / I/O básico ---
-std::vector<String> parseQuotedCSVLine(const String &line);
 bool appendLineToFile(const char *path, const String &line);
 bool writeAllLines(const char *path, const std::vector<String> &lines);
 void initFiles();
 
+// --- Caché de courses/schedules ---
+// loadCourses()/loadSchedules() devuelven una referencia a la tabla en RAM; sólo
+// se vuelve a leer el CSV cuando cambió su generación (cualquier appendLineToFile
+// o writeAllLines sobre el archivo la incrementa). No guardar la referencia a
+// través de una escritura: copiarla (auto v = loadCourses();) si se va a modificar.
+
 // --- Schedules ---
-std::vector<ScheduleEntry> loadSchedules();
+const std::vector<ScheduleEntry> &loadSchedules();
+uint32_t schedulesGeneration();
 // Nota: no repetir argumentos por defecto si ya está en globals.h
 bool slotOccupied(const String &day, const String &start, const String &materiaFilter);
 void addScheduleSlot(const String &materia, const String &day, const String &start, const String &end);
 
 // --- Courses ---
-std::vector<Course> loadCourses();
+const std::vector<Course> &loadCourses();
+uint32_t coursesGeneration();
 bool courseExists(const String &materia);
 void addCourse(const String &materia, const String &prof);
 void writeCourses(const std::vector<Course> &list);
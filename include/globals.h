@@ -8,6 +8,7 @@
 #include <Adafruit_ST7735.h>
 #include <vector>
 #include <FS.h>
+#include "uid_key.h"
 
 class Servo;
 
@@ -58,6 +59,8 @@ extern Servo puerta; // forward-declared; definido en globals.cpp
 // --------------------------------------------------------------------
 
 // Capture mode globals
+// Los String de captura y auto-registro son del núcleo web (handlers y
+// rfidEventsLoop); el núcleo de acceso sólo lee los flags volatile.
 extern volatile bool captureMode;
 extern volatile bool captureBatchMode;
 extern String captureUID;
@@ -66,7 +69,7 @@ extern String captureAccount;
 extern unsigned long captureDetectedAt;
 
 // Variables para captura batch (declaraciones ONLY -> definidas en globals.cpp)
-extern std::vector<String> capturedUIDs;
+extern std::vector<UidKey> capturedUIDs;
 extern volatile bool isCapturing;
 extern volatile bool isBatchCapture;
 
@@ -88,17 +91,23 @@ extern String currentSelfRegToken;
 extern String currentSelfRegUID;
 
 // ---------------- Tipos ----------------
+// Los *Id los rellena loadCourses()/loadSchedules() desde el catálogo (catalog.h)
 struct Course {
   String materia;
   String profesor;
   String created_at;
+  uint16_t materiaId = 0;
+  uint16_t profesorId = 0;
+  uint16_t courseId = 0;
 };
 
 struct ScheduleEntry {
-  String materia;
+  String materia;      // dueño: "Materia" o "Materia||Profesor"
   String day;
   String start;
   String end;
+  uint16_t materiaId = 0;
+  uint16_t profesorId = 0;   // 0 si el dueño no trae profesor
 };
 
 // ---------------- Prototipos utilitarios ----------------
@@ -110,21 +119,21 @@ String nowISO(); // devuelve "YYYY-MM-DD HH:MM:SS"
 String uidBytesToString(byte *uid, byte len);
 
 // schedules / current schedule
-std::vector<ScheduleEntry> loadSchedules();
+const std::vector<ScheduleEntry> &loadSchedules();   // caché: válida hasta la próxima escritura
+uint32_t schedulesGeneration();
 String currentScheduledMateria();
+uint16_t currentScheduledMateriaId();
 bool slotOccupied(const String &day, const String &start, const String &materiaFilter = String());
 void addScheduleSlot(const String &materia, const String &day, const String &start, const String &end);
 
-// csv parsing
-std::vector<String> parseQuotedCSVLine(const String &line);
-
 // files utils (deben devolver bool)
 bool appendLineToFile(const char* path, const String &line);
 bool writeAllLines(const char* path, const std::vector<String> &lines);
 void initFiles();
 
 // courses
-std::vector<Course> loadCourses();
+const std::vector<Course> &loadCourses();            // caché: válida hasta la próxima escritura
+uint32_t coursesGeneration();
 bool courseExists(const String &materia);
 void addCourse(const String &materia, const String &prof);
 void writeCourses(const std::vector<Course> &list);
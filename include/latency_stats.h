@@ -0,0 +1,33 @@
+#pragma once
+// latency_stats.h - Histogramas de latencia (µs) por etapa de una lectura de tarjeta.
+//
+// Cada etapa acumula desde el arranque en cubetas fijas de escala logarítmica
+// (4 por potencia de 2: error < 25%), así que registrar es O(1), sin memoria
+// dinámica, y p50/p95/p99 se sacan recorriendo las cubetas. max es exacto.
+// Cada etapa la escribe una sola tarea (ver LatStage); la página sólo lee, y
+// una lectura a medio actualizar se corrige en la siguiente.
+//
+// /latency las lista todas (texto plano) y /status muestra el resumen.
+
+#include <Arduino.h>
+
+enum LatStage : uint8_t {
+  LAT_READ,       // tarea rfid: PICC_IsNewCardPresent + PICC_ReadCardSerial
+  LAT_QUEUE,      // núcleo de acceso: lectura -> inicio de la decisión (anillo + loop())
+  LAT_DECIDE,     // núcleo de acceso: vistas de acceso y horario
+  LAT_DOOR,       // núcleo de acceso: doorOpen()
+  LAT_DISPLAY,    // núcleo de acceso: dibujar el resultado (incluye esperar la pantalla)
+  LAT_TOTAL,      // núcleo de acceso: inicio de la lectura -> resultado en pantalla
+  LAT_RECORD,     // núcleo web: nombre/cuenta y líneas encoladas en log_writer
+  LAT_FLUSH,      // núcleo web: vaciado de log_writer al SPIFFS
+  LAT_STAGES
+};
+
+struct LatSummary {
+  uint32_t count;
+  uint32_t p50, p95, p99, max;   // µs
+};
+
+void latencyRecord(LatStage stage, uint32_t us);
+LatSummary latencySummary(LatStage stage);
+const char *latencyStageName(LatStage stage);
@@ -0,0 +1,27 @@
+#pragma once
+// log_writer.h - Escritura agrupada (group-commit) de ATT_FILE, DENIED_FILE y NOTIF_FILE.
+//
+// appendLineToFile() encola aquí las líneas de esos tres archivos en lugar de
+// abrir/escribir/cerrar por cada registro. La cola es acotada y se vacía:
+//   - al llegar a LOG_FLUSH_BYTES o LOG_QUEUE_MAX registros,
+//   - cuando el registro más antiguo supera LOG_FLUSH_MS (logWriterLoop),
+//   - con logWriterSync() (lectores de esos archivos antes de abrirlos),
+//   - antes de reiniciar (handler de apagado registrado en logWriterBegin).
+// Cada vaciado abre cada archivo una sola vez y escribe todas sus líneas;
+// attendance se reparte en segmentos diarios (att_store.h). Lo que no se pudo
+// escribir (archivo sin abrir, flash llena) sigue en la cola y se reintenta; si
+// la cola está llena de esas líneas, los registros nuevos se descartan y cuentan.
+
+#include <Arduino.h>
+
+void logWriterBegin();                                     // registrar hook de reinicio (setup)
+bool logWriterHandles(const char *path);                   // true para ATT/DENIED/NOTIF
+bool logWriterAppend(const char *path, const String &line); // encola (puede vaciar si está llena)
+void logWriterLoop();                                      // llamar en loop(): vacía por tiempo
+void logWriterSync();                                      // vacía todo ahora
+
+// Estadísticas (/status)
+size_t logWriterPending();
+uint32_t logWriterRecordCount();
+uint32_t logWriterFlushCount();
+uint32_t logWriterDropped();                               // descartados con la cola llena
@@ -0,0 +1,51 @@
+#pragma once
+// notif_store.h - Número de secuencia y estado leído/no leído de las notificaciones.
+//
+// Cada fila de NOTIF_FILE lleva una columna "seq" (1, 2, 3...) que nunca se
+// reutiliza, ni al borrar ni al vaciar las notificaciones. Las leídas se guardan
+// como rangos de seq [desde,hasta] en /notif_read.csv; marcar en orden deja un
+// único rango, así que el archivo es de pocas líneas y se reescribe entero,
+// pero no en cada clic: marcar y desmarcar sólo cambian la RAM y el archivo se
+// guarda de forma diferida (notifStoreLoop, NOTIF_SAVE_MS) y antes de reiniciar.
+// Un corte antes de guardar pierde esas marcas, no el recuento: lo guardado
+// (rangos y contadores) es coherente entre sí. Las bajas guardan en el acto.
+//   - leída / marcar / desmarcar: búsqueda binaria sobre los rangos en RAM
+//   - no leídas: notificaciones vivas - leídas (contadores; no se abre ningún archivo)
+//
+// El recuento (vivas/leídas) se guarda junto con el tamaño de NOTIF_FILE; al
+// arrancar sólo se leen las filas añadidas desde entonces. Si el archivo no
+// cuadra con lo guardado, se recorre entero.
+//
+// Para borrar una notificación por seq se guarda en RAM el offset de una de
+// cada NOTIF_MARK_ROWS filas (los seq crecen con el offset): se salta a la marca
+// anterior y se leen unas pocas filas. Las marcas se crean la primera vez que
+// hacen falta (una pasada) y después las alimenta log_writer al escribir cada
+// fila nueva; reescribir o compactar NOTIF_FILE las descarta.
+//
+// Antes se guardaba una clave "ts|uid|nota" por línea en "/.notif_read" y cada
+// consulta recorría los dos archivos. notifStoreBegin() migra una sola vez ese
+// archivo y las filas sin seq, y recalcula los contadores desde NOTIF_FILE.
+
+#include <Arduino.h>
+
+void notifStoreBegin();                    // tras rowLogBegin() (respeta las filas borradas)
+void notifStoreLoop();                     // guarda las marcas pendientes (diferido)
+void notifStoreSave();                     // guarda ahora si hay cambios (reinicio)
+
+uint32_t notifStoreAdd();                  // seq para una notificación nueva (addNotification)
+void notifStoreAdded();                    // su fila entró en la cola de log_writer: cuenta como viva
+void notifStoreRemoved(uint32_t seq);      // se borró la notificación 'seq'
+void notifStoreClear();                    // clearNotifications()
+void notifStoreResync();                   // NOTIF_FILE compactado: guardar el recuento de nuevo
+void notifStoreNoteRow(uint32_t offset, const String &line);   // log_writer: fila escrita en offset
+
+// Fila viva con ese seq: su offset y su texto (para rowLogDelete). false si no existe.
+bool notifStoreFindRow(uint32_t seq, uint32_t &offset, String &line);
+
+bool notifStoreIsRead(uint32_t seq);
+bool notifStoreMark(uint32_t seq);         // true si cambió el estado (false si ya no existe)
+bool notifStoreUnmark(uint32_t seq);
+
+int notifStoreLiveCount();
+int notifStoreUnreadCount();
+size_t notifStoreRangeCount();             // rangos de leídas (para /status)
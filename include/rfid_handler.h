@@ -6,4 +6,8 @@
 String uidBytesToString(byte *uid, byte len);
 String nowISO(); // obtiene timestamp local "YYYY-MM-DD HH:MM:SS"
 String currentScheduledMateria();
-void rfidLoopHandler(); // función que debe llamarse periódicamente para procesar tarjetas.
+void rfidHandlerBegin(); // diario núcleo de acceso -> núcleo web (setup, tras logWriterBegin)
+void rfidLoopHandler();  // núcleo de acceso (loop): decide, abre la puerta y muestra el resultado
+void rfidEventsLoop();   // núcleo web: registros, notificaciones y modo captura de esas lecturas
+uint32_t rfidRepeatTaps(); // pasadas repetidas en la misma sesión, sin registro (para /status)
+uint32_t rfidNoClockDecisions(); // decididas sin hora (modo degradado, para /status)
@@ -0,0 +1,35 @@
+#pragma once
+// rfid_reader.h - Lectura del MFRC522 en una tarea propia.
+//
+// Antes loop() sondeaba el lector cada 150 ms entre server.handleClient() y el
+// resto: una petición HTTP lenta (CSV grande, página de historial) retrasaba
+// la lectura de la tarjeta. Ahora una tarea FreeRTOS es la única que toca
+// 'mfrc522': sondea cada POLL_INTERVAL, lee el UID, hace HaltA/StopCrypto1 y deja
+// {uid, instante} en un anillo de un productor y un consumidor (sin locks: cada
+// índice lo escribe un solo lado). rfidLoopHandler() vacía el anillo desde loop()
+// y decide el acceso; el instante es el de la lectura, no el de la decisión.
+// Si el anillo se llena (loop() detenido mucho tiempo) las lecturas nuevas se
+// descartan y se cuentan. Si la tarea no se pudo crear (sin memoria), loop()
+// sondea el lector con rfidReaderPoll() en su lugar: más latencia, pero la
+// puerta sigue leyendo tarjetas.
+//
+// El bus SPI es compartido con la pantalla: cada acceso de las dos librerías va
+// dentro de beginTransaction/endTransaction, que en el core ESP32 toma el
+// mutex del bus.
+
+#include <Arduino.h>
+
+struct RfidEvent {
+  uint8_t uid[10];
+  uint8_t len;
+  uint32_t atMs;          // millis() de la lectura
+  uint32_t atUs;          // micros() al empezar la lectura (latency_stats.h)
+};
+
+void rfidReaderBegin();                   // tras mfrc522.PCD_Init() (setup)
+void rfidReaderPoll();                    // loop(): sondea sólo si no hay tarea (cada POLL_INTERVAL)
+bool rfidReaderPop(RfidEvent &ev);        // consumidor: false si no hay lecturas
+
+uint32_t rfidReaderReads();               // lecturas encoladas
+uint32_t rfidReaderDrops();               // descartadas con el anillo lleno
+uint32_t rfidReaderMaxDepth();            // máxima ocupación observada
@@ -0,0 +1,35 @@
+#pragma once
+// row_log.h - Bajas y ediciones de filas sin reescribir el archivo (tombstones).
+//
+// Borrar o editar una fila de USERS_FILE, TEACHERS_FILE o NOTIF_FILE ya no
+// lee el CSV completo a RAM ni lo reescribe:
+//   - baja:    se añade una lápida "offset","hash" al archivo lateral <ruta>.del
+//   - edición: la fila nueva añadida al final + lápida de la fila vieja
+// Ambas son escrituras de tamaño constante. CsvReader (csv_reader.h) salta las
+// filas con lápida de forma transparente, y el índice de UID las ignora.
+//
+// Compactación (rowLogLoop): cuando un archivo acumula suficientes lápidas y
+// lleva un rato sin cambios, se copian las filas vivas a <ruta>.tmp, se borra
+// el original y se renombra el temporal. Si el equipo se reinicia a mitad,
+// rowLogBegin() termina o descarta la compactación; cada lápida guarda el hash
+// de su fila y se descarta si ya no coincide (archivo compactado/reescrito).
+
+#include <Arduino.h>
+#include <vector>
+
+void rowLogBegin();                         // tras initFiles() y antes de uidIndexBuild()
+void rowLogLoop();                          // compactación en segundo plano
+
+// Offsets (ordenados) de filas borradas de 'path'; nullptr si no hay ninguna.
+const std::vector<uint32_t> *rowLogDeadRows(const char *path);
+
+// Marca como borrada la fila 'line' que empieza en 'offset'.
+bool rowLogDelete(const char *path, uint32_t offset, const String &line);
+// Sustituye la fila en 'offset' por 'newLine' (append + lápida).
+bool rowLogUpdate(const char *path, uint32_t offset, const String &oldLine, const String &newLine);
+
+void rowLogResetFile(const char *path);     // writeAllLines() reescribió el archivo
+bool rowLogCompact(const char *path);       // aplica las lápidas ahora
+
+size_t rowLogDeadCount();                   // lápidas pendientes (todas) para /status
+uint32_t rowLogCompactions();
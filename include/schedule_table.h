@@ -0,0 +1,66 @@
+#pragma once
+// schedule_table.h - Horario semanal compilado: materia con clase ahora y choques entre horarios.
+//
+// Las filas de loadSchedules() se compilan una vez por día de la semana en:
+//   - tramos ordenados y sin solape [desde, hasta] (minutos del día) -> materiaId,
+//     para currentScheduledMateriaId() (se llama en cada tarjeta). Si dos
+//     horarios se pisan gana el primero del archivo, como antes.
+//   - un índice de intervalos [inicio, fin) ordenado por inicio, con el fin
+//     máximo acumulado, para las consultas de choque de las páginas de horarios:
+//     un horario 07:00-09:00 no choca con 09:00-11:00, pero sí con 08:00-10:00.
+// Los minutos de cada horario se usan tal cual (no dependen de SLOT_STARTS).
+//
+// La tabla se recompila sólo cuando cambia schedulesGeneration() (cualquier
+// escritura de SCHEDULES_FILE). La consulta de la materia actual recuerda el
+// último tramo encontrado: mientras el minuto siga dentro de él la respuesta es
+// inmediata y no toca el SPIFFS. Los choques son una búsqueda binaria por día.
+//
+// Los punteros a ScheduleEntry apuntan a la caché de loadSchedules(): valen
+// hasta la próxima escritura de SCHEDULES_FILE.
+//
+// Los tramos compilados se publican además como una ScheduleWeek inmutable
+// (std::atomic_store de un shared_ptr): el núcleo de acceso la toma con
+// scheduleTableWeek() sin bloquear, mientras el núcleo web (el único que lee
+// SCHEDULES_FILE y recompila) publica la siguiente.
+
+#include <Arduino.h>
+#include <vector>
+#include <memory>
+#include "catalog.h"
+#include "globals.h"
+
+static const int SCHEDULE_WEEK_DAYS = 6;                   // LUN..SAB
+
+struct SchedSpan {
+  uint16_t from;       // minuto del día, inclusive
+  uint16_t to;         // inclusive
+  CatalogId materiaId;
+};
+
+struct ScheduleWeek {
+  std::vector<SchedSpan> days[SCHEDULE_WEEK_DAYS];         // ordenados y sin solape
+  CatalogId owner(int dayIndex, int minute) const;         // 0 = sin clase
+};
+
+void scheduleTableBegin();                                 // tras catalogBegin() (compila ya)
+void scheduleTableLoop();                                  // núcleo web: recompila si cambió el archivo
+std::shared_ptr<const ScheduleWeek> scheduleTableWeek();   // última semana publicada (cualquier núcleo)
+
+// dayIndex: 0..5 = DAYS[] (LUN..SAB); minute: 0..1439. 0 = sin clase.
+CatalogId scheduleTableOwner(int dayIndex, int minute);
+
+int scheduleTableDayIndex(const String &day);              // -1 si no es LUN..SAB
+int scheduleTableMinutes(const String &hhmm);              // "7:05" -> 425; -1 si no es HH:MM
+
+// Primer horario (menor inicio) que choca con [from, to) ese día; nullptr si
+// ninguno. 'owner' no vacío limita la búsqueda a ese dueño ("Materia||Profesor").
+const ScheduleEntry *scheduleTableOverlap(int dayIndex, int from, int to, const String &owner = String());
+const ScheduleEntry *scheduleTableOverlap(const String &day, const String &start, const String &end);
+// Horario que empieza exactamente en 'start' ese día (para borrar por día+inicio).
+const ScheduleEntry *scheduleTableStartingAt(const String &day, const String &start);
+
+// Dueño de cada celda de la grilla (slot de 2 h desde SLOT_STARTS[s]) en una
+// pasada por día: índice [d * SLOT_COUNT + s], nullptr = libre.
+std::vector<const ScheduleEntry *> scheduleTableGrid();
+
+size_t scheduleTableSpans();                               // tramos compilados (para /status)
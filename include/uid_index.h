@@ -0,0 +1,51 @@
+#pragma once
+// uid_index.h - Índice residente en RAM: UID -> filas de USERS_FILE / TEACHERS_FILE.
+//
+// Evita recorrer los CSV completos en cada lectura de tarjeta. El índice guarda,
+// por cada fila, el hash del UID (clave de uid_key.h plegada a 32 bits, así que
+// "04a1..." y "04A1..." son el mismo UID) y el offset de la fila en el archivo;
+// la búsqueda es O(1) (tabla hash con sondeo lineal) y después se hace un seek
+// directo por fila encontrada (se verifica el UID real al leerla).
+//
+// Una segunda tabla igual, indexada por número de cuenta, resuelve las
+// comprobaciones de cuenta duplicada sin recorrer los archivos.
+//
+// Presupuesto de RAM: 8 bytes por ranura y tabla, factor de carga <= 0.7 y
+// capacidad potencia de 2 => entre 11.4 KB y 16 KB por tabla y 1 000 filas.
+// Un alumno con 2 materias ocupa 2 filas: ~1 000 alumnos x 2 materias ~= 64 KB.
+//
+// Se construye en setup() (uidIndexBuild) y se mantiene al día automáticamente
+// desde appendLineToFile / writeAllLines (files_utils.cpp), que son los únicos
+// escritores de ambos archivos. Las filas borradas con row_log conservan su
+// ranura hasta la compactación, pero readRows ya no las devuelve.
+
+#include <Arduino.h>
+#include <vector>
+
+// Reconstruye el índice leyendo USERS_FILE y TEACHERS_FILE (llamar tras initFiles()).
+void uidIndexBuild();
+
+// true si el archivo está indexado (USERS_FILE o TEACHERS_FILE).
+bool uidIndexTracksFile(const char *path);
+
+// Hooks usados por los escritores de files_utils.cpp
+void uidIndexResetFile(const char *path);                                  // antes de reescribir
+void uidIndexNoteRow(const char *path, uint32_t offset, const String &line); // fila escrita en offset
+void uidIndexRebuildFile(const char *path);                                // tras compactar (row_log.h)
+
+// Consultas (núcleo web; la decisión de acceso usa access_table.h, no este índice)
+bool uidIndexHasUser(const String &uid);
+bool uidIndexHasTeacher(const String &uid);
+// Filas crudas (CSV) del UID; 'offsets' (opcional) recibe el offset de cada fila,
+// necesario para borrarla/editarla con row_log.
+std::vector<String> uidIndexUserRows(const String &uid, std::vector<uint32_t> *offsets = nullptr);
+std::vector<String> uidIndexTeacherRows(const String &uid, std::vector<uint32_t> *offsets = nullptr);
+
+// Índice secundario por número de cuenta (validación de cuenta duplicada).
+// Devuelve la primera fila con esa cuenta: USERS_FILE antes que TEACHERS_FILE.
+bool uidIndexFindAccount(const String &account, String &uidOut, bool &teacherOut);
+std::vector<String> uidIndexAccountUserRows(const String &account); // filas de USERS_FILE con la cuenta
+
+// Diagnóstico (/status)
+size_t uidIndexRowCount();
+size_t uidIndexRamBytes();
@@ -0,0 +1,44 @@
+#pragma once
+// uid_key.h - UID de tarjeta empaquetado: hasta 10 bytes + longitud, sin heap.
+//
+// El lector entrega bytes. Antes se convertían a un String hex (snprintf por
+// byte y toUpperCase) y todo lo posterior comparaba Strings. UidKey guarda los
+// bytes tal cual: comparar es un memcmp corto y hash() da la clave de 64 bits de
+// las tablas en RAM (access_table, uid_index, att_rollup). Los UID de 4 y 7
+// bytes (los de las tarjetas MIFARE) caben enteros en la clave, sin colisiones.
+//
+// El texto hex sólo aparece en los bordes: al escribir filas CSV, HTML,
+// notificaciones y Serial (toString/format) y al leer un UID de un archivo o de
+// un formulario (parse, sin distinguir mayúsculas). Un texto que no es hex
+// válido no tiene UidKey; uidKeyHash() le da igualmente una clave (hash del
+// texto) para que las tablas lo sigan encontrando.
+
+#include <Arduino.h>
+#include <string.h>
+
+struct UidKey {
+  static const uint8_t MAX_LEN = 10;
+  static const size_t TEXT_LEN = MAX_LEN * 2 + 1;   // búfer de format()
+
+  // Agregado trivial (sin constructor): vive en CardEvent, dentro del diario
+  // RTC_NOINIT, que no debe inicializarse al arrancar. UidKey{} = vacío.
+  uint8_t len;
+  uint8_t bytes[MAX_LEN];
+
+  static UidKey fromBytes(const uint8_t *p, uint8_t n);      // recorta a MAX_LEN
+  static bool parse(const char *p, size_t n, UidKey &out);   // false si no es hex de 1..10 bytes
+  static bool parse(const String &s, UidKey &out) { return parse(s.c_str(), s.length(), out); }
+
+  bool empty() const { return len == 0; }
+  uint64_t hash() const;
+  size_t format(char *out, size_t cap) const;   // "04A1B2..." en mayúsculas; devuelve la longitud
+  String toString() const;
+
+  bool operator==(const UidKey &o) const { return len == o.len && memcmp(bytes, o.bytes, len) == 0; }
+  bool operator!=(const UidKey &o) const { return !(*this == o); }
+};
+
+// Clave de un UID en texto (columna de CSV, argumento HTTP): la de parse() si es
+// hex válido, si no un hash del texto.
+uint64_t uidKeyHash(const char *p, size_t n);
+inline uint64_t uidKeyHash(const String &s) { return uidKeyHash(s.c_str(), s.length()); }
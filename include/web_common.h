@@ -9,6 +9,7 @@ String htmlFooter();
 // Helpers para rutas web
 void handleRoot();
 void handleStatus();
+void handleLatency();   // /latency: histogramas por etapa de una lectura
 void registerRoutes();
 
 // Declaraciones de validación 
@@ -0,0 +1,191 @@
+// src/access_table.cpp
+#include "access_table.h"
+#include "config.h"
+#include "globals.h"
+#include "files_utils.h"
+#include "csv_reader.h"
+#include <SPIFFS.h>
+#include <algorithm>
+#include <string.h>
+
+static std::shared_ptr<const AccessView> g_view;   // publicada (std::atomic_load/atomic_store)
+static std::unique_ptr<AccessView> g_work;         // cambios sin publicar (sólo núcleo web)
+static bool g_dirty = false;
+static uint32_t g_coursesGen = 0;             // coursesGeneration() con que se construyó
+static uint32_t g_published = 0;              // publicaciones hechas (AccessView::generation)
+static const AccessView EMPTY_VIEW;
+
+static std::vector<AccessEntry>::const_iterator firstWithKey(const std::vector<AccessEntry> &t, uint64_t key) {
+  return std::lower_bound(t.begin(), t.end(), key, [](const AccessEntry &e, uint64_t k) { return e.key < k; });
+}
+
+// La clave sólo elige el candidato: se concede por el UID completo (dos UIDs
+// largos con la misma clave FNV son entradas distintas).
+static const AccessEntry *findUid(const std::vector<AccessEntry> &t, const UidKey &uid) {
+  if (uid.empty()) return nullptr;
+  uint64_t key = uid.hash();
+  for (auto it = firstWithKey(t, key); it != t.end() && it->key == key; ++it)
+    if (it->uid == uid) return &*it;
+  return nullptr;
+}
+
+// Fila de un CSV: 'uid' vacío si el texto no es hex (ninguna tarjeta lo leerá).
+static AccessEntry *createEntry(std::vector<AccessEntry> &t, uint64_t key, const UidKey &uid) {
+  auto it = firstWithKey(t, key);
+  for (; it != t.end() && it->key == key; ++it)
+    if (it->uid == uid) return &t[it - t.begin()];
+  AccessEntry e;
+  e.key = key;
+  e.uid = uid;
+  e.profesorId = 0;
+  return &*t.insert(t.begin() + (it - t.begin()), e);
+}
+
+// Copia de trabajo: se crea desde la vista publicada con el primer cambio.
+static AccessView &work() {
+  if (!g_work) g_work.reset(g_view ? new AccessView(*g_view) : new AccessView());
+  return *g_work;
+}
+
+static const AccessView &current() {
+  if (g_work) return *g_work;
+  return g_view ? *g_view : EMPTY_VIEW;
+}
+
+static void addMat(AccessEntry *e, CatalogId mid) {
+  if (!mid) return;
+  for (auto m : e->mats) if (m == mid) return;
+  e->mats.push_back(mid);
+}
+
+// Materias de los cursos del profesor (por ID, sin distinguir mayúsculas).
+static void addCourseMats(AccessEntry *e) {
+  if (!e->profesorId) return;
+  for (auto &c : loadCourses()) if (c.profesorId == e->profesorId) addMat(e, c.materiaId);
+}
+
+static void noteFields(AccessView &v, bool teacher, const CsvFields &c, bool withCourses) {
+  if (c.size() < 2) return;
+  CsvField uid = c[USERS_UID];
+  if (uid.empty() || uid.equals("uid")) return;   // cabecera
+  UidKey k{};
+  uint64_t key = UidKey::parse(uid.ptr, uid.len, k) ? k.hash() : uidKeyHash(uid.ptr, uid.len);
+  AccessEntry *e = createEntry(teacher ? v.teachers : v.students, key, k);
+  if (e->name.length() == 0) e->name = c.str(USERS_NAME);
+  if (c.size() >= 4) {
+    String mat = c.str(USERS_MATERIA);
+    mat.trim();
+    addMat(e, catalogMateriaId(mat));
+  }
+  if (teacher && !e->profesorId) {
+    e->profesorId = catalogProfesorId(c.str(USERS_NAME));
+    if (withCourses) addCourseMats(e);
+  }
+}
+
+static void loadFile(AccessView &v, const char *path, bool teacher) {
+  File f = SPIFFS.open(path, FILE_READ);
+  if (!f) return;
+  CsvReader r(f);
+  while (r.next()) noteFields(v, teacher, r, false);
+  f.close();
+}
+
+// Publica la copia de trabajo (con los nombres de materia del catálogo).
+static void publish() {
+  AccessView &w = work();
+  size_t n = catalogMateriaCount();
+  w.materias.clear();
+  w.materias.reserve(n);
+  for (size_t id = 1; id <= n; ++id) w.materias.push_back(catalogMateriaName((CatalogId)id));
+  w.generation = ++g_published;
+  std::atomic_store(&g_view, std::shared_ptr<const AccessView>(g_work.release()));
+}
+
+static void rebuild() {
+  unsigned long t0 = millis();
+  g_work.reset(new AccessView());
+  AccessView &v = *g_work;
+  g_coursesGen = coursesGeneration();
+  loadFile(v, USERS_FILE, false);
+  loadFile(v, TEACHERS_FILE, true);
+  // las materias por curso se añaden al final, tras las de sus filas
+  for (auto &e : v.teachers) addCourseMats(&e);
+  g_dirty = false;
+  Serial.printf("accessTable: %u alumnos, %u maestros, %lums\n",
+                (unsigned)v.students.size(), (unsigned)v.teachers.size(), millis() - t0);
+  publish();
+}
+
+static void ensureFresh() {
+  if (g_dirty || g_coursesGen != coursesGeneration()) rebuild();
+}
+
+void accessTableBegin() { rebuild(); }
+
+void accessTableLoop() {
+  ensureFresh();
+  // altas pendientes o materias nuevas en el catálogo (p. ej. de un horario)
+  if (g_work || !g_view || g_view->materias.size() != catalogMateriaCount()) publish();
+}
+
+std::shared_ptr<const AccessView> accessTableView() {
+  return std::atomic_load(&g_view);
+}
+
+void accessTableNoteRow(const char *path, const String &line) {
+  if (!path) return;
+  bool teacher = (strcmp(path, TEACHERS_FILE) == 0);
+  if (!teacher && strcmp(path, USERS_FILE) != 0) return;
+  if (g_dirty) return;   // se reconstruirá entera
+  CsvFields c;
+  c.split(line);
+  noteFields(work(), teacher, c, true);
+}
+
+void accessTableReset(const char *path) {
+  if (path && (strcmp(path, USERS_FILE) == 0 || strcmp(path, TEACHERS_FILE) == 0)) g_dirty = true;
+}
+
+const AccessEntry *AccessView::findStudent(const UidKey &uid) const {
+  return findUid(students, uid);
+}
+
+const AccessEntry *AccessView::findTeacher(const UidKey &uid) const {
+  return findUid(teachers, uid);
+}
+
+const String &AccessView::materiaName(CatalogId id) const {
+  static const String EMPTY;
+  return (id && id <= materias.size()) ? materias[id - 1] : EMPTY;
+}
+
+const AccessEntry *accessFindStudent(const UidKey &uid) {
+  ensureFresh();
+  return current().findStudent(uid);
+}
+
+const AccessEntry *accessFindTeacher(const UidKey &uid) {
+  ensureFresh();
+  return current().findTeacher(uid);
+}
+
+bool accessHasMateria(const AccessEntry *e, CatalogId materiaId) {
+  if (!e || !materiaId) return false;
+  for (auto m : e->mats) if (m == materiaId) return true;
+  return false;
+}
+
+size_t accessTableSize() {
+  const AccessView &v = current();
+  return v.students.size() + v.teachers.size();
+}
+
+size_t accessTableRamBytes() {
+  const AccessView &v = current();
+  size_t n = (v.students.capacity() + v.teachers.capacity()) * sizeof(AccessEntry);
+  for (auto &e : v.students) n += e.mats.capacity() * sizeof(CatalogId) + e.name.length() + 1;
+  for (auto &e : v.teachers) n += e.mats.capacity() * sizeof(CatalogId) + e.name.length() + 1;
+  for (auto &m : v.materias) n += sizeof(String) + m.length() + 1;
+  return n;
+}
@@ -0,0 +1,282 @@
+// src/att_index.cpp
+#include "att_index.h"
+#include "att_store.h"
+#include "catalog.h"
+#include "config.h"
+#include "globals.h"
+#include "files_utils.h"
+#include "uid_key.h"
+#include <SPIFFS.h>
+#include <algorithm>
+
+static const char *IX_DIR = "/att/ix";
+static const char *IX_BUILT_FILE = "/att/ix/built2";    // existe si el índice cubre todos los segmentos
+static const char *IX_OLD_BUILT_FILE = "/att/ix/built"; // formato anterior: un archivo por clave
+static const uint32_t IX_UID_BUCKETS = 64;              // potencias de 2
+static const uint32_t IX_MAT_BUCKETS = 16;
+
+struct Posting {
+  String file;
+  String day;
+  uint32_t offset;
+  String key;
+};
+
+static String bucketFile(char kind, uint32_t bucket) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%s/%c%02lx.csv", IX_DIR, kind, (unsigned long)bucket);
+  return String(buf);
+}
+
+// Clave de un UID en los postings: UidKey::hash() en hex (sin distinguir mayúsculas).
+static String uidKeyText(const char *p, size_t n) {
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)uidKeyHash(p, n));
+  return String(buf);
+}
+
+static String uidFile(const char *p, size_t n) {
+  return bucketFile('u', (uint32_t)uidKeyHash(p, n) & (IX_UID_BUCKETS - 1));
+}
+
+static String materiaFile(CatalogId id) {
+  return bucketFile('m', id & (IX_MAT_BUCKETS - 1));
+}
+
+// Postings de una fila de attendance (sin uid o sin materia no se indexa esa clave).
+static void postingsFor(const CsvFields &c, const String &day, uint32_t off, std::vector<Posting> &out) {
+  CsvField uid = c[ATT_UID].trimmed();
+  if (!uid.empty()) out.push_back(Posting{uidFile(uid.ptr, uid.len), day, off, uidKeyText(uid.ptr, uid.len)});
+  CsvField m = c[ATT_MATERIA];
+  CatalogId mid = catalogFindMateria(m.ptr, m.len);   // sin crear: una materia desconocida no se indexa
+  if (mid) out.push_back(Posting{materiaFile(mid), day, off, String(mid)});
+}
+
+// Un append por archivo de postings (conserva el orden de las filas dentro de cada uno).
+static void appendPostings(std::vector<Posting> &ps) {
+  std::stable_sort(ps.begin(), ps.end(), [](const Posting &a, const Posting &b) { return a.file < b.file; });
+  for (size_t i = 0; i < ps.size(); ) {
+    File f = SPIFFS.open(ps[i].file, FILE_APPEND);
+    if (!f) { Serial.printf("ERR append %s\n", ps[i].file.c_str()); return; }
+    size_t j = i;
+    for (; j < ps.size() && ps[j].file == ps[i].file; ++j)
+      f.println("\"" + ps[j].day + "\",\"" + String(ps[j].offset) + "\",\"" + ps[j].key + "\"");
+    f.close();
+    i = j;
+  }
+}
+
+// Todos los archivos de postings, también los del formato anterior (para borrarlos).
+static std::vector<String> postingFiles() {
+  std::vector<String> out;
+  File dir = SPIFFS.open(IX_DIR);
+  if (!dir) return out;
+  File e = dir.openNextFile();
+  while (e) {
+    String name = e.name();
+    e.close();
+    int slash = name.lastIndexOf('/');
+    if (slash >= 0) name = name.substring(slash + 1);   // core 1.x devuelve la ruta completa
+    if ((name.startsWith("u") || name.startsWith("m")) && name.endsWith(".csv")) out.push_back(String(IX_DIR) + "/" + name);
+    e = dir.openNextFile();
+  }
+  dir.close();
+  return out;
+}
+
+static void indexSegment(const String &day, uint32_t fromOffset) {
+  File f = SPIFFS.open(attSegmentPath(day), FILE_READ);
+  if (!f) return;
+  std::vector<Posting> ps;
+  bool header = (fromOffset == 0);
+  if (!header) f.seek(fromOffset);
+  CsvReader r(f, header);
+  while (r.next()) {
+    if (r.size() < 5) continue;
+    postingsFor(r, day, r.offset(), ps);
+    if (ps.size() >= 64) { appendPostings(ps); ps.clear(); }
+  }
+  f.close();
+  appendPostings(ps);
+}
+
+static bool dayInPrefix(const String &day, const String &tsPrefix) {
+  if (tsPrefix.length() >= 10) return day == tsPrefix.substring(0, 10);
+  return day.startsWith(tsPrefix);
+}
+
+// Recorre los postings de 'key' en el bucket 'path' y entrega las filas que
+// pasan 'match'. Un día puede reaparecer más adelante en el archivo (cola
+// re-indexada tras un corte): se recuerda el último offset entregado por día y
+// se descarta lo repetido. Los días ya borrados se saltan (no tienen segmento).
+static void forEachPosting(const String &path, const String &key, const String &tsPrefix,
+                           const std::function<bool(CsvReader &)> &match,
+                           const std::function<void(CsvReader &)> &fn) {
+  File p = SPIFFS.open(path, FILE_READ);
+  if (!p) return;
+  struct Served { String day; uint32_t lastOff; bool any; };
+  std::vector<Served> served;
+  size_t cur = (size_t)-1;
+  File seg;
+  bool skipDay = true;
+  CsvReader pr(p, false);   // sin cabecera
+  while (pr.next()) {
+    if (pr.size() < 3 || !pr[2].equals(key)) continue;
+    if (cur == (size_t)-1 || !pr[0].equals(served[cur].day)) {
+      if (seg) seg.close();
+      String day = pr.str(0);
+      cur = (size_t)-1;
+      for (size_t i = 0; i < served.size(); ++i) if (served[i].day == day) { cur = i; break; }
+      if (cur == (size_t)-1) { served.push_back(Served{day, 0, false}); cur = served.size() - 1; }
+      skipDay = !dayInPrefix(day, tsPrefix) || !attHasSegment(day);
+      if (!skipDay) seg = SPIFFS.open(attSegmentPath(day), FILE_READ);
+      if (!seg) skipDay = true;
+    }
+    if (skipDay) continue;
+    uint32_t off = (uint32_t)pr[1].toInt();
+    Served &sv = served[cur];
+    if (sv.any && off <= sv.lastOff) continue;   // ya entregada
+    sv.lastOff = off;
+    sv.any = true;
+    if (!seg.seek(off)) continue;
+    CsvReader r(seg, false);
+    if (r.next() && r.offset() == off && match(r)) fn(r);
+  }
+  if (seg) seg.close();
+  p.close();
+}
+
+// Quita el principio de un bucket (postings de días borrados) copiando el resto
+// a un temporal. Si falla se conserva el original: lo muerto sólo ocupa espacio.
+static void dropBucketHead(const String &path, uint32_t cut) {
+  String tmp = path + ".tmp";
+  File in = SPIFFS.open(path, FILE_READ);
+  if (!in) return;
+  File out = SPIFFS.open(tmp, FILE_WRITE);
+  if (!out) { in.close(); Serial.printf("ERR compact %s\n", path.c_str()); return; }
+  uint32_t expected = (uint32_t)in.size() - cut, written = 0;
+  uint8_t buf[CSV_CHUNK];
+  in.seek(cut);
+  for (int n; (n = in.read(buf, sizeof(buf))) > 0; ) written += out.write(buf, n);
+  in.close();
+  uint32_t outSize = (uint32_t)out.size();
+  out.close();
+  if (written != expected || outSize != expected) {
+    SPIFFS.remove(tmp);
+    Serial.printf("ERR compact %s: escritos %u de %u bytes, se conserva el original\n",
+                  path.c_str(), (unsigned)outSize, (unsigned)expected);
+    return;
+  }
+  SPIFFS.remove(path);
+  if (!SPIFFS.rename(tmp, path)) Serial.printf("ERR rename %s\n", tmp.c_str());   // attIndexBegin() lo recupera
+}
+
+// Compactación interrumpida: el temporal sólo es válido si el original ya se borró.
+static void recoverBucket(const String &path) {
+  String tmp = path + ".tmp";
+  if (!SPIFFS.exists(tmp)) return;
+  if (!SPIFFS.exists(path)) SPIFFS.rename(tmp, path);
+  else SPIFFS.remove(tmp);
+}
+
+// --- API ---
+
+void attIndexBegin() {
+  for (uint32_t b = 0; b < IX_UID_BUCKETS; ++b) recoverBucket(bucketFile('u', b));
+  for (uint32_t b = 0; b < IX_MAT_BUCKETS; ++b) recoverBucket(bucketFile('m', b));
+  if (SPIFFS.exists(IX_BUILT_FILE)) return;
+  if (SPIFFS.exists(IX_OLD_BUILT_FILE)) {
+    // un archivo por UID/materia: se pasa a buckets (attIndexRebuild borra los anteriores)
+    SPIFFS.remove(IX_OLD_BUILT_FILE);
+    Serial.println("attIndex: formato anterior, reconstruyendo en buckets");
+    attIndexRebuild();
+    return;
+  }
+  if (!attSegments().empty()) {
+    Serial.println("attIndex: índice ausente, construyendo desde los segmentos");
+    attIndexRebuild();
+    return;
+  }
+  File f = SPIFFS.open(IX_BUILT_FILE, FILE_WRITE);
+  if (f) f.close();
+}
+
+void attIndexNoteLines(const std::vector<String> &lines, const std::vector<String> &days,
+                       const std::vector<uint32_t> &offsets) {
+  std::vector<Posting> ps;
+  ps.reserve(lines.size() * 2);
+  CsvFields c;
+  for (size_t i = 0; i < lines.size() && i < days.size() && i < offsets.size(); ++i) {
+    if (c.split(lines[i]) < 5) continue;
+    postingsFor(c, days[i], offsets[i], ps);
+  }
+  appendPostings(ps);
+}
+
+void attIndexSegmentFrom(const String &day, uint32_t fromOffset) {
+  if (!SPIFFS.exists(IX_BUILT_FILE)) return;   // attIndexBegin() lo construirá entero
+  indexSegment(day, fromOffset);
+}
+
+// Los postings de días borrados ya no se entregan (su segmento no existe), así
+// que no hace falta reescribir los buckets. Como crecen por el final en orden
+// de día, lo muerto está al principio: un bucket se recorta sólo cuando eso es
+// al menos la mitad del archivo, y se borra si queda vacío.
+void attIndexDropBefore(const String &day) {
+  for (auto &path : postingFiles()) {
+    File f = SPIFFS.open(path, FILE_READ);
+    if (!f) continue;
+    uint32_t size = (uint32_t)f.size();
+    uint32_t cut = size;
+    CsvReader r(f, false);
+    while (r.next()) {
+      if (!(r.str(0) < day)) { cut = r.offset(); break; }
+    }
+    f.close();
+    if (cut >= size) SPIFFS.remove(path);
+    else if (cut > 0 && cut >= size / 2) dropBucketHead(path, cut);
+  }
+}
+
+void attIndexClear() {
+  for (auto &path : postingFiles()) SPIFFS.remove(path);
+}
+
+uint32_t attIndexRebuild() {
+  unsigned long t0 = millis();
+  SPIFFS.remove(IX_BUILT_FILE);
+  attIndexClear();
+  uint32_t n = 0;
+  for (auto &s : attSegments()) {
+    indexSegment(s.day, 0);
+    n += s.records;
+  }
+  File f = SPIFFS.open(IX_BUILT_FILE, FILE_WRITE);
+  if (f) f.close();
+  Serial.printf("attIndex: %u registros indexados, %lums\n", (unsigned)n, millis() - t0);
+  return n;
+}
+
+void attIndexForUid(const String &uid, const String &tsPrefix, const std::function<void(CsvReader &)> &fn) {
+  String key = uid;
+  key.trim();
+  if (key.length() == 0) return;
+  // la clave del posting sólo elige candidatos: se compara el UID completo de la fila
+  UidKey want{};
+  bool hex = UidKey::parse(key, want);
+  forEachPosting(uidFile(key.c_str(), key.length()), uidKeyText(key.c_str(), key.length()), tsPrefix,
+                 [&](CsvReader &r) {
+                   CsvField f = r[ATT_UID].trimmed();
+                   UidKey got{};
+                   return hex ? (UidKey::parse(f.ptr, f.len, got) && got == want) : f.equals(key);
+                 }, fn);
+}
+
+void attIndexForMateria(const String &materia, const String &tsPrefix, const std::function<void(CsvReader &)> &fn) {
+  CatalogId mid = catalogFindMateria(materia);
+  if (!mid) return;
+  forEachPosting(materiaFile(mid), String(mid), tsPrefix, [mid](CsvReader &r) {
+    CsvField m = r[ATT_MATERIA];
+    return catalogFindMateria(m.ptr, m.len) == mid;
+  }, fn);
+}
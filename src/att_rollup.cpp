@@ -0,0 +1,315 @@
+// src/att_rollup.cpp
+#include "att_rollup.h"
+#include "att_store.h"
+#include "config.h"
+#include "globals.h"
+#include "files_utils.h"
+#include "csv_reader.h"
+#include "uid_key.h"
+#include <SPIFFS.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *ROLLUP_PREFIX = "/att/roll-";           // + YYYY-MM-DD.csv (no es un segmento)
+static const char *LEGACY_ROLLUP_FILE = "/att/rollup.csv";  // formato anterior: un solo archivo
+static const char *ROLLUP_HEADER = "\"kind\",\"key\",\"materia_id\",\"records\",\"students\"";
+
+struct UidCount {
+  uint64_t key;          // UidKey::hash() (uidKeyHash del texto)
+  uint32_t records;
+};
+
+// UIDs ya vistos en una sesión (día abierto) de la materia
+struct OpenSession {
+  CatalogId materiaId;
+  std::vector<uint64_t> uids;   // claves de UID (uid_key.h) ordenadas
+};
+
+static std::vector<AttDayCount> g_days;     // ordenados por (día, materia)
+static std::vector<UidCount> g_uids;        // totales del historial, ordenados por clave
+static String g_openDay;                    // día que recibe registros
+static std::vector<OpenSession> g_open;     // sus sesiones
+static std::vector<UidCount> g_dayUids;     // sus registros por UID (para su archivo)
+static bool g_dirty = false;                // el archivo de g_openDay está atrasado
+
+static bool isTeacherMode(const CsvField &mode) { return mode.equals("entrada-teacher"); }
+
+static bool dayLess(const AttDayCount &a, const String &day, CatalogId mid) {
+  int c = strcmp(a.day.c_str(), day.c_str());
+  return c < 0 || (c == 0 && a.materiaId < mid);
+}
+
+// Índice de la fila (día, materia); la crea si no existe.
+static size_t dayRow(const String &day, CatalogId mid) {
+  // casi siempre es el día más reciente: mirar primero el final
+  size_t lo = 0;
+  if (!g_days.empty() && dayLess(g_days.back(), day, mid)) lo = g_days.size();
+  else {
+    auto it = std::lower_bound(g_days.begin(), g_days.end(), day,
+                               [mid](const AttDayCount &a, const String &d) { return dayLess(a, d, mid); });
+    lo = (size_t)(it - g_days.begin());
+    if (lo < g_days.size() && g_days[lo].day == day && g_days[lo].materiaId == mid) return lo;
+  }
+  AttDayCount d;
+  d.day = day; d.materiaId = mid; d.records = 0; d.students = 0;
+  g_days.insert(g_days.begin() + lo, d);
+  return lo;
+}
+
+static UidCount *uidRow(std::vector<UidCount> &t, uint64_t key, bool create) {
+  auto it = std::lower_bound(t.begin(), t.end(), key,
+                             [](const UidCount &a, uint64_t k) { return a.key < k; });
+  if (it != t.end() && it->key == key) return &*it;
+  if (!create) return nullptr;
+  it = t.insert(it, UidCount{key, 0});
+  return &*it;
+}
+
+static String dayFilePath(const String &day) { return String(ROLLUP_PREFIX) + day + ".csv"; }
+
+// Archivo de un día: sus filas día/materia ("d") y sus registros por UID ("u").
+// Sólo el día abierto cambia, así que guardar reescribe un archivo pequeño.
+static void saveDay(const String &day) {
+  std::vector<String> lines;
+  lines.push_back(ROLLUP_HEADER);
+  for (auto &d : g_days)
+    if (d.day == day)
+      lines.push_back("\"d\",\"\",\"" + String(d.materiaId) + "\",\"" + String(d.records) + "\",\"" + String(d.students) + "\"");
+  char key[17];
+  for (auto &u : g_dayUids) {
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long)u.key);
+    lines.push_back("\"u\",\"" + String(key) + "\",\"\",\"" + String(u.records) + "\",\"\"");
+  }
+  // sin el archivo el día no cuadra con el manifiesto y se reconstruye al arrancar
+  if (!writeAllLines(dayFilePath(day).c_str(), lines)) SPIFFS.remove(dayFilePath(day));
+}
+
+// Lee el archivo de un día: filas "d" a g_days (si 'days') y "u" a 'uids' (sin ordenar).
+static bool loadDay(const String &day, bool days, std::vector<UidCount> &uids) {
+  File f = SPIFFS.open(dayFilePath(day), FILE_READ);
+  if (!f) return false;
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() < 4) continue;
+    if (r[0].equals("d") && days) {
+      AttDayCount d;
+      d.day = day;
+      d.materiaId = (CatalogId)r[2].toInt();
+      d.records = (uint32_t)r[3].toInt();
+      d.students = (uint16_t)r[4].toInt();
+      g_days.push_back(d);
+    } else if (r[0].equals("u")) {
+      uids.push_back(UidCount{(uint64_t)strtoull(r.str(1).c_str(), nullptr, 16), (uint32_t)r[3].toInt()});
+    }
+  }
+  f.close();
+  return true;
+}
+
+// Ordena y suma las claves repetidas.
+static void mergeUids(std::vector<UidCount> &t) {
+  std::sort(t.begin(), t.end(), [](const UidCount &a, const UidCount &b) { return a.key < b.key; });
+  size_t w = 0;
+  for (size_t i = 0; i < t.size(); ++i) {
+    if (w && t[w - 1].key == t[i].key) t[w - 1].records += t[i].records;
+    else t[w++] = t[i];
+  }
+  t.resize(w);
+}
+
+// Pasa a recibir registros de 'day': guarda el día anterior si cambió y carga
+// los registros por UID de 'day' desde su archivo ('load' = false al reconstruir).
+static void openDay(const String &day, bool load) {
+  if (day == g_openDay) return;
+  if (g_dirty && g_openDay.length()) saveDay(g_openDay);
+  g_dirty = false;
+  g_open.clear();
+  g_dayUids.clear();
+  g_openDay = day;
+  if (load && loadDay(day, false, g_dayUids)) mergeUids(g_dayUids);
+}
+
+// Bytes del segmento según el manifiesto: lo registrado antes del lote en curso.
+static uint32_t segmentBytes(const String &day) {
+  for (auto &s : attSegments()) if (s.day == day) return s.bytes;
+  return 0;
+}
+
+// Conjunto de UIDs de la sesión (día abierto, materia). Si la sesión ya tenía
+// registros de antes (reinicio o cambio de día) se rellena leyendo su segmento
+// hasta el tamaño del manifiesto: las filas del lote que se está anotando ya
+// están escritas, pero se cuentan en noteRow.
+static std::vector<uint64_t> &openSession(const String &day, CatalogId mid, bool hadRecords) {
+  for (auto &s : g_open) if (s.materiaId == mid) return s.uids;
+  g_open.push_back(OpenSession{mid, std::vector<uint64_t>()});
+  std::vector<uint64_t> &seen = g_open.back().uids;
+  if (hadRecords) {
+    uint32_t limit = segmentBytes(day);
+    File f = SPIFFS.open(attSegmentPath(day), FILE_READ);
+    if (f) {
+      CsvReader r(f);
+      while (r.next()) {
+        if (limit && r.offset() >= limit) break;
+        if (isTeacherMode(r[ATT_MODE]) || r[ATT_UID].empty()) continue;
+        CsvField m = r[ATT_MATERIA];
+        if (catalogFindMateria(m.ptr, m.len) != mid) continue;
+        seen.push_back(uidKeyHash(r[ATT_UID].ptr, r[ATT_UID].len));
+      }
+      f.close();
+    }
+    std::sort(seen.begin(), seen.end());
+    seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+  }
+  return seen;
+}
+
+static void noteRow(const String &day, const CsvFields &c) {
+  openDay(day, true);
+  // sin crear entradas en el catálogo: una materia borrada o desconocida cuenta
+  // como "sin materia" (0), así los registros por día siguen cuadrando con el manifiesto
+  CsvField m = c[ATT_MATERIA];
+  CatalogId mid = catalogFindMateria(m.ptr, m.len);
+  CsvField uid = c[ATT_UID];
+  uint64_t h = uid.empty() ? 0 : uidKeyHash(uid.ptr, uid.len);
+  size_t i = dayRow(day, mid);
+  if (!uid.empty() && !isTeacherMode(c[ATT_MODE])) {
+    std::vector<uint64_t> &seen = openSession(day, mid, g_days[i].records > 0);
+    auto it = std::lower_bound(seen.begin(), seen.end(), h);
+    if (it == seen.end() || *it != h) {
+      seen.insert(it, h);
+      if (g_days[i].students < 0xFFFF) g_days[i].students++;
+    }
+  }
+  g_days[i].records++;
+  if (!uid.empty()) {
+    uidRow(g_uids, h, true)->records++;
+    uidRow(g_dayUids, h, true)->records++;
+  }
+  g_dirty = true;
+}
+
+// Carga los archivos de los días del manifiesto; los totales por UID son la suma.
+static void loadFiles() {
+  for (auto &s : attSegments()) loadDay(s.day, true, g_uids);
+  std::sort(g_days.begin(), g_days.end(), [](const AttDayCount &a, const AttDayCount &b) {
+    return dayLess(a, b.day, b.materiaId);
+  });
+  mergeUids(g_uids);
+}
+
+static void resetState() {
+  g_days.clear();
+  g_uids.clear();
+  g_open.clear();
+  g_dayUids.clear();
+  g_openDay = "";
+  g_dirty = false;
+}
+
+// Registros por día del resumen == registros por segmento del manifiesto.
+static bool matchesManifest() {
+  const auto &segs = attSegments();
+  size_t j = 0;
+  for (auto &s : segs) {
+    uint32_t n = 0;
+    while (j < g_days.size() && g_days[j].day < s.day) {
+      if (g_days[j].records) return false;   // día que ya no existe
+      j++;
+    }
+    while (j < g_days.size() && g_days[j].day == s.day) n += g_days[j++].records;
+    if (n != s.records) return false;
+  }
+  for (; j < g_days.size(); ++j) if (g_days[j].records) return false;
+  return true;
+}
+
+void attRollupBegin() {
+  resetState();
+  bool legacy = SPIFFS.exists(LEGACY_ROLLUP_FILE);
+  if (legacy) SPIFFS.remove(LEGACY_ROLLUP_FILE);   // se rehace en archivos por día
+  if (attSegments().empty()) return;
+  loadFiles();
+  if (legacy || !matchesManifest()) {
+    Serial.println("attRollup: resumen ausente o desactualizado, reconstruyendo");
+    attRollupRebuild();
+    return;
+  }
+  Serial.printf("attRollup: %u filas día/materia, %u UIDs\n", (unsigned)g_days.size(), (unsigned)g_uids.size());
+}
+
+void attRollupNoteLines(const std::vector<String> &lines, const std::vector<String> &days) {
+  CsvFields c;
+  for (size_t i = 0; i < lines.size() && i < days.size(); ++i) {
+    if (c.split(lines[i]) < 5) continue;
+    noteRow(days[i], c);
+  }
+}
+
+void attRollupDropBefore(const String &day) {
+  // los totales por UID se descuentan con los archivos de los días que se van
+  // (el día abierto, con lo que tiene en RAM: su archivo puede estar atrasado)
+  for (auto &s : attSegments()) {
+    if (!(s.day < day)) break;
+    std::vector<UidCount> gone;
+    if (s.day == g_openDay) gone = g_dayUids;
+    else loadDay(s.day, false, gone);
+    for (auto &g : gone) {
+      UidCount *u = uidRow(g_uids, g.key, false);
+      if (u) u->records = u->records > g.records ? u->records - g.records : 0;
+    }
+    SPIFFS.remove(dayFilePath(s.day));
+  }
+  g_uids.erase(std::remove_if(g_uids.begin(), g_uids.end(), [](const UidCount &u) { return u.records == 0; }), g_uids.end());
+  g_days.erase(std::remove_if(g_days.begin(), g_days.end(), [&day](const AttDayCount &d) { return d.day < day; }), g_days.end());
+  if (g_openDay.length() && g_openDay < day) { g_dirty = false; openDay("", false); }
+}
+
+void attRollupClear() {
+  // att_store ya vació el manifiesto: los días salen de las filas del resumen
+  for (size_t i = 0; i < g_days.size(); ++i)
+    if (i == 0 || g_days[i].day != g_days[i - 1].day) SPIFFS.remove(dayFilePath(g_days[i].day));
+  resetState();
+}
+
+void attRollupSave() {
+  if (g_dirty && g_openDay.length()) saveDay(g_openDay);
+  g_dirty = false;
+}
+
+uint32_t attRollupRebuild() {
+  unsigned long t0 = millis();
+  resetState();
+  uint32_t n = 0;
+  for (auto &s : attSegments()) {
+    openDay(s.day, false);   // guarda el día anterior; éste empieza vacío
+    g_dirty = true;          // también sin filas: su archivo queda en cero
+    File f = SPIFFS.open(attSegmentPath(s.day), FILE_READ);
+    if (!f) continue;
+    CsvReader r(f);
+    while (r.next()) {
+      if (r.size() < 5) continue;
+      noteRow(s.day, r);   // filas nuevas: la sesión empieza vacía, no relee el segmento
+      n++;
+    }
+    f.close();
+  }
+  attRollupSave();
+  Serial.printf("attRollup: reconstruido desde %u registros, %lums\n", (unsigned)n, millis() - t0);
+  return n;
+}
+
+std::vector<AttDayCount> attRollupForMateria(CatalogId materiaId) {
+  std::vector<AttDayCount> out;
+  for (auto &d : g_days)
+    if (d.materiaId == materiaId && d.records) out.push_back(d);
+  return out;
+}
+
+uint32_t attRollupUidTotal(const String &uid) {
+  UidCount *u = uidRow(g_uids, uidKeyHash(uid), false);
+  return u ? u->records : 0;
+}
+
+size_t attRollupRows() { return g_days.size(); }
+size_t attRollupUids() { return g_uids.size(); }
@@ -0,0 +1,348 @@
+// src/att_store.cpp
+#include "att_store.h"
+#include "att_rollup.h"
+#include "att_index.h"
+#include "config.h"
+#include "globals.h"
+#include "files_utils.h"
+#include "csv_reader.h"
+#include <SPIFFS.h>
+#include <algorithm>
+#include <string.h>
+
+static const char *ATT_DIR = "/att";
+static const char *ATT_MANIFEST_FILE = "/att/manifest.csv";
+static const char *ATT_HEADER = "\"timestamp\",\"uid\",\"name\",\"account\",\"materia\",\"mode\"";
+static const char *MANIFEST_HEADER = "\"day\",\"first_ts\",\"last_ts\",\"records\",\"bytes\"";
+static const char *NO_DATE_DAY = "0000-00-00";         // filas sin timestamp válido
+static const unsigned long MANIFEST_SAVE_MS = 30000;   // persistencia diferida del manifiesto
+static const size_t VERIFY_RECENT_SEGMENTS = 3;        // segmentos revalidados al arrancar
+
+static std::vector<AttSegment> g_segments;             // ordenados por día
+static bool g_dirty = false;
+static unsigned long g_dirtySince = 0;
+
+// --- helpers ---
+
+// Día (YYYY-MM-DD) de un timestamp "YYYY-MM-DD HH:MM:SS"; NO_DATE_DAY si no cuadra.
+static String dayOfTs(const String &ts) {
+  if (ts.length() < 10) return String(NO_DATE_DAY);
+  for (int i = 0; i < 10; ++i) {
+    char c = ts[i];
+    if (i == 4 || i == 7) { if (c != '-') return String(NO_DATE_DAY); }
+    else if (c < '0' || c > '9') return String(NO_DATE_DAY);
+  }
+  return ts.substring(0, 10);
+}
+
+// Timestamp (primer campo) de una fila "ts","uid",...
+static String tsOfRow(const String &line) {
+  int a = line.indexOf('"');
+  if (a < 0) return String();
+  int b = line.indexOf('"', a + 1);
+  if (b < 0) return String();
+  return line.substring(a + 1, b);
+}
+
+static int findSegment(const String &day) {
+  auto it = std::lower_bound(g_segments.begin(), g_segments.end(), day,
+                             [](const AttSegment &s, const String &d) { return s.day < d; });
+  if (it == g_segments.end() || it->day != day) return -1;
+  return (int)(it - g_segments.begin());
+}
+
+static void markDirty() {
+  if (!g_dirty) g_dirtySince = millis();
+  g_dirty = true;
+}
+
+// Recorre un segmento y recalcula registros/bytes/primer y último timestamp.
+static void recountSegment(AttSegment &s) {
+  s.records = 0; s.bytes = 0; s.firstTs = ""; s.lastTs = "";
+  File f = SPIFFS.open(attSegmentPath(s.day), FILE_READ);
+  if (!f) return;
+  s.bytes = (uint32_t)f.size();
+  char last[32] = "";
+  CsvReader r(f);
+  while (r.next()) {
+    CsvField ts = r[ATT_TS];
+    if (s.records == 0) s.firstTs = ts.toString();
+    size_t n = ts.len < sizeof(last) - 1 ? ts.len : sizeof(last) - 1;
+    memcpy(last, ts.ptr, n); last[n] = 0;
+    s.records++;
+  }
+  s.lastTs = last;
+  f.close();
+}
+
+// Reconstruye el manifiesto listando /att (manifiesto perdido o corrupto).
+static void rebuildFromDirectory() {
+  g_segments.clear();
+  File dir = SPIFFS.open(ATT_DIR);
+  if (dir) {
+    File e = dir.openNextFile();
+    while (e) {
+      String name = e.name();
+      e.close();
+      int slash = name.lastIndexOf('/');
+      if (slash >= 0) name = name.substring(slash + 1);   // core 1.x devuelve la ruta completa
+      if (name.length() == 14 && name.endsWith(".csv") && dayOfTs(name) == name.substring(0, 10)) {
+        AttSegment s; s.day = name.substring(0, 10);
+        recountSegment(s);
+        g_segments.push_back(s);
+      }
+      e = dir.openNextFile();
+    }
+    dir.close();
+  }
+  std::sort(g_segments.begin(), g_segments.end(),
+            [](const AttSegment &a, const AttSegment &b) { return a.day < b.day; });
+  markDirty();
+}
+
+static bool loadManifest() {
+  File f = SPIFFS.open(ATT_MANIFEST_FILE, FILE_READ);
+  if (!f) return false;
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() < 5) continue;
+    AttSegment s;
+    s.day = r.str(0); s.firstTs = r.str(1); s.lastTs = r.str(2);
+    s.records = (uint32_t)r[3].toInt(); s.bytes = (uint32_t)r[4].toInt();
+    g_segments.push_back(s);
+  }
+  f.close();
+  std::sort(g_segments.begin(), g_segments.end(),
+            [](const AttSegment &a, const AttSegment &b) { return a.day < b.day; });
+  return true;
+}
+
+// Los últimos segmentos pudieron recibir filas después de la última
+// persistencia del manifiesto (corte de energía): comparar tamaño real.
+static void verifyRecentSegments() {
+  size_t n = g_segments.size();
+  size_t from = n > VERIFY_RECENT_SEGMENTS ? n - VERIFY_RECENT_SEGMENTS : 0;
+  for (size_t i = from; i < n; ) {
+    AttSegment &s = g_segments[i];
+    String path = attSegmentPath(s.day);
+    if (!SPIFFS.exists(path)) { g_segments.erase(g_segments.begin() + i); n--; markDirty(); continue; }
+    File f = SPIFFS.open(path, FILE_READ);
+    uint32_t sz = f ? (uint32_t)f.size() : 0;
+    if (f) f.close();
+    if (sz != s.bytes) {
+      if (sz > s.bytes) attIndexSegmentFrom(s.day, s.bytes);   // filas sin indexar tras el corte
+      recountSegment(s);
+      markDirty();
+    }
+    ++i;
+  }
+}
+
+// Segmento en flash que no está en el manifiesto: un corte entre crearlo y
+// guardar el manifiesto (o un guardado fallido). Se recuenta y se sigue
+// añadiendo en lugar de recrearlo vacío; sus postings y el resumen se rehacen
+// porque el arranque no los conocía. -1 si el archivo quedó vacío (sin cabecera).
+static int adoptSegment(const String &day) {
+  String path = attSegmentPath(day);
+  File f = SPIFFS.open(path, FILE_READ);
+  uint32_t sz = f ? (uint32_t)f.size() : 0;
+  if (f) f.close();
+  if (sz == 0) { SPIFFS.remove(path); return -1; }
+  AttSegment s; s.day = day;
+  recountSegment(s);
+  auto it = std::lower_bound(g_segments.begin(), g_segments.end(), day,
+                             [](const AttSegment &a, const String &d) { return a.day < d; });
+  int idx = (int)(it - g_segments.begin());
+  g_segments.insert(it, s);
+  markDirty();
+  Serial.printf("attendance: %s fuera del manifiesto, se conservan sus %u registros\n", path.c_str(), (unsigned)s.records);
+  attIndexSegmentFrom(day, 0);   // los repetidos se descartan al leer
+  attRollupRebuild();
+  return idx;
+}
+
+// Migra el ATT_FILE único anterior a segmentos y lo elimina.
+static void migrateLegacyFile() {
+  if (!SPIFFS.exists(ATT_FILE)) return;
+  File f = SPIFFS.open(ATT_FILE, FILE_READ);
+  if (!f) return;
+  std::vector<String> batch;
+  uint32_t moved = 0;
+  bool ok = true;
+  CsvReader r(f);
+  while (ok && r.next()) {
+    batch.push_back(r.lineString());
+    if (batch.size() >= 64) { ok = attStoreAppendLines(batch); moved += batch.size(); batch.clear(); }
+  }
+  f.close();
+  if (ok && !batch.empty()) { ok = attStoreAppendLines(batch); moved += batch.size(); }
+  attStoreSaveManifest();
+  if (!ok) {
+    // se conserva el archivo anterior: mejor repetir filas en el próximo arranque que perderlas
+    Serial.printf("ERR migración de %s incompleta, se reintentará al arrancar\n", ATT_FILE);
+    return;
+  }
+  SPIFFS.remove(ATT_FILE);
+  Serial.printf("attendance: %u registros migrados a segmentos diarios\n", (unsigned)moved);
+}
+
+// --- API ---
+
+String attSegmentPath(const String &day) {
+  return String(ATT_DIR) + "/" + day + ".csv";
+}
+
+bool attHasSegment(const String &day) { return findSegment(day) >= 0; }
+
+void attStoreBegin() {
+  g_segments.clear();
+  g_dirty = false;
+  if (!loadManifest()) {
+    if (SPIFFS.exists(ATT_DIR)) rebuildFromDirectory();
+  } else {
+    verifyRecentSegments();
+  }
+  attRollupBegin();       // contadores por día/materia/UID (reconstruye si no cuadran)
+  attIndexBegin();        // postings por UID/materia (los construye si faltan)
+  migrateLegacyFile();
+  if (g_dirty) attStoreSaveManifest();
+  Serial.printf("attendance: %u segmentos, %u registros\n", (unsigned)g_segments.size(), (unsigned)attRecordCount());
+}
+
+void attStoreSaveManifest() {
+  std::vector<String> lines;
+  lines.reserve(g_segments.size() + 1);
+  lines.push_back(MANIFEST_HEADER);
+  for (auto &s : g_segments)
+    lines.push_back("\"" + s.day + "\",\"" + s.firstTs + "\",\"" + s.lastTs + "\",\"" +
+                    String(s.records) + "\",\"" + String(s.bytes) + "\"");
+  if (writeAllLines(ATT_MANIFEST_FILE, lines)) g_dirty = false;
+  attRollupSave();
+}
+
+void attStoreLoop() {
+  if (g_dirty && (millis() - g_dirtySince) >= MANIFEST_SAVE_MS) attStoreSaveManifest();
+}
+
+bool attStoreAppendLines(const std::vector<String> &lines, std::vector<size_t> *failed) {
+  if (lines.empty()) return true;
+  // agrupar por día: cada segmento se abre una sola vez por lote
+  std::vector<bool> done(lines.size(), false);
+  std::vector<uint32_t> offsets(lines.size(), 0);
+  std::vector<String> days;
+  days.reserve(lines.size());
+  for (auto &l : lines) days.push_back(dayOfTs(tsOfRow(l)));
+  std::vector<String> wroteLines, wroteDays;
+  std::vector<uint32_t> wroteOffsets;
+  bool created = false;
+  bool ok = true;
+
+  for (size_t i = 0; i < lines.size(); ++i) {
+    if (done[i]) continue;
+    const String day = days[i];
+    std::vector<size_t> group;
+    for (size_t j = i; j < lines.size(); ++j)
+      if (!done[j] && days[j] == day) { group.push_back(j); done[j] = true; }
+
+    int idx = findSegment(day);
+    String path = attSegmentPath(day);
+    if (idx < 0 && SPIFFS.exists(path)) {
+      idx = adoptSegment(day);
+      if (idx >= 0) created = true;   // entra al manifiesto ya
+    }
+    File f = SPIFFS.open(path, idx < 0 ? FILE_WRITE : FILE_APPEND);
+    if (!f) {
+      Serial.printf("ERR append %s (%u registros pendientes)\n", path.c_str(), (unsigned)group.size());
+      if (failed) failed->insert(failed->end(), group.begin(), group.end());
+      ok = false;
+      continue;
+    }
+    if (idx < 0) {
+      f.println(ATT_HEADER);
+      AttSegment s; s.day = day; s.records = 0; s.bytes = 0;
+      auto it = std::lower_bound(g_segments.begin(), g_segments.end(), day,
+                                 [](const AttSegment &a, const String &d) { return a.day < d; });
+      idx = (int)(it - g_segments.begin());
+      g_segments.insert(it, s);
+      created = true;
+    }
+    AttSegment &s = g_segments[idx];
+    std::vector<String> gl, gd;   // filas de este día realmente escritas
+    uint32_t off = (uint32_t)f.size();
+    for (size_t k = 0; k < group.size(); ++k) {
+      size_t j = group[k];
+      size_t want = lines[j].length() + 2;   // println añade "\r\n"
+      if (f.println(lines[j]) != want) {
+        Serial.printf("ERR append %s: escritura incompleta (%u registros pendientes)\n",
+                      path.c_str(), (unsigned)(group.size() - k));
+        if (failed) failed->insert(failed->end(), group.begin() + k, group.end());
+        ok = false;
+        break;
+      }
+      offsets[j] = off;
+      off += want;
+      String ts = tsOfRow(lines[j]);
+      if (s.records == 0) s.firstTs = ts;
+      s.lastTs = ts;
+      s.records++;
+      gl.push_back(lines[j]);
+      gd.push_back(day);
+      wroteLines.push_back(lines[j]);
+      wroteDays.push_back(day);
+      wroteOffsets.push_back(offsets[j]);
+    }
+    f.close();
+    // el resumen sólo cuenta lo escrito; antes de mover s.bytes, que es hasta
+    // donde relee el segmento (así no cuenta dos veces estas filas)
+    attRollupNoteLines(gl, gd);
+    s.bytes = off;
+  }
+  attIndexNoteLines(wroteLines, wroteDays, wroteOffsets);
+  markDirty();
+  // un segmento nuevo se registra de inmediato para no perderlo tras un corte
+  if (created) attStoreSaveManifest();
+  return ok;
+}
+
+const std::vector<AttSegment> &attSegments() { return g_segments; }
+
+std::vector<String> attSegmentPathsFor(const String &tsPrefix) {
+  std::vector<String> res;
+  if (tsPrefix.length() >= 10) {
+    int idx = findSegment(tsPrefix.substring(0, 10));
+    if (idx >= 0) res.push_back(attSegmentPath(g_segments[idx].day));
+    return res;
+  }
+  for (auto &s : g_segments)
+    if (s.day.startsWith(tsPrefix)) res.push_back(attSegmentPath(s.day));
+  return res;
+}
+
+void attStoreClear() {
+  for (auto &s : g_segments) SPIFFS.remove(attSegmentPath(s.day));
+  g_segments.clear();
+  attRollupClear();
+  attIndexClear();
+  attStoreSaveManifest();
+}
+
+int attStoreDropBefore(const String &day) {
+  int dropped = 0;
+  attRollupDropBefore(day);
+  while (!g_segments.empty() && g_segments.front().day < day) {
+    SPIFFS.remove(attSegmentPath(g_segments.front().day));
+    g_segments.erase(g_segments.begin());
+    dropped++;
+  }
+  if (dropped) {
+    attIndexDropBefore(day);
+    attStoreSaveManifest();
+  }
+  return dropped;
+}
+
+uint32_t attRecordCount() {
+  uint32_t n = 0;
+  for (auto &s : g_segments) n += s.records;
+  return n;
+}
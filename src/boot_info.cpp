@@ -0,0 +1,24 @@
+// src/boot_info.cpp
+#include "boot_info.h"
+
+static volatile uint32_t g_accessReady = 0;
+static volatile uint32_t g_netReady = 0;
+static volatile uint32_t g_timeSynced = 0;
+static volatile uint32_t g_firstTap = 0;
+
+// millis() puede ser 0 justo al arrancar: se guarda al menos 1 para distinguirlo de "aún no".
+static void mark(volatile uint32_t &slot) {
+  if (slot) return;
+  uint32_t now = millis();
+  slot = now ? now : 1;
+}
+
+void bootMarkAccessReady() { mark(g_accessReady); }
+void bootMarkNetReady() { mark(g_netReady); }
+void bootMarkTimeSynced() { mark(g_timeSynced); }
+void bootMarkFirstTap() { mark(g_firstTap); }
+
+uint32_t bootAccessReadyMs() { return g_accessReady; }
+uint32_t bootNetReadyMs() { return g_netReady; }
+uint32_t bootTimeSyncedMs() { return g_timeSynced; }
+uint32_t bootFirstTapMs() { return g_firstTap; }
@@ -0,0 +1,101 @@
+// src/card_journal.cpp
+#include <Arduino.h>
+#include <esp_system.h>
+#include <atomic>
+#include <string.h>
+
+#include "card_journal.h"
+#include "log_writer.h"
+
+static const uint32_t JOURNAL_MAGIC = 0x434A5232UL;   // "CJR2": CardEvent con UidKey
+static const uint32_t JOURNAL_SLOTS = 64;             // potencia de 2
+
+struct JournalSlot {
+  CardEvent ev;
+  uint32_t seq;
+  uint32_t check;
+};
+
+struct Journal {
+  uint32_t magic;
+  volatile uint32_t head;        // siguiente seq a escribir (núcleo de acceso)
+  volatile uint32_t committed;   // seqs anteriores ya en flash (núcleo web)
+  JournalSlot slots[JOURNAL_SLOTS];
+};
+
+RTC_NOINIT_ATTR static Journal g_journal;
+
+static uint32_t g_read = 0;       // siguiente seq a entregar (núcleo web, sólo RAM)
+static uint32_t g_bootHead = 0;   // seqs < g_bootHead vienen de antes del reinicio
+static uint32_t g_replayed = 0;
+static uint32_t g_drops = 0;
+
+static uint32_t slotCheck(const JournalSlot &s) {
+  uint32_t h = 2166136261UL ^ s.seq;
+  const uint8_t *p = (const uint8_t *)&s.ev;
+  for (size_t i = 0; i < sizeof(s.ev); ++i) { h ^= p[i]; h *= 16777619UL; }
+  return h;
+}
+
+static void resetJournal() {
+  memset(&g_journal, 0, sizeof(g_journal));
+  g_journal.magic = JOURNAL_MAGIC;
+}
+
+static void onShutdown() {
+  logWriterSync();       // por si su handler aún no corrió
+  cardJournalCommit();
+}
+
+void cardJournalBegin() {
+  esp_reset_reason_t why = esp_reset_reason();
+  bool soft = (why != ESP_RST_POWERON && why != ESP_RST_BROWNOUT && why != ESP_RST_UNKNOWN);
+  if (!soft || g_journal.magic != JOURNAL_MAGIC || g_journal.head - g_journal.committed > JOURNAL_SLOTS) {
+    resetJournal();
+  } else {
+    // se conserva el tramo pendiente hasta la primera casilla incompleta
+    uint32_t seq = g_journal.committed;
+    for (; seq != g_journal.head; ++seq) {
+      const JournalSlot &s = g_journal.slots[seq & (JOURNAL_SLOTS - 1)];
+      if (s.seq != seq || s.check != slotCheck(s)) break;
+    }
+    g_journal.head = seq;
+    g_replayed = seq - g_journal.committed;
+    if (g_replayed) Serial.printf("cardJournal: %u lecturas sin registrar antes del reinicio\n", (unsigned)g_replayed);
+  }
+  g_read = g_journal.committed;
+  g_bootHead = g_journal.head;
+  esp_register_shutdown_handler(onShutdown);
+}
+
+bool cardJournalPush(const CardEvent &ev) {
+  uint32_t head = g_journal.head;
+  if (head - g_journal.committed >= JOURNAL_SLOTS) { g_drops++; return false; }
+  JournalSlot &s = g_journal.slots[head & (JOURNAL_SLOTS - 1)];
+  s.ev = ev;
+  s.seq = head;
+  s.check = slotCheck(s);
+  std::atomic_thread_fence(std::memory_order_release);   // casilla completa antes de publicarla
+  g_journal.head = head + 1;
+  return true;
+}
+
+bool cardJournalNext(CardEvent &ev, bool &replayed) {
+  if (g_read == g_journal.head) return false;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const JournalSlot &s = g_journal.slots[g_read & (JOURNAL_SLOTS - 1)];
+  ev = s.ev;
+  replayed = (int32_t)(g_read - g_bootHead) < 0;
+  g_read++;
+  return true;
+}
+
+void cardJournalCommit() {
+  if (g_journal.committed == g_read) return;
+  std::atomic_thread_fence(std::memory_order_release);
+  g_journal.committed = g_read;
+}
+
+uint32_t cardJournalPending() { return g_journal.head - g_journal.committed; }
+uint32_t cardJournalReplayed() { return g_replayed; }
+uint32_t cardJournalDrops() { return g_drops; }
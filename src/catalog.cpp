@@ -0,0 +1,174 @@
+// src/catalog.cpp
+#include "catalog.h"
+#include "config.h"
+#include "globals.h"
+#include "files_utils.h"
+#include "csv_reader.h"
+#include <SPIFFS.h>
+#include <ctype.h>
+#include <string.h>
+
+static const char *CATALOG_FILE = "/catalog.csv";
+static const char *CATALOG_HEADER = "\"kind\",\"id\",\"name\",\"materia_id\",\"profesor_id\"";
+
+struct NameEntry {
+  uint32_t hash;    // hash del nombre normalizado
+  String name;      // nombre tal como se registró
+};
+
+struct CourseEntry {
+  CatalogId materiaId;
+  CatalogId profesorId;
+};
+
+// El ID es la posición + 1 (0 = ninguno)
+static std::vector<NameEntry> g_materias;
+static std::vector<NameEntry> g_profesores;
+static std::vector<CourseEntry> g_courses;
+static const String EMPTY_NAME;
+
+// Recorta espacios extremos (como String::trim) sin copiar.
+static void trimView(const char *&p, size_t &n) {
+  while (n && isspace((unsigned char)*p)) { p++; n--; }
+  while (n && isspace((unsigned char)p[n - 1])) n--;
+}
+
+// FNV-1a sobre el nombre en minúsculas
+static uint32_t foldHash(const char *p, size_t n) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < n; ++i) { h ^= (uint8_t)tolower((unsigned char)p[i]); h *= 16777619UL; }
+  return h;
+}
+
+static bool foldEquals(const String &a, const char *p, size_t n) {
+  if (a.length() != n) return false;
+  for (size_t i = 0; i < n; ++i)
+    if (tolower((unsigned char)a[i]) != tolower((unsigned char)p[i])) return false;
+  return true;
+}
+
+static CatalogId findName(const std::vector<NameEntry> &tab, const char *p, size_t n) {
+  trimView(p, n);
+  if (n == 0) return 0;
+  uint32_t h = foldHash(p, n);
+  for (size_t i = 0; i < tab.size(); ++i)
+    if (tab[i].hash == h && foldEquals(tab[i].name, p, n)) return (CatalogId)(i + 1);
+  return 0;
+}
+
+static void ensureFile() {
+  if (SPIFFS.exists(CATALOG_FILE)) return;
+  File f = SPIFFS.open(CATALOG_FILE, FILE_WRITE);
+  if (f) { f.println(CATALOG_HEADER); f.close(); }
+}
+
+static void appendRow(const char *kind, CatalogId id, const String &name, CatalogId mid, CatalogId pid) {
+  ensureFile();
+  String line = "\"" + String(kind) + "\",\"" + String(id) + "\",\"" + name + "\",\"" +
+                (mid ? String(mid) : String()) + "\",\"" + (pid ? String(pid) : String()) + "\"";
+  appendLineToFile(CATALOG_FILE, line);
+}
+
+static CatalogId internName(std::vector<NameEntry> &tab, const char *kind, const String &name) {
+  const char *p = name.c_str();
+  size_t n = name.length();
+  trimView(p, n);
+  if (n == 0) return 0;
+  CatalogId id = findName(tab, p, n);
+  if (id) return id;
+  if (tab.size() >= 0xFFFF) { Serial.printf("ERR catalog lleno (%s)\n", kind); return 0; }
+  NameEntry e;
+  e.hash = foldHash(p, n);
+  e.name = name;
+  e.name.trim();
+  tab.push_back(e);
+  id = (CatalogId)tab.size();
+  appendRow(kind, id, e.name, 0, 0);
+  return id;
+}
+
+// Coloca la fila leída en su ID (el archivo se escribe en orden, pero se tolera un hueco).
+static void placeName(std::vector<NameEntry> &tab, CatalogId id, const String &name) {
+  if (id == 0) return;
+  if (tab.size() < id) tab.resize(id);
+  NameEntry &e = tab[id - 1];
+  e.name = name;
+  e.hash = foldHash(name.c_str(), name.length());
+}
+
+void catalogBegin() {
+  g_materias.clear();
+  g_profesores.clear();
+  g_courses.clear();
+  ensureFile();
+  File f = SPIFFS.open(CATALOG_FILE, FILE_READ);
+  if (f) {
+    CsvReader r(f);
+    while (r.next()) {
+      if (r.size() < 5) continue;
+      CatalogId id = (CatalogId)r[1].toInt();
+      if (r[0].equals("m")) placeName(g_materias, id, r.str(2));
+      else if (r[0].equals("p")) placeName(g_profesores, id, r.str(2));
+      else if (r[0].equals("c") && id) {
+        if (g_courses.size() < id) g_courses.resize(id, CourseEntry{0, 0});
+        g_courses[id - 1].materiaId = (CatalogId)r[3].toInt();
+        g_courses[id - 1].profesorId = (CatalogId)r[4].toInt();
+      }
+    }
+    f.close();
+  }
+  // registra materias/profesores/cursos que aún no tengan ID
+  loadCourses();
+  Serial.printf("catalog: %u materias, %u profesores, %u cursos\n",
+                (unsigned)g_materias.size(), (unsigned)g_profesores.size(), (unsigned)g_courses.size());
+}
+
+CatalogId catalogFindMateria(const char *name, size_t len) { return findName(g_materias, name, len); }
+CatalogId catalogFindMateria(const String &name) { return findName(g_materias, name.c_str(), name.length()); }
+CatalogId catalogFindProfesor(const char *name, size_t len) { return findName(g_profesores, name, len); }
+CatalogId catalogFindProfesor(const String &name) { return findName(g_profesores, name.c_str(), name.length()); }
+
+CatalogId catalogFindCourse(CatalogId materiaId, CatalogId profesorId) {
+  if (!materiaId || !profesorId) return 0;
+  for (size_t i = 0; i < g_courses.size(); ++i)
+    if (g_courses[i].materiaId == materiaId && g_courses[i].profesorId == profesorId) return (CatalogId)(i + 1);
+  return 0;
+}
+
+CatalogId catalogMateriaId(const String &name) { return internName(g_materias, "m", name); }
+CatalogId catalogProfesorId(const String &name) { return internName(g_profesores, "p", name); }
+
+CatalogId catalogCourseId(CatalogId materiaId, CatalogId profesorId) {
+  CatalogId id = catalogFindCourse(materiaId, profesorId);
+  if (id || !materiaId || !profesorId) return id;
+  if (g_courses.size() >= 0xFFFF) { Serial.println("ERR catalog lleno (c)"); return 0; }
+  g_courses.push_back(CourseEntry{materiaId, profesorId});
+  id = (CatalogId)g_courses.size();
+  appendRow("c", id, String(), materiaId, profesorId);
+  return id;
+}
+
+void catalogParseOwner(const String &owner, CatalogId &materiaId, CatalogId &profesorId) {
+  int sep = owner.indexOf("||");
+  if (sep < 0) {
+    materiaId = catalogMateriaId(owner);
+    profesorId = 0;
+    return;
+  }
+  materiaId = catalogMateriaId(owner.substring(0, sep));
+  profesorId = catalogProfesorId(owner.substring(sep + 2));
+}
+
+const String &catalogMateriaName(CatalogId id) {
+  return (id && id <= g_materias.size()) ? g_materias[id - 1].name : EMPTY_NAME;
+}
+
+const String &catalogProfesorName(CatalogId id) {
+  return (id && id <= g_profesores.size()) ? g_profesores[id - 1].name : EMPTY_NAME;
+}
+
+size_t catalogMateriaCount() { return g_materias.size(); }
+
+size_t catalogSize() {
+  return g_materias.size() + g_profesores.size() + g_courses.size();
+}
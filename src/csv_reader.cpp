@@ -0,0 +1,186 @@
+// src/csv_reader.cpp
+#include "csv_reader.h"
+#include "row_log.h"
+#include <algorithm>
+#include <string.h>
+#include <ctype.h>
+
+// --- CsvField ---
+
+bool CsvField::equals(const char *s) const {
+  size_t n = strlen(s);
+  return n == len && memcmp(ptr, s, len) == 0;
+}
+
+bool CsvField::equalsIgnoreCase(const String &s) const {
+  if (s.length() != len) return false;
+  for (size_t i = 0; i < len; ++i)
+    if (tolower((unsigned char)ptr[i]) != tolower((unsigned char)s[i])) return false;
+  return true;
+}
+
+bool CsvField::containsIgnoreCase(const String &needle) const {
+  size_t n = needle.length();
+  if (n == 0) return true;
+  if (n > len) return false;
+  for (size_t i = 0; i + n <= len; ++i) {
+    size_t j = 0;
+    while (j < n && tolower((unsigned char)ptr[i + j]) == tolower((unsigned char)needle[j])) j++;
+    if (j == n) return true;
+  }
+  return false;
+}
+
+CsvField CsvField::trimmed() const {
+  size_t a = 0, b = len;
+  while (a < b && isspace((unsigned char)ptr[a])) a++;
+  while (b > a && isspace((unsigned char)ptr[b - 1])) b--;
+  return CsvField{ ptr + a, b - a };
+}
+
+long CsvField::toInt() const {
+  char tmp[16];
+  size_t n = len < sizeof(tmp) - 1 ? len : sizeof(tmp) - 1;
+  memcpy(tmp, ptr, n);
+  tmp[n] = 0;
+  return atol(tmp);
+}
+
+String CsvField::toString() const {
+  String s;
+  if (len == 0) return s;
+  s.reserve(len);
+  char tmp[33];
+  for (size_t i = 0; i < len; ) {
+    size_t n = len - i < sizeof(tmp) - 1 ? len - i : sizeof(tmp) - 1;
+    memcpy(tmp, ptr + i, n);
+    tmp[n] = 0;
+    s += tmp;
+    i += n;
+  }
+  return s;
+}
+
+// --- CsvFields ---
+
+// Un campo va de comilla a comilla; sólo se guardan offsets sobre la línea.
+size_t CsvFields::split(const char *line, size_t n) {
+  _base = line;
+  _count = 0;
+  size_t i = 0;
+  while (i < n && _count < CSV_MAX_FIELDS) {
+    while (i < n && line[i] != '"') i++;   // buscar comilla inicial
+    if (i >= n) break;
+    size_t start = i + 1;
+    const char *q = (const char *)memchr(line + start, '"', n - start);
+    size_t end = q ? (size_t)(q - line) : n;  // sin comilla de cierre -> el resto
+    _start[_count] = (uint16_t)start;
+    _len[_count] = (uint16_t)(end - start);
+    _count++;
+    if (!q) break;
+    i = end + 1;
+    if (i < n && line[i] == ',') i++;
+  }
+  return _count;
+}
+
+CsvField CsvFields::operator[](size_t i) const {
+  if (i >= _count) return CsvField{ "", 0 };
+  return CsvField{ _base + _start[i], _len[i] };
+}
+
+// --- CsvReader ---
+
+CsvReader::CsvReader(File &f, bool skipHeader) : _f(f) {
+  _chunkBase = (uint32_t)_f.position();
+  _dead = rowLogDeadRows(_f.path());
+  if (skipHeader) readLine();
+}
+
+// Lee hasta '\n' (exclusive) a _line; false sólo al final del archivo.
+bool CsvReader::readLine() {
+  size_t n = 0;
+  bool any = false;
+  _truncated = false;
+  _rowOff = _chunkBase + _chunkPos;
+  while (true) {
+    if (_chunkPos >= _chunkLen) {
+      _chunkBase += _chunkLen;
+      _chunkLen = _f.read((uint8_t *)_chunk, sizeof(_chunk));
+      _chunkPos = 0;
+      if (_chunkLen == 0 || _chunkLen > sizeof(_chunk)) { _chunkLen = 0; break; }
+    }
+    char ch = _chunk[_chunkPos++];
+    any = true;
+    if (ch == '\n') break;
+    if (n < CSV_LINE_MAX - 1) _line[n++] = ch;
+    else _truncated = true;
+  }
+  _line[n] = 0;
+  // equivalente a String::trim()
+  size_t a = 0;
+  while (a < n && isspace((unsigned char)_line[a])) a++;
+  while (n > a && isspace((unsigned char)_line[n - 1])) _line[--n] = 0;
+  _lineStart = a;
+  _lineLen = n - a;
+  return any;
+}
+
+bool CsvReader::next() {
+  while (readLine()) {
+    if (_lineLen == 0) continue;
+    if (_dead && std::binary_search(_dead->begin(), _dead->end(), _rowOff)) continue;
+    split(_line + _lineStart, _lineLen);
+    return true;
+  }
+  _count = 0;
+  return false;
+}
+
+String CsvReader::lineString() {
+  if (!_truncated) return String(line());   // _line ya termina en '\0' tras el trim
+  // línea mayor que el búfer: releerla del archivo y volver a donde estábamos
+  uint32_t resume = _chunkBase + _chunkLen;
+  _f.seek(_rowOff);
+  String s = _f.readStringUntil('\n');
+  s.trim();
+  _f.seek(resume);
+  return s;
+}
+
+// --- Lectura desde el final ---
+
+uint32_t csvTailOffset(File &f, size_t limit, bool skipHeader) {
+  uint32_t size = (uint32_t)f.size();
+  if (limit == 0) return size;
+  const std::vector<uint32_t> *dead = rowLogDeadRows(f.path());
+  char buf[CSV_CHUNK];
+  uint32_t pos = size;      // inicio del bloque ya recorrido
+  uint32_t start = size;    // fila más antigua aceptada
+  size_t found = 0;
+  bool blank = true;        // la línea en curso (hacia atrás) sólo tiene espacios
+  while (pos > 0 && found < limit) {
+    size_t n = pos > CSV_CHUNK ? CSV_CHUNK : pos;
+    pos -= (uint32_t)n;
+    if (!f.seek(pos)) break;
+    n = f.read((uint8_t *)buf, n);
+    for (size_t i = n; i-- > 0; ) {
+      char ch = buf[i];
+      if (ch != '\n') {
+        if (!isspace((unsigned char)ch)) blank = false;
+        continue;
+      }
+      uint32_t lineStart = pos + (uint32_t)i + 1;
+      if (!blank && !(dead && std::binary_search(dead->begin(), dead->end(), lineStart))) {
+        start = lineStart;
+        if (++found >= limit) break;
+      }
+      blank = true;
+    }
+  }
+  // la primera línea del archivo no tiene '\n' delante
+  if (pos == 0 && found < limit && !skipHeader && !blank &&
+      !(dead && std::binary_search(dead->begin(), dead->end(), (uint32_t)0)))
+    start = 0;
+  return start;
+}
@@ -36,6 +36,11 @@ static bool g_lastWasCapture = false;
 static bool g_lastCaptureBatch = false;
 static String g_lastCaptureUID = String();
 
+// Pantalla de acceso concedido/denegado: updateDisplay() vuelve a la espera
+// pasado ACCESS_SCREEN_MS; otra tarjeta antes de eso la reemplaza.
+static bool g_accessScreenActive = false;
+static unsigned long g_accessScreenStart = 0;
+
 // Estado de mensajes rojos temporales
 static bool g_showTempMessage = false;
 static String g_tempMessage = "";
@@ -43,6 +48,16 @@ static unsigned long g_tempMessageStart = 0;
 static unsigned long g_tempMessageDuration = 0;
 static bool g_tempMessageActive = false;
 
+// La pantalla se dibuja desde los dos núcleos: resultado de acceso y
+// updateDisplay() desde loop(), QR y captura desde los handlers web. Cada
+// función pública toma este mutex (recursivo: unas llaman a otras).
+static SemaphoreHandle_t g_lock = nullptr;
+
+struct DisplayLock {
+  DisplayLock() { if (g_lock) xSemaphoreTakeRecursive(g_lock, portMAX_DELAY); }
+  ~DisplayLock() { if (g_lock) xSemaphoreGiveRecursive(g_lock); }
+};
+
 // ---------------------------------------------------------
 // Funciones de dibujo básicas
 // ---------------------------------------------------------
@@ -168,6 +183,8 @@ static void drawTemporaryRedMessageNow(const String &msg) {
 // Inicialización
 // ---------------------------------------------------------
 void displayInit() {
+  if (!g_lock) g_lock = xSemaphoreCreateRecursiveMutex();
+  DisplayLock lock;
   tft.initR(INITR_BLACKTAB);
   tft.setRotation(1);
   tft.fillScreen(ST77XX_BLACK);
@@ -182,6 +199,8 @@ void displayInit() {
 
 // Pantalla principal
 void showWaitingMessage() {
+  DisplayLock lock;
+  g_accessScreenActive = false;
   g_lastWasQR = false;
   g_lastQRUrl = String();
   g_lastWasCapture = false;
@@ -201,6 +220,7 @@ void showWaitingMessage() {
 // Acceso concedido
 // ---------------------------------------------------------
 void showAccessGranted(const String &name, const String &materia, const String &uid) {
+  DisplayLock lock;
   g_showTempMessage = false;
   g_tempMessageActive = false;
 
@@ -224,16 +244,15 @@ void showAccessGranted(const String &name, const String &materia, const String &
 
   ledGreenOn();
 
-  unsigned long start = millis();
-  while (millis() - start < ACCESS_SCREEN_MS) delay(10);
-
-  showWaitingMessage();
+  g_accessScreenActive = true;
+  g_accessScreenStart = millis();
 }
 
 // ---------------------------------------------------------
 // Acceso denegado
 // ---------------------------------------------------------
 void showAccessDenied(const String &reason, const String &uid) {
+  DisplayLock lock;
   g_showTempMessage = false;
   g_tempMessageActive = false;
 
@@ -258,16 +277,16 @@ void showAccessDenied(const String &reason, const String &uid) {
 
   ledRedOn();
 
-  unsigned long start = millis();
-  while (millis() - start < ACCESS_SCREEN_MS) delay(10);
-
-  showWaitingMessage();
+  g_accessScreenActive = true;
+  g_accessScreenStart = millis();
 }
 
 // ---------------------------------------------------------
 // Mostrar QR
 // ---------------------------------------------------------
 void showQRCodeOnDisplay(const String &url, int pixelBoxSize) {
+  DisplayLock lock;
+  g_accessScreenActive = false;
   using qrcodegen::QrCode;
   QrCode qr = QrCode::encodeText(url.c_str(), static_cast<qrcodegen::QrCode::Ecc>(0));
   int s = qr.getSize();
@@ -328,6 +347,7 @@ void showQRCodeOnDisplay(const String &url, int pixelBoxSize) {
 }
 
 void showSelfRegisterBanner(const String &) {
+  DisplayLock lock;
   int h = 18;
   tft.fillRect(0, 0, tft.width(), h, ST77XX_BLACK);
   tft.drawFastHLine(0, h-1, tft.width(), ST77XX_WHITE);
@@ -338,6 +358,7 @@ void showSelfRegisterBanner(const String &) {
 // Modo captura
 // ---------------------------------------------------------
 void showCaptureMode(bool batch, bool paused) {
+  DisplayLock lock;
   int bannerH = 18;
   int y = 22;
 
@@ -358,6 +379,8 @@ void showCaptureMode(bool batch, bool paused) {
 // Pantalla de captura en progreso
 // ---------------------------------------------------------
 void showCaptureInProgress(bool batch, const String &uid) {
+  DisplayLock lock;
+  g_accessScreenActive = false;
   g_lastWasCapture = true;
   g_lastCaptureBatch = batch;
   g_lastCaptureUID = uid;
@@ -421,6 +444,7 @@ void showCaptureInProgress(bool batch, const String &uid) {
 // Mensajes rojos temporales
 // ---------------------------------------------------------
 void showTemporaryRedMessage(const String &msg, unsigned long durationMs) {
+  DisplayLock lock;
   if (durationMs == 0) durationMs = TEMP_RED_MS;
   if (g_tempMessageActive) return;
 
@@ -441,6 +465,11 @@ bool isTemporaryMessageActive() {
 // Actualización de pantalla
 // ---------------------------------------------------------
 void updateDisplay() {
+  DisplayLock lock;
+  if (g_accessScreenActive && millis() - g_accessScreenStart >= ACCESS_SCREEN_MS) {
+    showWaitingMessage();
+    return;
+  }
   if (g_tempMessageActive) {
     if (millis() - g_tempMessageStart >= g_tempMessageDuration) {
       g_showTempMessage = false;
@@ -462,6 +491,7 @@ void updateDisplay() {
 // Cancelar captura
 // ---------------------------------------------------------
 void cancelCaptureAndReturnToNormal() {
+  DisplayLock lock;
   g_lastWasQR = false;
   g_lastQRUrl = String();
   g_lastWasCapture = false;
@@ -0,0 +1,88 @@
+// src/door.cpp
+#include <Arduino.h>
+
+// La librería de Servo va antes de globals.h (ver rfid_handler.cpp)
+#if defined(ARDUINO_ARCH_ESP32)
+  #include <ESP32Servo.h>
+#else
+  #include <Servo.h>
+#endif
+
+#include "door.h"
+#include "config.h"
+#include "globals.h"
+
+enum DoorState { DOOR_CLOSED, DOOR_OPENING, DOOR_HOLD, DOOR_RELOCKING };
+
+static DoorState g_state = DOOR_CLOSED;
+static unsigned long g_phaseStart = 0;     // inicio de la fase actual
+static unsigned long g_lastGrant = 0;      // último doorOpen(): la espera cuenta desde aquí
+static uint32_t g_cycles = 0;
+static uint32_t g_retriggers = 0;
+
+static void enter(DoorState s) {
+  g_state = s;
+  g_phaseStart = millis();
+}
+
+void doorBegin() {
+  Serial.printf("Inicializando servo. Pin esperado (SERVO_PIN) = %d\n", SERVO_PIN);
+  puerta.attach(SERVO_PIN);
+  puerta.write(DOOR_CLOSED_ANGLE);
+  enter(DOOR_CLOSED);
+  Serial.printf("Servo attach OK. Posición inicial %d.\n", DOOR_CLOSED_ANGLE);
+}
+
+void doorOpen() {
+  g_lastGrant = millis();
+  switch (g_state) {
+    case DOOR_CLOSED:
+      puerta.write(DOOR_OPEN_ANGLE);
+      g_cycles++;
+      enter(DOOR_OPENING);
+      break;
+    case DOOR_RELOCKING:
+      puerta.write(DOOR_OPEN_ANGLE);   // se estaba cerrando: reabrir sin contar otro ciclo
+      g_retriggers++;
+      enter(DOOR_OPENING);
+      break;
+    case DOOR_OPENING:
+    case DOOR_HOLD:
+      g_retriggers++;                  // ya abierta: sólo se alarga la espera
+      break;
+  }
+}
+
+void doorLoop() {
+  unsigned long now = millis();
+  switch (g_state) {
+    case DOOR_CLOSED:
+      break;
+    case DOOR_OPENING:
+      if (now - g_phaseStart >= DOOR_TRAVEL_MS) enter(DOOR_HOLD);
+      break;
+    case DOOR_HOLD:
+      if (now - g_lastGrant >= DOOR_HOLD_MS) {
+        puerta.write(DOOR_CLOSED_ANGLE);
+        enter(DOOR_RELOCKING);
+      }
+      break;
+    case DOOR_RELOCKING:
+      if (now - g_phaseStart >= DOOR_TRAVEL_MS) enter(DOOR_CLOSED);
+      break;
+  }
+}
+
+bool doorIsOpen() { return g_state == DOOR_OPENING || g_state == DOOR_HOLD; }
+
+const char *doorStateName() {
+  switch (g_state) {
+    case DOOR_OPENING:   return "abriendo";
+    case DOOR_HOLD:      return "abierta";
+    case DOOR_RELOCKING: return "cerrando";
+    default:             return "cerrada";
+  }
+}
+
+uint32_t doorOpenCycles() { return g_cycles; }
+uint32_t doorRetriggers() { return g_retriggers; }
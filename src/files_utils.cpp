@@ -2,53 +2,68 @@
 #include "files_utils.h"
 #include "config.h"
 #include "globals.h"
+#include "uid_index.h"
+#include "log_writer.h"
+#include "csv_reader.h"
+#include "row_log.h"
+#include "catalog.h"
+#include "notif_store.h"
+#include "schedule_table.h"
+#include "access_table.h"
 #include <SPIFFS.h>
 #include <algorithm>
+#include <string.h>
 
-// --- Parseo CSV (líneas con campos entre comillas) ---
-std::vector<String> parseQuotedCSVLine(const String &line) {
-  std::vector<String> cols;
-  int i = 0;
-  int n = line.length();
-  while (i < n) {
-    // buscar comilla inicial
-    while (i < n && line[i] != '"') i++;
-    if (i >= n) break;
-    int start = i + 1;
-    int end = line.indexOf('"', start);
-    if (end == -1) {
-      // sin comilla de cierre -> tomar el resto
-      cols.push_back(line.substring(start));
-      break;
-    }
-    cols.push_back(line.substring(start, end));
-    i = end + 1;
-    if (i < n && line[i] == ',') i++;
-  }
-  return cols;
+// Lectura de CSV: ver csv_reader.h (CsvReader / CsvFields).
+
+// Generación de COURSES_FILE / SCHEDULES_FILE: cambia con cada escritura y
+// decide si las tablas en caché (loadCourses/loadSchedules) siguen vigentes.
+static uint32_t g_coursesGen = 1;
+static uint32_t g_schedulesGen = 1;
+
+static void bumpGeneration(const char *path) {
+  if (strcmp(path, COURSES_FILE) == 0) g_coursesGen++;
+  else if (strcmp(path, SCHEDULES_FILE) == 0) g_schedulesGen++;
 }
 
 // Añade una línea al final de un archivo. True si tiene éxito.
+// ATT/DENIED/NOTIF pasan por el escritor agrupado (log_writer.h).
 bool appendLineToFile(const char *path, const String &line) {
+  if (logWriterHandles(path)) return logWriterAppend(path, line);
   File f = SPIFFS.open(path, FILE_APPEND);
   if (!f) {
     Serial.printf("ERR append %s\n", path);
     return false;
   }
+  uint32_t off = (uint32_t)f.size();
   f.println(line);
   f.close();
+  uidIndexNoteRow(path, off, line);
+  accessTableNoteRow(path, line);
+  bumpGeneration(path);
   return true;
 }
 
 // Sobrescribe un archivo con todas las líneas dadas. True si tiene éxito.
 bool writeAllLines(const char *path, const std::vector<String> &lines) {
+  if (logWriterHandles(path)) logWriterSync(); // no dejar líneas pendientes detrás de la reescritura
   File f = SPIFFS.open(path, FILE_WRITE);
   if (!f) {
     Serial.printf("ERR writeAll %s\n", path);
     return false;
   }
-  for (const String &L : lines) f.println(L);
+  // el índice de UID se rehace con los offsets reales de cada fila
+  bool indexed = uidIndexTracksFile(path);
+  if (indexed) uidIndexResetFile(path);
+  for (const String &L : lines) {
+    uint32_t off = (uint32_t)f.position();
+    f.println(L);
+    if (indexed) uidIndexNoteRow(path, off, L);
+  }
   f.close();
+  rowLogResetFile(path); // las lápidas apuntaban a offsets del archivo anterior
+  accessTableReset(path);
+  bumpGeneration(path);
   return true;
 }
 
@@ -61,13 +76,7 @@ void initFiles() {
       f.close();
     }
   }
-  if (!SPIFFS.exists(ATT_FILE)) {
-    File f = SPIFFS.open(ATT_FILE, FILE_WRITE);
-    if (f) {
-      f.println("\"timestamp\",\"uid\",\"name\",\"account\",\"materia\",\"mode\"");
-      f.close();
-    }
-  }
+  // attendance: segmentos diarios creados bajo demanda (att_store.h)
   if (!SPIFFS.exists(DENIED_FILE)) {
     File f = SPIFFS.open(DENIED_FILE, FILE_WRITE);
     if (f) {
@@ -85,7 +94,7 @@ void initFiles() {
   if (!SPIFFS.exists(NOTIF_FILE)) {
     File f = SPIFFS.open(NOTIF_FILE, FILE_WRITE);
     if (f) {
-      f.println("\"timestamp\",\"uid\",\"name\",\"account\",\"note\"");
+      f.println("\"timestamp\",\"uid\",\"name\",\"account\",\"note\",\"seq\"");
       f.close();
     }
   }
@@ -106,31 +115,34 @@ void initFiles() {
 }
 
 // --- Horarios (schedules) ---
-std::vector<ScheduleEntry> loadSchedules() {
-  std::vector<ScheduleEntry> res;
+static std::vector<ScheduleEntry> g_schedules;
+static uint32_t g_schedulesLoadedGen = 0;
+
+const std::vector<ScheduleEntry> &loadSchedules() {
+  if (g_schedulesLoadedGen == g_schedulesGen) return g_schedules;
+  g_schedules.clear();
+  g_schedulesLoadedGen = g_schedulesGen;
   File f = SPIFFS.open(SCHEDULES_FILE, FILE_READ);
-  if (!f) return res;
-  String header = f.readStringUntil('\n');
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (l.length() == 0) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 4) {
-      ScheduleEntry e; e.materia = c[0]; e.day = c[1]; e.start = c[2]; e.end = c[3];
-      res.push_back(e);
+  if (!f) return g_schedules;
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() >= 4) {
+      ScheduleEntry e; e.materia = r.str(SCHED_MATERIA); e.day = r.str(SCHED_DAY); e.start = r.str(SCHED_START); e.end = r.str(SCHED_END);
+      catalogParseOwner(e.materia, e.materiaId, e.profesorId);  // clave partida una sola vez
+      g_schedules.push_back(e);
     }
   }
   f.close();
-  return res;
+  return g_schedules;
 }
 
+uint32_t schedulesGeneration() { return g_schedulesGen; }
+
+// Ocupado = algún horario (de 'materiaFilter' si se da) cubre el minuto 'start' (schedule_table.h).
 bool slotOccupied(const String &day, const String &start, const String &materiaFilter) {
-  auto v = loadSchedules();
-  for (auto &e : v) {
-    if (materiaFilter.length() && e.materia != materiaFilter) continue;
-    if (e.day == day && e.start == start) return true;
-  }
-  return false;
+  int a = scheduleTableMinutes(start);
+  if (a < 0) return false;
+  return scheduleTableOverlap(scheduleTableDayIndex(day), a, a + 1, materiaFilter) != nullptr;
 }
 
 void addScheduleSlot(const String &materia, const String &day, const String &start, const String &end) {
@@ -139,27 +151,34 @@ void addScheduleSlot(const String &materia, const String &day, const String &sta
 }
 
 // --- Cursos (courses) ---
-std::vector<Course> loadCourses() {
-  std::vector<Course> res;
+static std::vector<Course> g_courses;
+static uint32_t g_coursesLoadedGen = 0;
+
+const std::vector<Course> &loadCourses() {
+  if (g_coursesLoadedGen == g_coursesGen) return g_courses;
+  g_courses.clear();
+  g_coursesLoadedGen = g_coursesGen;
   File f = SPIFFS.open(COURSES_FILE, FILE_READ);
-  if (!f) return res;
-  String header = f.readStringUntil('\n');
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (l.length() == 0) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 3) {
-      Course co; co.materia = c[0]; co.profesor = c[1]; co.created_at = c[2]; res.push_back(co);
-    } else if (c.size() == 2) {
-      Course co; co.materia = c[0]; co.profesor = c[1]; co.created_at = ""; res.push_back(co);
+  if (!f) return g_courses;
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() >= 2) {
+      Course co; co.materia = r.str(COURSES_MATERIA); co.profesor = r.str(COURSES_PROFESOR); co.created_at = r.str(COURSES_CREATED);
+      co.materiaId = catalogMateriaId(co.materia);
+      co.profesorId = catalogProfesorId(co.profesor);
+      co.courseId = catalogCourseId(co.materiaId, co.profesorId);
+      g_courses.push_back(co);
     }
   }
   f.close();
-  return res;
+  return g_courses;
 }
 
+uint32_t coursesGeneration() { return g_coursesGen; }
+
 bool courseExists(const String &materia) {
   if (materia.length() == 0) return false;
-  auto v = loadCourses();
+  const auto &v = loadCourses();
   for (auto &c : v) if (c.materia == materia) return true;
   return false;
 }
@@ -178,42 +197,25 @@ void writeCourses(const std::vector<Course> &list) {
 }
 
 // --- Usuarios ---
+// Búsquedas por UID y por cuenta vía índice en RAM (uid_index.h): sin recorrer el archivo.
 String findAnyUserByUID(const String &uid) {
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return "";
-  while (f.available()) {
-    String line = f.readStringUntil('\n'); line.trim();
-    if (line.length() == 0) continue;
-    auto cols = parseQuotedCSVLine(line);
-    if (cols.size() > 0 && cols[0] == uid) { f.close(); return line; }
-  }
-  f.close();
-  return "";
+  auto rows = uidIndexUserRows(uid);
+  return rows.empty() ? String("") : rows[0];
 }
 
 bool existsUserUidMateria(const String &uid, const String &materia) {
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String line = f.readStringUntil('\n'); line.trim();
-    if (line.length() == 0) continue;
-    auto c = parseQuotedCSVLine(line);
-    if (c.size() >= 4 && c[0] == uid && c[3] == materia) { f.close(); return true; }
+  CsvFields c;
+  for (auto &line : uidIndexUserRows(uid)) {
+    if (c.split(line) >= 4 && c[USERS_MATERIA].equals(materia)) return true;
   }
-  f.close();
   return false;
 }
 
 bool existsUserAccountMateria(const String &account, const String &materia) {
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String line = f.readStringUntil('\n'); line.trim();
-    if (line.length() == 0) continue;
-    auto c = parseQuotedCSVLine(line);
-    if (c.size() >= 4 && c[2] == account && c[3] == materia) { f.close(); return true; }
+  CsvFields c;
+  for (auto &line : uidIndexAccountUserRows(account)) {
+    if (c.split(line) >= 4 && c[USERS_MATERIA].equals(materia)) return true;
   }
-  f.close();
   return false;
 }
 
@@ -221,12 +223,9 @@ std::vector<String> usersForMateria(const String &materia) {
   std::vector<String> res;
   File f = SPIFFS.open(USERS_FILE, FILE_READ);
   if (!f) return res;
-  String header = f.readStringUntil('\n');
-  while (f.available()) {
-    String line = f.readStringUntil('\n'); line.trim();
-    if (line.length() == 0) continue;
-    auto c = parseQuotedCSVLine(line);
-    if (c.size() >= 4 && c[3] == materia) res.push_back(line);
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() >= 4 && r[USERS_MATERIA].equals(materia)) res.push_back(r.lineString());
   }
   f.close();
   return res;
@@ -234,64 +233,47 @@ std::vector<String> usersForMateria(const String &materia) {
 
 // --- Notificaciones ---
 void addNotification(const String &uid, const String &name, const String &account, const String &note) {
-  String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + name + "\"," + "\"" + account + "\"," + "\"" + note + "\"";
-  appendLineToFile(NOTIF_FILE, rec);
+  uint32_t seq = notifStoreAdd();
+  String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + name + "\"," + "\"" + account + "\"," + "\"" + note + "\",\"" + String(seq) + "\"";
+  if (appendLineToFile(NOTIF_FILE, rec)) notifStoreAdded();   // descartada con la cola llena: no es viva
 }
 
+// Las 'limit' más recientes (orden de archivo); se leen desde el final sin recorrer el resto.
 std::vector<String> readNotifications(int limit) {
+  logWriterSync();
   std::vector<String> res;
+  if (limit <= 0) return res;
   File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
   if (!f) return res;
-  String header = f.readStringUntil('\n');
-  while (f.available()) {
-    String line = f.readStringUntil('\n'); line.trim();
-    if (line.length()) res.push_back(line);
-  }
+  f.seek(csvTailOffset(f, (size_t)limit));
+  CsvReader r(f, false);
+  while (r.next()) res.push_back(r.lineString());
   f.close();
-  int start = max(0, (int)res.size() - limit);
-  std::vector<String> out;
-  for (int i = start; i < (int)res.size(); i++) out.push_back(res[i]);
-  return out;
+  return res;
 }
 
+// Contador de notif_store (sin abrir el archivo)
 int notifCount() {
-  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
-  if (!f) return 0;
-  int count = 0;
-  String header = f.readStringUntil('\n');
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (l.length()) count++;
-  }
-  f.close();
-  return count;
+  return notifStoreLiveCount();
 }
 
 void clearNotifications() {
-  writeAllLines(NOTIF_FILE, std::vector<String>{String("\"timestamp\",\"uid\",\"name\",\"account\",\"note\"")});
+  writeAllLines(NOTIF_FILE, std::vector<String>{String("\"timestamp\",\"uid\",\"name\",\"account\",\"note\",\"seq\"")});
+  notifStoreClear();
 }
 
 // --- TEACHERS helpers añadidos ---
 String findTeacherByUID(const String &uid) {
-  File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (!f) return "";
-  while (f.available()) {
-    String line = f.readStringUntil('\n'); line.trim();
-    if (line.length() == 0) continue;
-    auto cols = parseQuotedCSVLine(line);
-    if (cols.size() > 0 && cols[0] == uid) { f.close(); return line; }
-  }
-  f.close();
-  return "";
+  auto rows = uidIndexTeacherRows(uid);
+  return rows.empty() ? String("") : rows[0];
 }
 
 bool teacherNameExists(const String &name) {
   File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
   if (!f) return false;
-  while (f.available()) {
-    String line = f.readStringUntil('\n'); line.trim();
-    if (line.length() == 0) continue;
-    auto cols = parseQuotedCSVLine(line);
-    if (cols.size() > 1 && cols[1] == name) { f.close(); return true; }
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() > 1 && r[USERS_NAME].equals(name)) { f.close(); return true; }
   }
   f.close();
   return false;
@@ -301,15 +283,9 @@ std::vector<String> teachersForMateriaFile(const String &materia) {
   std::vector<String> out;
   File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
   if (!f) return out;
-  String header = f.readStringUntil('\n'); (void)header;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 4) {
-      String mat = c[3];
-      if (mat == materia) out.push_back(l);
-    }
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() >= 4 && r[USERS_MATERIA].equals(materia)) out.push_back(r.lineString());
   }
   f.close();
   return out;
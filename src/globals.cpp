@@ -38,11 +38,24 @@ const char* NOTIF_FILE         = "/notifications.csv";
 const char* COURSES_FILE       = "/courses.csv";
 const char* CAPTURE_QUEUE_FILE = "/capture_queue.csv";
 const char* TEACHERS_FILE      = "/teachers.csv";
+const char* UNDATED_FILE       = "/undated.csv";
 
 // --- Timings ---
 const unsigned long DISPLAY_MS = 4000UL;
-const unsigned long POLL_INTERVAL = 150UL;
+const unsigned long POLL_INTERVAL = 50UL;     // sondeo del MFRC522 en su tarea (rfid_reader)
 const unsigned long CAPTURE_DEBOUNCE_MS = 3000UL;
+const unsigned long REPEAT_TAP_WINDOW_MS = 5UL * 60UL * 1000UL;
+
+// --- Puerta ---
+const unsigned long DOOR_HOLD_MS = 4000UL;
+const unsigned long DOOR_TRAVEL_MS = 500UL;
+const int DOOR_OPEN_ANGLE = 90;
+const int DOOR_CLOSED_ANGLE = 0;
+
+// --- Núcleos ---
+const int WEB_CORE = 0;
+const uint32_t WEB_TASK_STACK = 8192;   // como el de loop(): los handlers corrían ahí
+const uint32_t NET_TASK_STACK = 6144;   // termina al iniciar el servidor
 
 // --- Days, slots ---
 const String DAYS[6] = {"LUN","MAR","MIE","JUE","VIE","SAB"};
@@ -64,7 +77,7 @@ String captureAccount = "";
 unsigned long captureDetectedAt = 0;
 
 // --- Variables para captura batch (DEFINICIONES únicas) ---
-std::vector<String> capturedUIDs;
+std::vector<UidKey> capturedUIDs;
 volatile bool isCapturing = false;
 volatile bool isBatchCapture = false;
 
@@ -0,0 +1,71 @@
+// src/latency_stats.cpp
+#include "latency_stats.h"
+
+// v < 8: cubeta v; si no, 8 + 4 * (bit alto - 3) + los 2 bits siguientes.
+// 2^27 µs (~2 min) en adelante va a la última.
+static const uint8_t SUB_BITS = 2;
+static const uint8_t MAX_BIT = 27;
+static const size_t BUCKETS = 8 + (MAX_BIT - 3) * (1 << SUB_BITS);
+
+struct StageHist {
+  uint32_t buckets[BUCKETS];
+  uint32_t count;
+  uint32_t max;
+};
+
+static StageHist g_hist[LAT_STAGES];
+
+static const char *STAGE_NAMES[LAT_STAGES] = {
+  "lectura", "cola", "decision", "puerta", "pantalla", "total", "registro", "flash",
+};
+
+static size_t bucketOf(uint32_t v) {
+  if (v < 8) return v;
+  uint8_t hi = 31 - __builtin_clz(v);
+  if (hi >= MAX_BIT) return BUCKETS - 1;
+  uint32_t sub = (v >> (hi - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+  return 8 + (size_t)(hi - 3) * (1 << SUB_BITS) + sub;
+}
+
+// Mayor valor que cae en la cubeta (lo que se informa como percentil).
+static uint32_t bucketTop(size_t b) {
+  if (b < 8) return (uint32_t)b;
+  size_t k = b - 8;
+  uint8_t hi = (uint8_t)(3 + k / (1 << SUB_BITS));
+  uint32_t sub = (uint32_t)(k % (1 << SUB_BITS));
+  uint32_t base = (1UL << hi) + (sub << (hi - SUB_BITS));
+  return base + (1UL << (hi - SUB_BITS)) - 1;
+}
+
+void latencyRecord(LatStage stage, uint32_t us) {
+  if (stage >= LAT_STAGES) return;
+  StageHist &h = g_hist[stage];
+  h.buckets[bucketOf(us)]++;
+  h.count++;
+  if (us > h.max) h.max = us;
+}
+
+LatSummary latencySummary(LatStage stage) {
+  LatSummary s = {0, 0, 0, 0, 0};
+  if (stage >= LAT_STAGES) return s;
+  const StageHist &h = g_hist[stage];
+  s.count = h.count;
+  s.max = h.max;
+  if (!s.count) return s;
+  uint32_t want[3];
+  const uint8_t pct[3] = {50, 95, 99};
+  for (int i = 0; i < 3; ++i) want[i] = (uint32_t)(((uint64_t)s.count * pct[i] + 99) / 100);
+  uint32_t *out[3] = {&s.p50, &s.p95, &s.p99};
+  uint32_t seen = 0;
+  size_t q = 0;
+  for (size_t b = 0; b < BUCKETS && q < 3; ++b) {
+    seen += h.buckets[b];
+    uint32_t top = (b == BUCKETS - 1 || bucketTop(b) > s.max) ? s.max : bucketTop(b);   // la última no tiene techo
+    while (q < 3 && seen >= want[q]) *out[q++] = top;
+  }
+  return s;
+}
+
+const char *latencyStageName(LatStage stage) {
+  return stage < LAT_STAGES ? STAGE_NAMES[stage] : "";
+}
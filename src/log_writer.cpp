@@ -0,0 +1,148 @@
+// src/log_writer.cpp
+#include "log_writer.h"
+#include "config.h"
+#include "globals.h"
+#include "att_store.h"
+#include "notif_store.h"
+#include "latency_stats.h"
+#include <SPIFFS.h>
+#include <esp_system.h>
+#include <string.h>
+
+static const size_t LOG_QUEUE_MAX = 32;          // registros en RAM como máximo
+static const size_t LOG_FLUSH_BYTES = 2048;      // umbral de tamaño
+static const unsigned long LOG_FLUSH_MS = 1500;  // antigüedad máxima de un registro encolado
+
+struct LogEntry {
+  const char *path;
+  String line;
+};
+
+static LogEntry g_queue[LOG_QUEUE_MAX];
+static size_t g_count = 0;
+static size_t g_bytes = 0;
+static unsigned long g_oldestAt = 0;
+static uint32_t g_records = 0;
+static uint32_t g_flushes = 0;
+static uint32_t g_dropped = 0;
+static bool g_keep[LOG_QUEUE_MAX];   // vaciado: línea no escrita, sigue en la cola
+
+// Escribe (una apertura por archivo) todas las líneas encoladas de 'path'.
+// NOTIF_FILE: cada fila se anota en notif_store con su offset.
+// Si el archivo no abre o una escritura queda corta, esa línea y las siguientes
+// de 'path' se quedan en la cola para el próximo vaciado.
+static void flushPath(const char *path) {
+  File f;
+  uint32_t off = 0;
+  bool notif = (path == NOTIF_FILE);
+  bool failing = false;
+  for (size_t i = 0; i < g_count; ++i) {
+    if (g_queue[i].path != path) continue;
+    if (!failing && !f) {
+      f = SPIFFS.open(path, FILE_APPEND);
+      if (!f) { Serial.printf("ERR append %s\n", path); failing = true; }
+      else off = (uint32_t)f.size();
+    }
+    if (!failing) {
+      size_t want = g_queue[i].line.length() + 2;
+      size_t wrote = f.println(g_queue[i].line);
+      if (wrote == want) {
+        if (notif) notifStoreNoteRow(off, g_queue[i].line);
+        off += wrote;
+        continue;
+      }
+      Serial.printf("ERR append %s: escritura incompleta\n", path);
+      failing = true;
+    }
+    g_keep[i] = true;
+  }
+  if (f) f.close();
+}
+
+// attendance va a su segmento diario (att_store.h), agrupado por día.
+static void flushAttendance() {
+  std::vector<String> lines;
+  std::vector<size_t> slot;
+  for (size_t i = 0; i < g_count; ++i)
+    if (g_queue[i].path == ATT_FILE) { lines.push_back(g_queue[i].line); slot.push_back(i); }
+  std::vector<size_t> failed;
+  if (!attStoreAppendLines(lines, &failed))
+    for (size_t k : failed) g_keep[slot[k]] = true;
+}
+
+static void flushAll() {
+  if (g_count == 0) return;
+  uint32_t t0 = micros();
+  for (size_t i = 0; i < g_count; ++i) g_keep[i] = false;
+  flushAttendance();
+  flushPath(DENIED_FILE);
+  flushPath(NOTIF_FILE);
+  // lo no escrito se conserva en orden y se reintenta tras LOG_FLUSH_MS
+  size_t kept = 0;
+  g_bytes = 0;
+  for (size_t i = 0; i < g_count; ++i) {
+    if (!g_keep[i]) { g_queue[i].line = String(); continue; }
+    if (kept != i) {
+      g_queue[kept].path = g_queue[i].path;
+      g_queue[kept].line = g_queue[i].line;
+      g_queue[i].line = String();
+    }
+    g_bytes += g_queue[kept].line.length() + 2;
+    kept++;
+  }
+  g_count = kept;
+  if (kept) g_oldestAt = millis();
+  g_flushes++;
+  latencyRecord(LAT_FLUSH, micros() - t0);
+}
+
+static void onShutdown() {
+  flushAll();
+  attStoreSaveManifest();
+  notifStoreSave();
+}
+
+void logWriterBegin() {
+  esp_register_shutdown_handler(onShutdown);
+}
+
+bool logWriterHandles(const char *path) {
+  if (!path) return false;
+  return strcmp(path, ATT_FILE) == 0 || strcmp(path, DENIED_FILE) == 0 || strcmp(path, NOTIF_FILE) == 0;
+}
+
+bool logWriterAppend(const char *path, const String &line) {
+  // normalizar al puntero global para agrupar por archivo
+  if (strcmp(path, ATT_FILE) == 0) path = ATT_FILE;
+  else if (strcmp(path, DENIED_FILE) == 0) path = DENIED_FILE;
+  else path = NOTIF_FILE;
+
+  if (g_count >= LOG_QUEUE_MAX) flushAll();
+  if (g_count >= LOG_QUEUE_MAX) {
+    // la flash no acepta escrituras y la cola sigue llena
+    g_dropped++;
+    Serial.printf("ERR log_writer: cola llena, registro descartado en %s\n", path);
+    return false;
+  }
+  if (g_count == 0) g_oldestAt = millis();
+  g_queue[g_count].path = path;
+  g_queue[g_count].line = line;
+  g_count++;
+  g_bytes += line.length() + 2;
+  g_records++;
+  if (g_bytes >= LOG_FLUSH_BYTES) flushAll();
+  return true;
+}
+
+void logWriterLoop() {
+  if (g_count && (millis() - g_oldestAt) >= LOG_FLUSH_MS) flushAll();
+}
+
+void logWriterSync() {
+  flushAll();
+}
+
+size_t logWriterPending() { return g_count; }
+uint32_t logWriterRecordCount() { return g_records; }
+uint32_t logWriterFlushCount() { return g_flushes; }
+uint32_t logWriterDropped() { return g_dropped; }
@@ -14,30 +14,63 @@
 #include "config.h"
 #include "globals.h"
 #include "display.h"
+#include "door.h"
+#include "rfid_reader.h"
 #include "files_utils.h"
+#include "uid_index.h"
+#include "log_writer.h"
+#include "att_store.h"
+#include "row_log.h"
+#include "catalog.h"
+#include "schedule_table.h"
+#include "access_table.h"
+#include "notif_store.h"
 #include "rfid_handler.h"
+#include "boot_info.h"
+#include "time_utils.h"
 #include "web/web_routes.h"
 
+static TaskHandle_t webTaskHandle = nullptr;
+static volatile bool serverStarted = false;   // lo pone la tarea de red tras server.begin()
+
+// Trabajo del núcleo web: handlers HTTP y escrituras/mantenimiento del SPIFFS.
+static void webWork() {
+  if (serverStarted) server.handleClient();
+  if (!bootTimeSyncedMs() && timeIsSynced()) bootMarkTimeSynced();
+
+  // Registros y modo captura de las tarjetas que decidió el núcleo de acceso
+  rfidEventsLoop();
+
+  // Vaciar registros encolados (attendance/denied/notificaciones) y manifiesto de asistencia por tiempo
+  logWriterLoop();
+  attStoreLoop();
+  notifStoreLoop();   // marcas leído/no leído, diferidas
+  rowLogLoop();   // compacta archivos con muchas filas borradas
+  scheduleTableLoop();   // recompila y publica el horario tras editarlo
+  accessTableLoop();     // rehace y publica la tabla de acceso tras altas/bajas de usuarios o cursos
+}
+
+static void webTask(void *) {
+  for (;;) {
+    webWork();
+    delay(2);
+  }
+}
+
 // cuánto esperar (ms) a que NTP sincronice antes de seguir 
 static const unsigned long NTP_TIMEOUT_MS = 30UL * 1000UL; // 30 segundos
 static const unsigned long NTP_POLL_MS    = 500UL;        // poll cada 500 ms
 
-// Devuelve true si la hora del sistema es posterior al 1-ene-2020 (evita epoch por defecto).
-static bool systemTimeReasonable() {
-  time_t now = time(nullptr);
-  return now > 1577836800;
-}
-
 // Espera hasta que NTP sincronice o hasta agotar el timeout; imprime progreso y advertencias.
 static void waitForNtpSyncOrTimeout() {
   unsigned long t0 = millis();
   Serial.printf("Esperando sincronización NTP (timeout %lus) ...\n", NTP_TIMEOUT_MS / 1000UL);
-  while (!systemTimeReasonable() && (millis() - t0) < NTP_TIMEOUT_MS) {
+  while (!timeIsSynced() && (millis() - t0) < NTP_TIMEOUT_MS) {
     delay(NTP_POLL_MS);
     Serial.print(".");
   }
   Serial.println();
-  if (systemTimeReasonable()) {
+  if (timeIsSynced()) {
     Serial.println("Hora sincronizada via NTP.");
   } else {
     Serial.println("WARN: Timeout NTP. Hora no sincronizada — se usará la hora del sistema (posible incorrecta).");
@@ -140,6 +173,41 @@ void connectWiFiWithTimeout(unsigned long timeout_ms = 30000UL) {
   Serial.printf("Estado final WiFi.status() = %d\n", (int)WiFi.status());
 }
 
+// Red en segundo plano: WiFi, NTP y servidor web. La puerta ya funciona mientras
+// tanto; lo que se lea sin hora espera en el diario (ver rfidEventsLoop).
+static void netBringUp() {
+  connectWiFiWithTimeout(30000UL); // 30s
+
+  Serial.println("Configurando TZ y NTP...");
+  const char *posixTZ = "GMT-6"; // fallback POSIX para UTC-6
+
+  configTzTime(TZ, "pool.ntp.org", "time.nist.gov");
+  setenv("TZ", TZ, 1);
+  tzset();
+
+  waitForNtpSyncOrTimeout();
+
+  if (!timeIsSynced()) {
+    Serial.println("Reintentando configTzTime con cadena POSIX (fallback)...");
+    configTzTime(posixTZ, "pool.ntp.org", "time.nist.gov");
+    setenv("TZ", posixTZ, 1);
+    tzset();
+    waitForNtpSyncOrTimeout();
+  }
+
+  printTimeInfo();
+
+  server.begin();
+  serverStarted = true;
+  bootMarkNetReady();
+  Serial.printf("Web server iniciado (%lu ms desde el arranque).\n", (unsigned long)bootNetReadyMs());
+}
+
+static void netTask(void *) {
+  netBringUp();
+  vTaskDelete(NULL);
+}
+
 void setup() {
   Serial.begin(115200);
   delay(200);
@@ -156,26 +224,29 @@ void setup() {
   initFiles();
   Serial.println("initFiles() -> OK.");
 
-  connectWiFiWithTimeout(30000UL); // 30s
+  // Bajas/ediciones pendientes (lápidas) y compactación interrumpida; antes del índice
+  rowLogBegin();
 
-  Serial.println("Configurando TZ y NTP...");
-  const char *posixTZ = "GMT-6"; // fallback POSIX para UTC-6
+  // Índice UID -> filas de usuarios/maestros (evita escanear CSV en cada tarjeta)
+  uidIndexBuild();
 
-  configTzTime(TZ, "pool.ntp.org", "time.nist.gov");
-  setenv("TZ", TZ, 1);
-  tzset();
+  // IDs enteros de materias/profesores/cursos (carga /catalog.csv y registra los cursos nuevos)
+  catalogBegin();
 
-  waitForNtpSyncOrTimeout();
+  // Horario semanal compilado (materia con clase ahora, sin leer schedules.csv por tarjeta)
+  scheduleTableBegin();
 
-  if (!systemTimeReasonable()) {
-    Serial.println("Reintentando configTzTime con cadena POSIX (fallback)...");
-    configTzTime(posixTZ, "pool.ntp.org", "time.nist.gov");
-    setenv("TZ", posixTZ, 1);
-    tzset();
-    waitForNtpSyncOrTimeout();
-  }
+  // UID -> rol y materias para decidir el acceso en RAM (usa cursos y catálogo)
+  accessTableBegin();
 
-  printTimeInfo();
+  // Historial de asistencia por día (carga manifiesto, migra attendance.csv anterior)
+  attStoreBegin();
+
+  // Secuencia y leídas de notificaciones (migra "/.notif_read" y filas sin seq)
+  notifStoreBegin();
+
+  // Escritor agrupado de attendance/denied/notificaciones (vacía también antes de reiniciar)
+  logWriterBegin();
 
   Serial.println("Iniciando SPI...");
   SPI.begin();
@@ -183,22 +254,19 @@ void setup() {
   Serial.println("Inicializando lector RFID (MFRC522)...");
   mfrc522.PCD_Init();
   Serial.println("MFRC522 inicializado.");
+  rfidHandlerBegin();
+  rfidReaderBegin();   // desde aquí sólo la tarea del lector (o rfidReaderPoll) usa mfrc522
 
   Serial.println("Inicializando display...");
   displayInit();
   Serial.println("displayInit() OK.");
 
-  // ------------------------------------------------
-  // INICIALIZAR SERVO (necesario para que puerta.write() funcione)
-  // ------------------------------------------------
-  // Asegúrate de que SERVO_PIN esté definido en config.h y corresponde al pin físico.
-  // Si tu SERVO necesita ajuste de ángulos o valores min/max, cámbialo aquí.
-  Serial.printf("Inicializando servo. Pin esperado (SERVO_PIN) = %d\n", SERVO_PIN);
-  // Attach del servo
-  puerta.attach(SERVO_PIN);
-  // Posición inicial (cerrado). Ajusta si en tu mecánica "0" no es cerrado.
-  puerta.write(0);
-  Serial.println("Servo attach OK. Posición inicial 0.");
+  // Cerradura (servo): máquina de estados no bloqueante, ver door.h
+  doorBegin();
+
+  // Puerta operativa: lo demás (red, hora, servidor) no la retrasa
+  bootMarkAccessReady();
+  Serial.printf("Acceso listo en %lu ms.\n", (unsigned long)bootAccessReadyMs());
 
   // Registrar rutas web (registerRoutes debe estar en web/web_routes.cpp)
   registerRoutes();
@@ -213,22 +281,33 @@ void setup() {
     server.send(200,"text/plain", String("Time set to: ") + nowISO());
   });
 
-  server.begin();
-  Serial.println("Web server iniciado.");
+  // Núcleo web: servidor y todo lo que escribe en el SPIFFS, en su propia tarea
+  if (xTaskCreatePinnedToCore(webTask, "web", WEB_TASK_STACK, nullptr, 1, &webTaskHandle, WEB_CORE) != pdPASS) {
+    webTaskHandle = nullptr;
+    Serial.println("ERR no se pudo crear la tarea web: se atiende desde loop()");
+  } else {
+    Serial.printf("Tarea web en el núcleo %d; acceso y puerta en el núcleo %d.\n", WEB_CORE, (int)xPortGetCoreID());
+  }
+
+  // WiFi/NTP/servidor sin bloquear el arranque de la puerta
+  if (xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, nullptr, 1, nullptr, WEB_CORE) != pdPASS) {
+    Serial.println("ERR no se pudo crear la tarea de red: se conecta en setup()");
+    netBringUp();
+  }
   Serial.println("Setup completo - entrando a loop.");
 }
 
-unsigned long lastPoll = 0;
-
+// Núcleo de acceso: tarjeta -> decisión -> puerta y pantalla. No espera a
+// ninguna página: lo que necesita del núcleo web lo toma de vistas publicadas
+// (access_table.h, schedule_table.h) y le devuelve las lecturas por una cola.
 void loop() {
-  server.handleClient();
+  // Lecturas RFID encoladas por la tarea del lector (rfid_reader)
+  rfidLoopHandler();
+  doorLoop();      // abrir/mantener/cerrar la puerta sin esperas
 
   // >>> LLAMADA: actualizar display de forma no bloqueante
   updateDisplay();
 
-  // Manejo RFID / polling periodic
-  if (millis() - lastPoll > POLL_INTERVAL) {
-    lastPoll = millis();
-    rfidLoopHandler();
-  }
+  if (!webTaskHandle) webWork();
+  delay(1);
 }
@@ -0,0 +1,436 @@
+// src/notif_store.cpp
+#include "notif_store.h"
+#include "config.h"
+#include "globals.h"
+#include "files_utils.h"
+#include "csv_reader.h"
+#include "log_writer.h"
+#include <SPIFFS.h>
+#include <algorithm>
+
+static const char *NOTIF_READ_FILE = "/notif_read.csv";
+static const char *NOTIF_READ_HEADER = "\"kind\",\"from\",\"to\"";
+static const char *LEGACY_READ_FILE = "/.notif_read";   // claves ts|uid|nota (formato anterior)
+static const uint32_t NOTIF_MARK_ROWS = 16;              // una marca seq -> offset cada tantas filas
+static const unsigned long NOTIF_SAVE_MS = 30000;        // persistencia diferida de las marcas
+
+struct SeqRange {
+  uint32_t from;
+  uint32_t to;
+};
+
+// Rangos de seq leídos: ordenados, disjuntos y no contiguos.
+static std::vector<SeqRange> g_read;
+static uint32_t g_nextSeq = 1;
+static int g_live = 0;        // filas vivas en NOTIF_FILE
+static int g_readCount = 0;   // de ellas, leídas
+static bool g_dirty = false;  // marcas sin guardar en /notif_read.csv
+static unsigned long g_dirtySince = 0;
+
+// Recuento guardado en /notif_read.csv con el tamaño que tenía NOTIF_FILE.
+struct SavedCount {
+  bool valid;
+  int live;
+  int read;
+  uint32_t bytes;
+};
+static SavedCount g_saved;
+
+// Marcas seq -> offset en NOTIF_FILE, ordenadas por seq (ver notif_store.h).
+struct SeqMark {
+  uint32_t seq;
+  uint32_t off;
+};
+static std::vector<SeqMark> g_marks;
+static bool g_marksBuilt = false;
+static uint32_t g_rowsSinceMark = 0;
+
+// Primer rango que termina en 'seq' o después.
+static size_t findRange(uint32_t seq) {
+  auto it = std::lower_bound(g_read.begin(), g_read.end(), seq,
+                             [](const SeqRange &r, uint32_t s) { return r.to < s; });
+  return (size_t)(it - g_read.begin());
+}
+
+static bool inRanges(uint32_t seq) {
+  size_t i = findRange(seq);
+  return i < g_read.size() && g_read[i].from <= seq;
+}
+
+static void addToRanges(uint32_t seq) {
+  size_t i = findRange(seq);
+  if (i < g_read.size() && g_read[i].from <= seq) return;
+  bool joinPrev = i > 0 && g_read[i - 1].to + 1 == seq;
+  bool joinNext = i < g_read.size() && g_read[i].from == seq + 1;
+  if (joinPrev && joinNext) {
+    g_read[i - 1].to = g_read[i].to;
+    g_read.erase(g_read.begin() + i);
+  } else if (joinPrev) {
+    g_read[i - 1].to = seq;
+  } else if (joinNext) {
+    g_read[i].from = seq;
+  } else {
+    g_read.insert(g_read.begin() + i, SeqRange{seq, seq});
+  }
+}
+
+static void removeFromRanges(uint32_t seq) {
+  size_t i = findRange(seq);
+  if (i >= g_read.size() || g_read[i].from > seq) return;
+  SeqRange &r = g_read[i];
+  if (r.from == r.to) g_read.erase(g_read.begin() + i);
+  else if (r.from == seq) r.from++;
+  else if (r.to == seq) r.to--;
+  else {
+    SeqRange tail{seq + 1, r.to};
+    r.to = seq - 1;
+    g_read.insert(g_read.begin() + i + 1, tail);
+  }
+}
+
+// Filas: "n" siguiente seq (no se reutiliza tras borrar las últimas), "c" vivas y
+// leídas, "b" tamaño de NOTIF_FILE al guardar, "r" cada rango de leídas.
+static void saveReadFile() {
+  logWriterSync();   // el tamaño guardado debe incluir todas las filas contadas
+  uint32_t bytes = 0;
+  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
+  if (f) { bytes = (uint32_t)f.size(); f.close(); }
+  std::vector<String> lines;
+  lines.reserve(g_read.size() + 4);
+  lines.push_back(NOTIF_READ_HEADER);
+  lines.push_back("\"n\",\"" + String(g_nextSeq) + "\",\"\"");
+  lines.push_back("\"c\",\"" + String(g_live) + "\",\"" + String(g_readCount) + "\"");
+  lines.push_back("\"b\",\"" + String(bytes) + "\",\"\"");
+  for (auto &r : g_read) lines.push_back("\"r\",\"" + String(r.from) + "\",\"" + String(r.to) + "\"");
+  if (writeAllLines(NOTIF_READ_FILE, lines)) g_dirty = false;
+}
+
+static void markDirty() {
+  if (!g_dirty) g_dirtySince = millis();
+  g_dirty = true;
+}
+
+static void loadReadFile() {
+  g_saved = SavedCount{false, 0, 0, 0};
+  bool haveCount = false, haveBytes = false;
+  File f = SPIFFS.open(NOTIF_READ_FILE, FILE_READ);
+  if (!f) return;
+  CsvReader r(f);
+  while (r.next()) {
+    if (r.size() < 2) continue;
+    uint32_t a = (uint32_t)r[1].toInt();
+    if (r[0].equals("n")) {
+      if (a > g_nextSeq) g_nextSeq = a;
+    } else if (r[0].equals("c") && r.size() >= 3) {
+      g_saved.live = (int)a;
+      g_saved.read = (int)r[2].toInt();
+      haveCount = true;
+    } else if (r[0].equals("b")) {
+      g_saved.bytes = a;
+      haveBytes = true;
+    } else if (r[0].equals("r") && r.size() >= 3) {
+      uint32_t b = (uint32_t)r[2].toInt();
+      if (a && a <= b) g_read.push_back(SeqRange{a, b});
+    }
+  }
+  f.close();
+  // saveReadFile() los escribe ordenados; por si acaso, ordenar y fundir solapes
+  std::sort(g_read.begin(), g_read.end(), [](const SeqRange &x, const SeqRange &y) { return x.from < y.from; });
+  size_t n = 0;
+  for (size_t i = 0; i < g_read.size(); ++i) {
+    if (n && g_read[i].from <= g_read[n - 1].to + 1) g_read[n - 1].to = std::max(g_read[n - 1].to, g_read[i].to);
+    else g_read[n++] = g_read[i];
+  }
+  g_read.resize(n);
+  g_saved.valid = haveCount && haveBytes;
+}
+
+// Misma clave que usaba notifications.cpp (ts|uid|principio de la nota)
+static String legacyKey(const String &ts, const String &uid, const String &note) {
+  String k = ts + "|" + uid;
+  String frag = note;
+  if (frag.length() > 80) frag = frag.substring(0, 80);
+  frag.replace("\n", " ");
+  frag.replace("\r", " ");
+  k += "|" + frag;
+  return k;
+}
+
+// Claves del archivo anterior (ordenadas), sin las desmarcadas con lápida.
+static std::vector<String> loadLegacyKeys() {
+  std::vector<String> keys;
+  String side = String(LEGACY_READ_FILE) + ".del";
+  String tmp = String(LEGACY_READ_FILE) + ".tmp";
+  if (!SPIFFS.exists(LEGACY_READ_FILE) && SPIFFS.exists(tmp)) SPIFFS.rename(tmp, LEGACY_READ_FILE);
+  if (!SPIFFS.exists(LEGACY_READ_FILE)) return keys;
+  std::vector<uint32_t> dead;
+  File d = SPIFFS.open(side, FILE_READ);
+  if (d) {
+    CsvReader r(d, false);
+    while (r.next()) if (r.size() >= 1) dead.push_back((uint32_t)r[0].toInt());
+    d.close();
+  }
+  std::sort(dead.begin(), dead.end());
+  File f = SPIFFS.open(LEGACY_READ_FILE, FILE_READ);
+  if (f) {
+    CsvReader r(f, false);   // una clave por línea, sin cabecera
+    while (r.next()) {
+      if (!std::binary_search(dead.begin(), dead.end(), r.offset())) keys.push_back(r.lineString());
+    }
+    f.close();
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+static uint32_t rowSeq(const CsvReader &r) {
+  return r.size() > NOTIF_SEQ ? (uint32_t)r[NOTIF_SEQ].toInt() : 0;
+}
+
+// Arranque rápido: el recuento guardado sigue valiendo si desde entonces sólo se
+// añadieron filas (las bajas vuelven a guardar; las marcas sin guardar sólo se
+// pierden). Se leen únicamente las filas posteriores al tamaño guardado, que
+// son nuevas y por tanto no leídas.
+// Si algo no cuadra (compactación, reescritura, seq fuera de orden) -> false.
+static bool resumeFromSaved(uint32_t &added) {
+  added = 0;
+  if (!g_saved.valid || g_saved.bytes == 0) return false;
+  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
+  if (!f) return false;
+  bool ok = (uint32_t)f.size() >= g_saved.bytes && f.seek(g_saved.bytes - 1) && f.read() == '\n';
+  uint32_t expect = g_nextSeq;
+  if (ok) {
+    CsvReader r(f, false);
+    while (ok && r.next()) {
+      uint32_t s = rowSeq(r);
+      ok = s != 0 && s >= expect;
+      expect = s + 1;
+      added++;
+    }
+  }
+  f.close();
+  if (!ok) return false;
+  g_nextSeq = expect;
+  g_live = g_saved.live + (int)added;
+  g_readCount = g_saved.read;
+  return true;
+}
+
+// Recorrido completo: numera filas sin seq, migra "/.notif_read" y recalcula
+// vivas/leídas quitando de los rangos los seqs que ya no existen.
+static void fullScan(const std::vector<String> &legacy) {
+  std::vector<uint32_t> liveSeqs;
+  bool migrate = false;
+  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
+  if (f) {
+    CsvReader r(f);
+    while (r.next()) {
+      uint32_t s = rowSeq(r);
+      if (!s) { migrate = true; continue; }
+      if (s >= g_nextSeq) g_nextSeq = s + 1;
+      liveSeqs.push_back(s);
+      if (!legacy.empty() &&
+          std::binary_search(legacy.begin(), legacy.end(), legacyKey(r.str(NOTIF_TS), r.str(NOTIF_UID), r.str(NOTIF_NOTE))))
+        addToRanges(s);
+    }
+    f.close();
+  }
+
+  // Filas de antes de la columna seq: se numeran en orden de archivo (una sola vez).
+  if (migrate) {
+    std::vector<String> lines;
+    lines.push_back("\"timestamp\",\"uid\",\"name\",\"account\",\"note\",\"seq\"");
+    File g = SPIFFS.open(NOTIF_FILE, FILE_READ);
+    if (g) {
+      CsvReader r(g);
+      while (r.next()) {
+        String line = r.lineString();
+        uint32_t s = rowSeq(r);
+        if (!s) {
+          s = g_nextSeq++;
+          line += ",\"" + String(s) + "\"";
+          liveSeqs.push_back(s);
+          if (!legacy.empty() &&
+              std::binary_search(legacy.begin(), legacy.end(), legacyKey(r.str(NOTIF_TS), r.str(NOTIF_UID), r.str(NOTIF_NOTE))))
+            addToRanges(s);
+        }
+        lines.push_back(line);
+      }
+      g.close();
+    }
+    writeAllLines(NOTIF_FILE, lines);
+  }
+
+  // Rehacer los rangos sólo con seqs vivos; un hueco de filas borradas entre dos
+  // leídas no parte el rango (los seqs no se reutilizan).
+  std::sort(liveSeqs.begin(), liveSeqs.end());
+  std::vector<SeqRange> rebuilt;
+  uint32_t prevLive = 0;
+  g_readCount = 0;
+  for (uint32_t s : liveSeqs) {
+    if (inRanges(s)) {
+      if (!rebuilt.empty() && rebuilt.back().to == prevLive) rebuilt.back().to = s;
+      else rebuilt.push_back(SeqRange{s, s});
+      g_readCount++;
+    }
+    prevLive = s;
+  }
+  g_read.swap(rebuilt);
+  g_live = (int)liveSeqs.size();
+  saveReadFile();
+}
+
+static void dropMarks() {
+  std::vector<SeqMark>().swap(g_marks);
+  g_marksBuilt = false;
+  g_rowsSinceMark = 0;
+}
+
+static void addMark(uint32_t seq, uint32_t off) {
+  if (!g_marks.empty() && seq <= g_marks.back().seq) { dropMarks(); return; }   // fuera de orden: rehacer
+  if (g_rowsSinceMark == 0) g_marks.push_back(SeqMark{seq, off});
+  g_rowsSinceMark = (g_rowsSinceMark + 1) % NOTIF_MARK_ROWS;
+}
+
+static void buildMarks() {
+  dropMarks();
+  logWriterSync();   // con las marcas sin construir, las filas que salen ahora no se anotan
+  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
+  if (!f) return;
+  g_marksBuilt = true;
+  CsvReader r(f);
+  while (r.next() && g_marksBuilt) {
+    uint32_t s = rowSeq(r);
+    if (s) addMark(s, r.offset());
+  }
+  f.close();
+}
+
+void notifStoreBegin() {
+  unsigned long t0 = millis();
+  g_read.clear();
+  g_nextSeq = 1;
+  g_live = 0;
+  g_readCount = 0;
+  g_dirty = false;
+  loadReadFile();
+  std::vector<String> legacy = loadLegacyKeys();
+
+  logWriterSync();
+  uint32_t added = 0;
+  bool fast = legacy.empty() && !SPIFFS.exists(LEGACY_READ_FILE) && resumeFromSaved(added);
+  if (!fast) fullScan(legacy);
+  else if (added) saveReadFile();   // la próxima vez, menos cola que leer
+
+  if (SPIFFS.exists(LEGACY_READ_FILE)) {
+    SPIFFS.remove(LEGACY_READ_FILE);
+    SPIFFS.remove(String(LEGACY_READ_FILE) + ".del");
+    Serial.printf("notifStore: %u claves leídas migradas de %s\n", (unsigned)legacy.size(), LEGACY_READ_FILE);
+  }
+  Serial.printf("notifStore: %d notificaciones, %d leídas en %u rangos, siguiente seq %lu (%s), %lums\n",
+                g_live, g_readCount, (unsigned)g_read.size(), (unsigned long)g_nextSeq,
+                fast ? "recuento guardado" : "recorrido completo", millis() - t0);
+}
+
+// El seq se reserva aunque la fila no llegue a escribirse (cola llena): no se reutiliza.
+uint32_t notifStoreAdd() {
+  return g_nextSeq++;
+}
+
+void notifStoreAdded() {
+  g_live++;
+}
+
+void notifStoreRemoved(uint32_t seq) {
+  if (g_live > 0) g_live--;
+  if (inRanges(seq)) {
+    removeFromRanges(seq);
+    if (g_readCount > 0) g_readCount--;
+  }
+  saveReadFile();   // también guarda el siguiente seq
+}
+
+void notifStoreClear() {
+  dropMarks();
+  g_read.clear();
+  g_live = 0;
+  g_readCount = 0;
+  saveReadFile();
+}
+
+void notifStoreResync() {
+  dropMarks();   // los offsets cambiaron
+  saveReadFile();
+}
+
+void notifStoreNoteRow(uint32_t offset, const String &line) {
+  if (!g_marksBuilt) return;   // se construyen al primer borrado, con esta fila incluida
+  CsvFields c;
+  if (c.split(line) <= NOTIF_SEQ) return;
+  uint32_t s = (uint32_t)c[NOTIF_SEQ].toInt();
+  if (s) addMark(s, offset);
+}
+
+bool notifStoreFindRow(uint32_t seq, uint32_t &offset, String &line) {
+  if (seq == 0 || seq >= g_nextSeq) return false;
+  logWriterSync();   // la fila puede estar aún en la cola
+  if (!g_marksBuilt) buildMarks();
+  auto it = std::upper_bound(g_marks.begin(), g_marks.end(), seq,
+                             [](uint32_t s, const SeqMark &m) { return s < m.seq; });
+  if (it == g_marks.begin()) return false;   // anterior a la primera fila
+  --it;
+  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
+  if (!f) return false;
+  bool found = false;
+  if (f.seek(it->off)) {
+    CsvReader r(f, false);   // salta las filas con lápida
+    while (r.next()) {
+      uint32_t s = rowSeq(r);
+      if (s > seq) break;
+      if (s == seq) { offset = r.offset(); line = r.lineString(); found = true; break; }
+    }
+  }
+  f.close();
+  return found;
+}
+
+bool notifStoreIsRead(uint32_t seq) {
+  return seq && inRanges(seq);
+}
+
+bool notifStoreMark(uint32_t seq) {
+  if (seq == 0 || seq >= g_nextSeq || inRanges(seq)) return false;
+  // una pestaña antigua puede marcar una notificación ya borrada: no contarla
+  uint32_t off;
+  String line;
+  if (!notifStoreFindRow(seq, off, line)) return false;
+  addToRanges(seq);
+  g_readCount++;
+  markDirty();
+  return true;
+}
+
+bool notifStoreUnmark(uint32_t seq) {
+  if (!notifStoreIsRead(seq)) return false;
+  removeFromRanges(seq);
+  if (g_readCount > 0) g_readCount--;
+  markDirty();
+  return true;
+}
+
+void notifStoreLoop() {
+  if (g_dirty && (millis() - g_dirtySince) >= NOTIF_SAVE_MS) saveReadFile();
+}
+
+void notifStoreSave() {
+  if (g_dirty) saveReadFile();
+}
+
+int notifStoreLiveCount() { return g_live; }
+
+int notifStoreUnreadCount() {
+  int unread = g_live - g_readCount;
+  return unread < 0 ? 0 : unread;
+}
+
+size_t notifStoreRangeCount() { return g_read.size(); }
@@ -7,6 +7,10 @@
 #include <WiFi.h>
 #include <vector>
 #include <ctype.h>
+#include <string.h>
+#include <memory>
+#include <stdlib.h>
+#include <esp_system.h>
 
 // --- IMPORTANTE ---
 // Incluir la librería de Servo **antes** de globals.h para que el tipo Servo
@@ -17,118 +21,123 @@
   #include <Servo.h>
 #endif
 
+#include "config.h"
 #include "globals.h"
 #include "files_utils.h"
+#include "uid_index.h"
+#include "csv_reader.h"
+#include "catalog.h"
+#include "access_table.h"
+#include "uid_key.h"
 #include "display.h"
+#include "door.h"
+#include "rfid_reader.h"
+#include "card_journal.h"
+#include "latency_stats.h"
+#include "boot_info.h"
+#include "log_writer.h"
 #include "time_utils.h"
+#include "schedule_table.h"
 #include "web/self_register.h"
 
-// Extrae la parte "materia" si owner viene como "Materia||Profesor"
-static String baseMateriaFromOwner(const String &owner) {
-  int idx = owner.indexOf("||");
-  if (idx < 0) {
-    String o = owner; o.trim();
-    return o;
-  }
-  String b = owner.substring(0, idx);
-  b.trim();
-  return b;
-}
-
-// Normaliza una materia (quita espacios al inicio/fin)
-static String normMat(const String &s) {
-  String t = s; t.trim(); return t;
-}
-
-// Devuelve string con materias separadas por "; "
-static String joinMats(const std::vector<String> &mats) {
+// Devuelve string con materias (IDs del catálogo) separadas por "; "
+static String joinMats(const std::vector<CatalogId> &mats) {
   String out;
   for (size_t i = 0; i < mats.size(); ++i) {
     if (i) out += "; ";
-    out += mats[i];
+    out += catalogMateriaName(mats[i]);
   }
   return out;
 }
 
-// Helper: devuelve lowercase copy
-static String lowerCopy(const String &s) {
-  String t = s;
-  t.toLowerCase();
-  return t;
+// Tarjetas desconocidas rechazadas hace poco: una cartera pasada varias veces
+// frente al lector sólo deja un registro en DENIED_FILE y una notificación.
+static const size_t REJECTED_CACHE_SIZE = 8;
+static const unsigned long REJECTED_CACHE_MS = 60000UL;
+
+struct RejectedUid {
+  UidKey uid;
+  unsigned long atMs;
+};
+static RejectedUid g_rejected[REJECTED_CACHE_SIZE];
+static size_t g_rejectedNext = 0;
+
+// true si el UID ya se rechazó dentro de la ventana; si no, lo recuerda.
+static bool rejectedRecently(const UidKey &uid, unsigned long now) {
+  for (auto &r : g_rejected) {
+    if (!r.uid.empty() && r.uid == uid && (now - r.atMs) < REJECTED_CACHE_MS) {
+      r.atMs = now;
+      return true;
+    }
+  }
+  g_rejected[g_rejectedNext].uid = uid;
+  g_rejected[g_rejectedNext].atMs = now;
+  g_rejectedNext = (g_rejectedNext + 1) % REJECTED_CACHE_SIZE;
+  return false;
+}
+
+// Entradas concedidas hace poco (núcleo de acceso): la misma tarjeta otra vez
+// en la misma sesión (misma materia en curso, o ambas fuera de horario) y dentro
+// de REPEAT_TAP_WINDOW_MS sólo vuelve a mostrar el acceso y abrir; no se decide
+// de nuevo ni se escribe otra fila "entrada". La ventana cuenta desde la entrada
+// registrada. Se descarta si la tabla de acceso cambió desde entonces.
+static const size_t RECENT_ENTRY_SIZE = 16;
+
+struct RecentEntry {
+  UidKey uid;
+  String name;
+  CatalogId materiaId;
+  bool inSchedule;
+  uint32_t viewGen;        // AccessView::generation con que se concedió
+  unsigned long atMs;
+};
+static RecentEntry g_recent[RECENT_ENTRY_SIZE];
+static size_t g_recentNext = 0;
+static uint32_t g_repeatTaps = 0;
+static uint32_t g_noClockDecisions = 0;
+
+static RecentEntry *recentEntry(const UidKey &uid, unsigned long now) {
+  for (auto &r : g_recent)
+    if (!r.uid.empty() && r.uid == uid && (now - r.atMs) < REPEAT_TAP_WINDOW_MS) return &r;
+  return nullptr;
+}
+
+static void rememberEntry(const UidKey &uid, const String &name, CatalogId materiaId, bool inSchedule,
+                          uint32_t viewGen, unsigned long now) {
+  RecentEntry *slot = nullptr;
+  for (auto &r : g_recent) if (r.uid == uid) { slot = &r; break; }
+  if (!slot) {
+    slot = &g_recent[g_recentNext];
+    g_recentNext = (g_recentNext + 1) % RECENT_ENTRY_SIZE;
+  }
+  *slot = RecentEntry{uid, name, materiaId, inSchedule, viewGen, now};
 }
 
 // Helper local: intenta añadir UID a CAPTURE_QUEUE_FILE evitando duplicados simples
-static void appendUidToQueueAvoidDup(const String &uid) {
-  if (uid.length() == 0) return;
+// (compara los bytes del UID, no el texto de cada línea)
+static void appendUidToQueueAvoidDup(const UidKey &uid) {
+  if (uid.empty()) return;
   const char *QFILE = CAPTURE_QUEUE_FILE;
   bool exists = false;
   if (SPIFFS.exists(QFILE)) {
     File f = SPIFFS.open(QFILE, FILE_READ);
     if (f) {
-      while (f.available()) {
-        String l = f.readStringUntil('\n'); l.trim();
-        if (l.length() > 0 && l == uid) { exists = true; break; }
+      CsvReader r(f, false);   // la cola es un UID por línea, sin cabecera
+      UidKey k{};
+      while (r.next()) {
+        const char *line = r.line();
+        if (UidKey::parse(line, strlen(line), k) && k == uid) { exists = true; break; }
       }
       f.close();
     }
   }
-  if (!exists) appendLineToFile(QFILE, uid);
-}
-
-// Helper: obtiene lista única de materias asociadas a un teacher (por uid y por courses)
-static std::vector<String> teacherMatsForUID(const String &uid) {
-  std::vector<String> out;
-  // Desde TEACHERS_FILE por uid (si el registro contiene columna de materia)
-  File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (f) {
-    String header = f.readStringUntil('\n'); (void)header;
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String rowUid = c[0];
-        String mat = c[3];
-        if (rowUid == uid && mat.length()) {
-          bool found = false;
-          for (auto &x : out) if (x == mat) { found = true; break; }
-          if (!found) out.push_back(mat);
-        }
-      }
-    }
-    f.close();
-  }
-  // Además, buscar en courses por nombre de profesor (si existe)
-  String teacherName;
-  String trec = findTeacherByUID(uid);
-  if (trec.length()) {
-    auto cc = parseQuotedCSVLine(trec);
-    if (cc.size() > 1) teacherName = cc[1];
-  }
-  if (teacherName.length()) {
-    auto courses = loadCourses();
-    for (auto &c : courses) {
-      if (c.profesor == teacherName) {
-        bool found = false;
-        for (auto &x : out) if (x == c.materia) { found = true; break; }
-        if (!found) out.push_back(c.materia);
-      }
-    }
-  }
-  return out;
+  if (!exists) appendLineToFile(QFILE, uid.toString());
 }
 
-// Handler principal para eventos RFID:
-void rfidLoopHandler() {
-  if (!mfrc522.PICC_IsNewCardPresent()) return;
-  if (!mfrc522.PICC_ReadCardSerial()) return;
-
-  String uid = uidBytesToString(mfrc522.uid.uidByte, mfrc522.uid.size);
-  unsigned long now = millis();
-
-  Serial.printf("---- RFID event (%s) ----\n", nowISO().c_str());
-  Serial.printf("Tarjeta detectada UID=%s\n", uid.c_str());
-
+// Núcleo web: lectura en modo captura o con un auto-registro en curso.
+// 'now' es el instante de la lectura (tarea rfid_reader).
+static void handleCaptureCard(const UidKey &key, unsigned long now) {
+  String uid = key.toString();   // captureUID, páginas y filas CSV usan el texto
   // Bloqueo si hay self-register en batch
   if (captureBatchMode && awaitingSelfRegister) {
     Serial.println("Lectura bloqueada: hay un auto-registro en curso. Ignorando tarjeta.");
@@ -138,8 +147,6 @@ void rfidLoopHandler() {
     captureDetectedAt = now;
     showSelfRegisterBanner(String());
     showTemporaryRedMessage("Espere su turno: registro en curso", 2000UL);
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
     return;
   }
 
@@ -147,7 +154,7 @@ void rfidLoopHandler() {
   if (captureMode) {
     if (captureBatchMode) {
       // Añadir a la cola (evita duplicados)
-      appendUidToQueueAvoidDup(uid);
+      appendUidToQueueAvoidDup(key);
       captureDetectedAt = now;
       Serial.printf("Batch capture: UID %s añadida a la cola.\n", uid.c_str());
 
@@ -165,8 +172,8 @@ void rfidLoopHandler() {
           String teacherRow = findTeacherByUID(uid);
           String teacherName = "";
           if (teacherRow.length()) {
-            auto tc = parseQuotedCSVLine(teacherRow);
-            if (tc.size() > 1) teacherName = tc[1];
+            CsvFields tc;
+            if (tc.split(teacherRow) > 1) teacherName = tc.str(USERS_NAME);
           }
           String notificationMsg = "Tarjeta de maestro detectada en captura por lote y bloqueada: " + (teacherName.length() ? teacherName : String("Sin nombre")) + " (UID: " + uid + ")";
           addNotification(uid, String(""), String(""), notificationMsg);
@@ -184,8 +191,6 @@ void rfidLoopHandler() {
           #endif
 
           // No crear SelfRegSession, no append a la cola (ya evitamos duplicado antes).
-          mfrc522.PICC_HaltA();
-          mfrc522.PCD_StopCrypto1();
           return;
         }
 
@@ -217,8 +222,6 @@ void rfidLoopHandler() {
         }
       }
 
-      mfrc522.PICC_HaltA();
-      mfrc522.PCD_StopCrypto1();
       return;
     }
 
@@ -229,9 +232,10 @@ void rfidLoopHandler() {
       captureName = "";
       captureAccount = "";
       if (found.length() > 0) {
-        auto c = parseQuotedCSVLine(found);
-        captureName = (c.size() > 1 ? c[1] : "");
-        captureAccount = (c.size() > 2 ? c[2] : "");
+        CsvFields c;
+        c.split(found);
+        captureName = c.str(USERS_NAME);
+        captureAccount = c.str(USERS_ACCOUNT);
       }
       captureDetectedAt = now;
       Serial.printf("Capture mode: UID=%s -> name='%s' acc='%s'\n", captureUID.c_str(), captureName.c_str(), captureAccount.c_str());
@@ -245,236 +249,315 @@ void rfidLoopHandler() {
         showCaptureInProgress(false, captureUID);
       }
     }
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
     return;
   }
+}
 
-  // PROCESO NORMAL DE ACCESO
+// ---------------------------------------------------------
+// Núcleo de acceso -> núcleo web
+// ---------------------------------------------------------
+// El núcleo de acceso decide con las vistas publicadas (access_table.h,
+// schedule_table.h), abre la puerta y muestra el resultado; lo demás (registros,
+// notificaciones, modo captura) viaja como CardEvent por card_journal.h y lo
+// hace el núcleo web, que es el único que escribe en el SPIFFS y usa las
+// variables de captura/auto-registro.
+
+static void postCard(CardEvent &ev, const UidKey &uid, const char *uidText, const RfidEvent &rd, time_t at) {
+  ev.uid = uid;
+  ev.atMs = rd.atMs;
+  ev.at = (uint32_t)at;
+  if (!cardJournalPush(ev)) Serial.printf("ERR diario de tarjetas lleno: UID %s sin registro\n", uidText);
+}
 
-  // Leer registros del UID en USERS_FILE
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  std::vector<std::vector<String>> userRows;
-  if (f) {
-    String header = f.readStringUntil('\n');
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() > 0 && c[0] == uid) userRows.push_back(c);
+// Núcleo de acceso: decide una lectura sin tocar archivos ni estado del núcleo web.
+static void decideCard(const RfidEvent &rd) {
+  // Bytes empaquetados: las búsquedas y cachés comparan enteros; el texto hex
+  // (en la pila) sólo para Serial y la pantalla.
+  UidKey uid = UidKey::fromBytes(rd.uid, rd.len);
+  char uidText[UidKey::TEXT_LEN];
+  uid.format(uidText, sizeof(uidText));
+  time_t at = time(nullptr);
+  bool synced = timeIsSynced();   // sin hora: el registro se fecha después con atMs
+  CardEvent ev;
+  memset(&ev, 0, sizeof(ev));
+
+  Serial.printf("---- RFID event (%s) ----\n", isoFromEpoch(at).c_str());
+  Serial.printf("Tarjeta detectada UID=%s\n", uidText);
+
+  // Captura y auto-registro en lote no deciden acceso: los atiende el núcleo web
+  if (captureMode || (captureBatchMode && awaitingSelfRegister)) {
+    ev.kind = CARD_CAPTURE;
+    postCard(ev, uid, uidText, rd, synced ? at : 0);
+    return;
+  }
+
+  // PROCESO NORMAL DE ACCESO
+  uint32_t decideStart = micros();
+  latencyRecord(LAT_QUEUE, decideStart - rd.atUs);
+  std::shared_ptr<const AccessView> view = accessTableView();
+
+  // Materia en horario al momento de la lectura (ID del catálogo; las comparaciones son entre enteros).
+  // Modo degradado sin hora (NTP aún no sincroniza o no hay red): no se sabe qué
+  // clase está en curso y se decide como fuera de horario, es decir, pasa quien
+  // tenga alguna materia y queda la notificación "fuera de horario". Se prefiere
+  // a dejar la puerta cerrada mientras falte la red; la lectura se registra igual
+  // (con fecha cuando haya hora) y /status cuenta estas decisiones.
+  int minute = 0;
+  int dayIndex = synced ? localDayMinute(at, minute) : -1;
+  if (!synced) g_noClockDecisions++;
+  std::shared_ptr<const ScheduleWeek> week = scheduleTableWeek();
+  CatalogId scheduleMatId = (week && dayIndex >= 0) ? week->owner(dayIndex, minute) : 0;
+
+  bool grant = false;
+  bool repeat = false;
+  String name;     // concedido: nombre en pantalla
+  String shown;    // concedido: materia; denegado: motivo
+  const AccessEntry *e = nullptr;
+
+  // Segunda pasada de la misma tarjeta en la misma sesión: sin registro
+  RecentEntry *rep = recentEntry(uid, rd.atMs);
+  if (rep && view && rep->viewGen == view->generation && rep->inSchedule == (scheduleMatId != 0) &&
+      (!rep->inSchedule || rep->materiaId == scheduleMatId)) {
+    g_repeatTaps++;
+    repeat = grant = true;
+    name = rep->name;
+    shown = view->materiaName(rep->materiaId);
+  } else {
+    // Rol y materias del UID desde la vista en RAM (access_table.h): sin leer
+    // USERS_FILE/TEACHERS_FILE ni courses para decidir.
+    const AccessEntry *student = view ? view->findStudent(uid) : nullptr;
+    const AccessEntry *teacher = (view && !student) ? view->findTeacher(uid) : nullptr;
+    e = student ? student : teacher;
+    ev.teacher = (teacher != nullptr);
+    ev.inSchedule = (scheduleMatId != 0);
+
+    if (!e) {
+      // Si no existe ni user ni teacher -> denegar (tarjeta desconocida)
+      ev.kind = CARD_DENIED_UNKNOWN;
+      shown = "Tarjeta no registrada";
+    } else if (scheduleMatId != 0) {
+      // Horario sólo con materia: alumno o maestro deben tenerla asignada
+      ev.materiaId = scheduleMatId;
+      grant = accessHasMateria(e, scheduleMatId);
+      ev.kind = grant ? CARD_GRANTED : CARD_DENIED_MATERIA;
+      shown = grant ? view->materiaName(scheduleMatId)
+                    : String(teacher ? "No asignado a: " : "No pertenece a: ") + view->materiaName(scheduleMatId);
+    } else if (!e->mats.empty()) {
+      // NO HAY CLASE: se permite con su primera materia y se notifica (fuera de horario)
+      grant = true;
+      ev.kind = CARD_GRANTED;
+      ev.materiaId = e->mats[0];
+      shown = view->materiaName(ev.materiaId);
+    } else {
+      ev.kind = CARD_DENIED_NO_MATS;
+      shown = teacher ? "Sin materia asignada (teacher)" : "Sin materia asignada";
     }
-    f.close();
+    if (e) name = e->name;
+  }
+  uint32_t decided = micros();   // tarjeta -> decisión (sin flash)
+  latencyRecord(LAT_DECIDE, decided - decideStart);
+  Serial.printf("UID %s -> %s%s (materia en curso '%s', decisión en %lu us)\n", uidText,
+                grant ? "CONCEDIDO" : "DENEGADO", repeat ? ", ya registrado en esta sesión" : "",
+                view ? view->materiaName(scheduleMatId).c_str() : "", (unsigned long)(decided - decideStart));
+
+  // Actuar antes de cualquier registro: puerta y luego pantalla. Las etapas no
+  // se solapan: DISPLAY cuenta desde que terminó la puerta (o la decisión).
+  uint32_t drawStart = decided;
+  if (grant) {
+    doorOpen();
+    drawStart = micros();
+    latencyRecord(LAT_DOOR, drawStart - decided);
+    showAccessGranted(name, shown, String(uidText));
   } else {
-    Serial.println("WARN: no se pudo abrir USERS_FILE (SPIFFS).");
+    showAccessDenied(shown, String(uidText));
   }
+  uint32_t done = micros();
+  latencyRecord(LAT_DISPLAY, done - drawStart);
+  latencyRecord(LAT_TOTAL, done - rd.atUs);
+  bootMarkFirstTap();
+
+  if (repeat) return;
+  if (grant) rememberEntry(uid, name, ev.materiaId, ev.inSchedule, view->generation, rd.atMs);
+  postCard(ev, uid, uidText, rd, synced ? at : 0);
+}
 
-  // Revisar TEACHERS_FILE
-  String teacherRow = findTeacherByUID(uid);
-  bool isTeacher = (teacherRow.length() > 0);
-
-  // Si no existe ni user ni teacher -> denegar (tarjeta desconocida)
-  if (userRows.size() == 0 && !isTeacher) {
-    Serial.printf("UID %s no registrado -> DENEGADO\n", uid.c_str());
-    String recDenied = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"NO REGISTRADO\"";
-    appendLineToFile(DENIED_FILE, recDenied);
-    String note = "Tarjeta no registrada (UID: " + uid + ")";
-    addNotification(uid, String(""), String(""), note);
-    showAccessDenied("Tarjeta no registrada", uid);
-    ledOff();
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
+// Núcleo web: registros y notificaciones de una decisión (mismos textos que
+// cuando se escribían al decidir), con la hora de la lectura.
+static void recordCard(const CardEvent &ev, const String &uid) {
+  String ts = isoFromEpoch((time_t)ev.at);
+
+  if (ev.kind == CARD_DENIED_UNKNOWN) {
+    // lecturas repetidas de la misma tarjeta: sólo se registra/notifica la primera
+    if (!rejectedRecently(ev.uid, ev.atMs)) {
+      String recDenied = "\"" + ts + "\"," + "\"" + uid + "\"," + "\"NO REGISTRADO\"";
+      appendLineToFile(DENIED_FILE, recDenied);
+      String note = "Tarjeta no registrada (UID: " + uid + ")";
+      addNotification(uid, String(""), String(""), note);
+    }
     return;
   }
 
-  // Materia en horario actual
-  String scheduleOwner = currentScheduledMateria(); // puede ser "Materia" o "Materia||Profesor"
-  String scheduleBaseMat = baseMateriaFromOwner(scheduleOwner);
-  scheduleBaseMat.trim();
-  Serial.printf("Schedule base materia detectada: '%s'\n", scheduleBaseMat.c_str());
-
-  // Detectar si owner incluye profesor (clave compuesta)
-  String scheduleOwnerProf = "";
-  bool scheduleOwnerHasProf = false;
-  int soidx = scheduleOwner.indexOf("||");
-  if (soidx >= 0) {
-    scheduleOwnerProf = scheduleOwner.substring(soidx + 2);
-    scheduleOwnerProf.trim();
-    scheduleOwnerHasProf = true;
-  }
+  String mat = catalogMateriaName(ev.materiaId);
 
   // Lógica para ALUMNOS
-  if (userRows.size() > 0) {
-    String name = (userRows.size() > 0 && userRows[0].size() > 1 ? userRows[0][1] : "");
-    String account = (userRows.size() > 0 && userRows[0].size() > 2 ? userRows[0][2] : "");
-
-    std::vector<String> userMats;
-    std::vector<String> userMatsLower;
-    for (auto &r : userRows) {
-      if (r.size() > 3) {
-        String mm = normMat(r[3]);
-        String mmLower = lowerCopy(mm);
-        bool found = false;
-        for (auto &ul : userMatsLower) if (ul == mmLower) { found = true; break; }
-        if (!found) {
-          userMats.push_back(mm);
-          userMatsLower.push_back(mmLower);
-        }
-      }
-    }
-
-    if (scheduleBaseMat.length() > 0) {
-      String wantMat = normMat(scheduleBaseMat);
-      String wantMatLower = lowerCopy(wantMat);
-      bool hasCurrent = false;
-      for (auto &mmLower : userMatsLower) {
-        if (mmLower == wantMatLower) { hasCurrent = true; break; }
-      }
-
-      if (hasCurrent) {
-        String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + name + "\"," + "\"" + account + "\"," + "\"" + wantMat + "\"," + "\"entrada\"";
-        appendLineToFile(ATT_FILE, rec);
-        // abrir puerta en acceso concedido
-        puerta.write(90);
-        showAccessGranted(name, wantMat, uid);
-        puerta.write(0);
-        ledOff();
-      } else {
-        String mmstr = joinMats(userMats);
-        String note = "Intento fuera de materia en curso. Usuario: " + name + " (" + account + "). Materias del usuario: " + mmstr + ". Materia en curso: " + wantMat;
-        addNotification(uid, name, account, note);
-        String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + note + "\"";
-        appendLineToFile(DENIED_FILE, rec);
-        showAccessDenied(String("No pertenece a: ") + wantMat, uid);
-        ledOff();
-        mfrc522.PICC_HaltA();
-        mfrc522.PCD_StopCrypto1();
-        return;
-      }
-    } else {
-      // NO HAY CLASE EN ESTE MOMENTO (scheduleBaseMat vacío)
-      if (!userMats.empty()) {
-        // Permitir entrada pero registrar notificación informativa que entró fuera de horario
-        String chosenMat = userMats[0];
-        String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + name + "\"," + "\"" + account + "\"," + "\"" + chosenMat + "\"," + "\"entrada\"";
-        appendLineToFile(ATT_FILE, rec);
+  if (!ev.teacher) {
+    // nombre y cuenta para el registro: fila del UID vía uid_index
+    auto userRows = uidIndexUserRows(uid);
+    CsvFields uc;
+    if (!userRows.empty()) uc.split(userRows[0]);
+    String name = userRows.empty() ? String() : uc.str(USERS_NAME);
+    String account = userRows.empty() ? String() : uc.str(USERS_ACCOUNT);
+
+    if (ev.kind == CARD_GRANTED) {
+      String rec = "\"" + ts + "\"," + "\"" + uid + "\"," + "\"" + name + "\"," + "\"" + account + "\"," + "\"" + mat + "\"," + "\"entrada\"";
+      appendLineToFile(ATT_FILE, rec);
+      if (!ev.inSchedule) {
         // Notificación: entrada fuera de horario (Alumno)
-        String note = "Entrada fuera de horario (Alumno). Usuario: " + name + " (" + account + "). Materia asignada: " + chosenMat;
+        String note = "Entrada fuera de horario (Alumno). Usuario: " + name + " (" + account + "). Materia asignada: " + mat;
         addNotification(uid, name, account, note);
-        puerta.write(90);
-        showAccessGranted(name, chosenMat, uid);
-        puerta.write(0);
-        ledOff();
-      } else {
-        // Usuario sin materias asignadas -> denegar y notificar
-        String note = "Intento de acceso sin materia asignada. UID: " + uid + " Nombre: " + (userRows.size() ? (userRows[0].size()>1?userRows[0][1]:"") : "");
-        addNotification(uid, String(""), String(""), note);
-        appendLineToFile(DENIED_FILE, String("\"") + nowISO() + String("\",\"") + uid + String("\",\"NO MATERIA\""));
-        showAccessDenied("Sin materia asignada", uid);
-        ledOff();
-        mfrc522.PICC_HaltA();
-        mfrc522.PCD_StopCrypto1();
-        return;
       }
+    } else if (ev.kind == CARD_DENIED_MATERIA) {
+      const AccessEntry *student = accessFindStudent(ev.uid);
+      String mmstr = student ? joinMats(student->mats) : String();
+      String note = "Intento fuera de materia en curso. Usuario: " + name + " (" + account + "). Materias del usuario: " + mmstr + ". Materia en curso: " + mat;
+      addNotification(uid, name, account, note);
+      String rec = "\"" + ts + "\"," + "\"" + uid + "\"," + "\"" + note + "\"";
+      appendLineToFile(DENIED_FILE, rec);
+    } else {
+      // Usuario sin materias asignadas -> denegar y notificar
+      String note = "Intento de acceso sin materia asignada. UID: " + uid + " Nombre: " + name;
+      addNotification(uid, String(""), String(""), note);
+      appendLineToFile(DENIED_FILE, String("\"") + ts + String("\",\"") + uid + String("\",\"NO MATERIA\""));
     }
-
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
     return;
   }
 
   // Lógica para TEACHERS (acceso normal fuera de modo captura)
-  if (isTeacher) {
-    auto cols = parseQuotedCSVLine(teacherRow);
-    String tname = (cols.size() > 1 ? cols[1] : "");
-    String tacc = (cols.size() > 2 ? cols[2] : "");
-
-    // Obtener las materias registradas para este maestro (por UID y por courses)
-    std::vector<String> tmats = teacherMatsForUID(uid);
-
-    if (scheduleBaseMat.length() > 0) {
-      String wantMat = normMat(scheduleBaseMat);
-      String wantMatLower = lowerCopy(wantMat);
-
-      // Si el horario especifica profesor (clave compuesta "Materia||Profesor"),
-      // sólo permitir el acceso al profesor exacto que aparece en la clave.
-      if (scheduleOwnerHasProf) {
-        // Comparación case-insensitive del nombre del profesor asignado en el horario
-        if (lowerCopy(tname) == lowerCopy(scheduleOwnerProf)) {
-          // Profesor es exactamente el asignado en el horario -> permitir acceso
-          String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + tname + "\"," + "\"" + tacc + "\"," + "\"" + wantMat + "\"," + "\"entrada-teacher\"";
-          appendLineToFile(ATT_FILE, rec);
-          puerta.write(90);
-          showAccessGranted(tname, wantMat, uid);
-          puerta.write(0);
-          ledOff();
-        } else {
-          // Profesor distinto al asignado -> denegar y notificar
-          String mmstr = joinMats(tmats);
-          String note = "Intento fuera de materia en curso (teacher). Maestro: " + tname + " (" + tacc + "). Materias del maestro: " + mmstr + ". Materia en curso: " + scheduleOwner;
-          addNotification(uid, tname, tacc, note);
-          appendLineToFile(DENIED_FILE, String("\"") + nowISO() + String("\",\"") + uid + String("\",\"NO MATERIA TEACHER\""));
-          showAccessDenied(String("No asignado a: ") + wantMat, uid);
-          ledOff();
-          mfrc522.PICC_HaltA();
-          mfrc522.PCD_StopCrypto1();
-          return;
-        }
-      } else {
-        // Horario no especifica profesor (sólo materia) -> permitir si el maestro tiene esa materia
-        bool hasCurrent = false;
-        for (auto &m : tmats) {
-          if (lowerCopy(m) == wantMatLower) { hasCurrent = true; break; }
-        }
-        if (hasCurrent) {
-          String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + tname + "\"," + "\"" + tacc + "\"," + "\"" + wantMat + "\"," + "\"entrada-teacher\"";
-          appendLineToFile(ATT_FILE, rec);
-          puerta.write(90);
-          showAccessGranted(tname, wantMat, uid);
-          puerta.write(0);
-          ledOff();
-        } else {
-          String mmstr = joinMats(tmats);
-          String note = "Intento fuera de materia en curso (teacher). Maestro: " + tname + " (" + tacc + "). Materias del maestro: " + mmstr + ". Materia en curso: " + wantMat;
-          addNotification(uid, tname, tacc, note);
-          appendLineToFile(DENIED_FILE, String("\"") + nowISO() + String("\",\"") + uid + String("\",\"NO MATERIA TEACHER\""));
-          showAccessDenied(String("No asignado a: ") + wantMat, uid);
-          ledOff();
-          mfrc522.PICC_HaltA();
-          mfrc522.PCD_StopCrypto1();
-          return;
-        }
-      }
-    } else {
-      // NO HAY CLASE: si maestro tiene materias, permitir y notificar (entrada fuera de horario maestro)
-      if (!tmats.empty()) {
-        String chosenMat = tmats[0];
-        String rec = "\"" + nowISO() + "\"," + "\"" + uid + "\"," + "\"" + tname + "\"," + "\"" + tacc + "\"," + "\"" + chosenMat + "\"," + "\"entrada-teacher\"";
-        appendLineToFile(ATT_FILE, rec);
-        // Notificar entrada de maestro fuera de horario
-        String note = "Entrada fuera de horario (Maestro). Maestro: " + tname + " (" + tacc + "). Materia: " + chosenMat;
-        addNotification(uid, tname, tacc, note);
-        puerta.write(90);
-        showAccessGranted(tname, chosenMat, uid);
-        puerta.write(0);
-        ledOff();
-      } else {
-        String note = "Intento de acceso (teacher) sin materias asignadas. UID: " + uid + " Nombre: " + tname;
-        addNotification(uid, tname, tacc, note);
-        appendLineToFile(DENIED_FILE, String("\"") + nowISO() + String("\",\"") + uid + String("\",\"NO MATERIA TEACHER\""));
-        showAccessDenied("Sin materia asignada (teacher)", uid);
-        ledOff();
-        mfrc522.PICC_HaltA();
-        mfrc522.PCD_StopCrypto1();
-        return;
-      }
+  CsvFields cols;
+  cols.split(findTeacherByUID(uid));
+  String tname = cols.str(USERS_NAME);
+  String tacc = cols.str(USERS_ACCOUNT);
+
+  if (ev.kind == CARD_GRANTED) {
+    String rec = "\"" + ts + "\"," + "\"" + uid + "\"," + "\"" + tname + "\"," + "\"" + tacc + "\"," + "\"" + mat + "\"," + "\"entrada-teacher\"";
+    appendLineToFile(ATT_FILE, rec);
+    if (!ev.inSchedule) {
+      // Notificar entrada de maestro fuera de horario
+      String note = "Entrada fuera de horario (Maestro). Maestro: " + tname + " (" + tacc + "). Materia: " + mat;
+      addNotification(uid, tname, tacc, note);
     }
+  } else if (ev.kind == CARD_DENIED_MATERIA) {
+    const AccessEntry *teacher = accessFindTeacher(ev.uid);
+    String mmstr = teacher ? joinMats(teacher->mats) : String();
+    String note = "Intento fuera de materia en curso (teacher). Maestro: " + tname + " (" + tacc + "). Materias del maestro: " + mmstr + ". Materia en curso: " + mat;
+    addNotification(uid, tname, tacc, note);
+    appendLineToFile(DENIED_FILE, String("\"") + ts + String("\",\"") + uid + String("\",\"NO MATERIA TEACHER\""));
+  } else {
+    String note = "Intento de acceso (teacher) sin materias asignadas. UID: " + uid + " Nombre: " + tname;
+    addNotification(uid, tname, tacc, note);
+    appendLineToFile(DENIED_FILE, String("\"") + ts + String("\",\"") + uid + String("\",\"NO MATERIA TEACHER\""));
+  }
+}
 
-    mfrc522.PICC_HaltA();
-    mfrc522.PCD_StopCrypto1();
-    return;
+// ---------------------------------------------------------
+// Lecturas sin hora
+// ---------------------------------------------------------
+// Sin NTP no hay fecha para las filas. Las lecturas no esperan en el diario (se
+// llenaría en unos minutos de entrada): el núcleo web las pasa a UNDATED_FILE
+// con su millis() y el identificador del arranque, y cuando hay hora las
+// registra con la fecha corregida y borra el archivo. Así ninguna fila queda
+// fechada en 1970, aunque NTP tarde horas en sincronizar.
+static uint32_t g_bootId = 0;           // != 0: distingue el millis() de otro arranque
+static bool g_undatedPending = false;   // UNDATED_FILE tiene lecturas por registrar
+
+static uint32_t bootId() {
+  if (!g_bootId) g_bootId = esp_random() | 1;
+  return g_bootId;
+}
+
+static uint32_t fieldU32(const CsvField &f) { return (uint32_t)strtoul(f.toString().c_str(), nullptr, 10); }
+
+// Fecha de una lectura hecha sin hora: ahora menos lo transcurrido desde ella.
+// El millis() de otro arranque no sirve: se toma el inicio de éste (la lectura
+// fue anterior).
+static uint32_t undatedEpoch(uint32_t atMs, bool thisBoot) {
+  uint32_t ago = thisBoot ? millis() - atMs : millis();
+  return (uint32_t)(time(nullptr) - (time_t)(ago / 1000UL));
+}
+
+static void spillUndated(const CardEvent &ev, bool replayed) {
+  char uidText[UidKey::TEXT_LEN];
+  ev.uid.format(uidText, sizeof(uidText));
+  char line[96];
+  snprintf(line, sizeof(line), "\"%lu\",\"%lu\",\"%u\",\"%u\",\"%u\",\"%u\",\"%s\"",
+           (unsigned long)(replayed ? 0 : bootId()), (unsigned long)ev.atMs, (unsigned)ev.kind,
+           (unsigned)ev.teacher, (unsigned)ev.inSchedule, (unsigned)ev.materiaId, uidText);
+  if (appendLineToFile(UNDATED_FILE, String(line))) g_undatedPending = true;
+  else Serial.printf("ERR lectura sin hora sin guardar: UID %s\n", uidText);
+}
+
+// Ya con hora: registra lo guardado en UNDATED_FILE, en orden, y lo borra.
+static void recordUndated() {
+  File f = SPIFFS.open(UNDATED_FILE, FILE_READ);
+  if (f) {
+    CsvReader r(f, false);
+    while (r.next()) {
+      if (r.size() < 7) continue;
+      CardEvent ev;
+      memset(&ev, 0, sizeof(ev));
+      if (!UidKey::parse(r[6].ptr, r[6].len, ev.uid)) continue;
+      uint32_t boot = fieldU32(r[0]);
+      ev.atMs = fieldU32(r[1]);
+      ev.kind = (uint8_t)r[2].toInt();
+      ev.teacher = r[3].toInt() != 0;
+      ev.inSchedule = r[4].toInt() != 0;
+      ev.materiaId = (CatalogId)r[5].toInt();
+      ev.at = undatedEpoch(ev.atMs, boot != 0 && boot == g_bootId);
+      recordCard(ev, ev.uid.toString());
+    }
+    f.close();
   }
+  logWriterSync();   // los registros en flash antes de borrar el archivo
+  SPIFFS.remove(UNDATED_FILE);
+  g_undatedPending = false;
+}
+
+void rfidHandlerBegin() {
+  cardJournalBegin();   // recupera las lecturas sin registrar de antes de un reinicio
+  g_undatedPending = SPIFFS.exists(UNDATED_FILE);   // sin hora en un arranque anterior
+}
 
-  // Fallback
-  mfrc522.PICC_HaltA();
-  mfrc522.PCD_StopCrypto1();
+// Núcleo de acceso, en cada vuelta de loop(): decide las lecturas que dejó la tarea del lector.
+void rfidLoopHandler() {
+  RfidEvent rd;
+  rfidReaderPoll();   // sólo si la tarea del lector no arrancó
+  while (rfidReaderPop(rd)) decideCard(rd);
 }
+
+// Núcleo web: registra las decisiones y atiende las lecturas de modo captura.
+void rfidEventsLoop() {
+  bool synced = timeIsSynced();
+  if (synced && g_undatedPending) recordUndated();   // antes que las lecturas posteriores
+
+  CardEvent ev;
+  bool replayed = false;
+  while (cardJournalNext(ev, replayed)) {
+    if (ev.kind == CARD_CAPTURE) {
+      if (!replayed) handleCaptureCard(ev.uid, ev.atMs);   // la captura no sobrevive al reinicio
+      continue;
+    }
+    if (!ev.at) {
+      // leída sin hora: a UNDATED_FILE hasta tener hora, o fechada ya
+      if (!synced) { spillUndated(ev, replayed); continue; }
+      ev.at = undatedEpoch(ev.atMs, !replayed);
+    }
+    uint32_t t0 = micros();
+    recordCard(ev, ev.uid.toString());   // texto hex sólo para las filas y notificaciones
+    latencyRecord(LAT_RECORD, micros() - t0);
+  }
+  // sin nada en la cola de log_writer, lo registrado ya está en flash
+  if (logWriterPending() == 0) cardJournalCommit();
+}
+
+uint32_t rfidRepeatTaps() { return g_repeatTaps; }
+uint32_t rfidNoClockDecisions() { return g_noClockDecisions; }
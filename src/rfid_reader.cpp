@@ -0,0 +1,92 @@
+// src/rfid_reader.cpp
+#include <Arduino.h>
+#include <SPI.h>
+#include <MFRC522.h>
+#include <atomic>
+#include <string.h>
+
+#include "rfid_reader.h"
+#include "config.h"
+#include "globals.h"
+#include "latency_stats.h"
+
+static const uint32_t RING_SIZE = 16;     // potencia de 2
+
+static RfidEvent g_ring[RING_SIZE];
+static std::atomic<uint32_t> g_head(0);   // lo escribe sólo la tarea lectora
+static std::atomic<uint32_t> g_tail(0);   // lo escribe sólo el consumidor (loop)
+static uint32_t g_reads = 0;
+static uint32_t g_drops = 0;
+static uint32_t g_maxDepth = 0;
+static TaskHandle_t g_task = nullptr;
+static bool g_fallback = false;           // sin tarea: sondea loop() (rfidReaderPoll)
+static uint32_t g_lastPollMs = 0;
+
+static bool push(const uint8_t *uid, uint8_t len, uint32_t atMs, uint32_t atUs) {
+  uint32_t head = g_head.load(std::memory_order_relaxed);
+  uint32_t depth = head - g_tail.load(std::memory_order_acquire);
+  if (depth >= RING_SIZE) { g_drops++; return false; }
+  RfidEvent &ev = g_ring[head & (RING_SIZE - 1)];
+  if (len > sizeof(ev.uid)) len = sizeof(ev.uid);
+  memcpy(ev.uid, uid, len);
+  ev.len = len;
+  ev.atMs = atMs;
+  ev.atUs = atUs;
+  g_head.store(head + 1, std::memory_order_release);   // publica el evento completo
+  g_reads++;
+  if (depth + 1 > g_maxDepth) g_maxDepth = depth + 1;
+  return true;
+}
+
+// Un sondeo del lector: si hay tarjeta, la deja en el anillo.
+static void pollOnce() {
+  uint32_t t0 = micros();
+  if (mfrc522.PICC_IsNewCardPresent() && mfrc522.PICC_ReadCardSerial()) {
+    latencyRecord(LAT_READ, micros() - t0);
+    uint32_t at = millis();
+    if (!push(mfrc522.uid.uidByte, mfrc522.uid.size, at, t0))
+      Serial.println("ERR rfidReader: anillo lleno, lectura descartada");
+    mfrc522.PICC_HaltA();
+    mfrc522.PCD_StopCrypto1();
+  }
+}
+
+static void readerTask(void *) {
+  for (;;) {
+    pollOnce();
+    vTaskDelay(pdMS_TO_TICKS(POLL_INTERVAL));
+  }
+}
+
+void rfidReaderBegin() {
+  if (g_task) return;
+  // mismo núcleo que loop() (núcleo de acceso), que es quien vacía el anillo
+  if (xTaskCreatePinnedToCore(readerTask, "rfid", 4096, nullptr, 2, &g_task, xPortGetCoreID()) != pdPASS) {
+    // sin la tarea nadie leería el MFRC522: lo sondea loop() como antes
+    g_task = nullptr;
+    g_fallback = true;
+    Serial.println("ERR rfidReader: no se pudo crear la tarea, se sondea desde loop()");
+    return;
+  }
+  Serial.printf("rfidReader: tarea de lectura cada %lums\n", (unsigned long)POLL_INTERVAL);
+}
+
+void rfidReaderPoll() {
+  if (!g_fallback) return;
+  uint32_t now = millis();
+  if (now - g_lastPollMs < POLL_INTERVAL) return;
+  g_lastPollMs = now;
+  pollOnce();
+}
+
+bool rfidReaderPop(RfidEvent &ev) {
+  uint32_t tail = g_tail.load(std::memory_order_relaxed);
+  if (tail == g_head.load(std::memory_order_acquire)) return false;
+  ev = g_ring[tail & (RING_SIZE - 1)];
+  g_tail.store(tail + 1, std::memory_order_release);   // libera la casilla
+  return true;
+}
+
+uint32_t rfidReaderReads() { return g_reads; }
+uint32_t rfidReaderDrops() { return g_drops; }
+uint32_t rfidReaderMaxDepth() { return g_maxDepth; }
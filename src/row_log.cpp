@@ -0,0 +1,222 @@
+// src/row_log.cpp
+#include "row_log.h"
+#include "config.h"
+#include "globals.h"
+#include "files_utils.h"
+#include "csv_reader.h"
+#include "uid_index.h"
+#include "log_writer.h"
+#include "notif_store.h"
+#include "access_table.h"
+#include <SPIFFS.h>
+#include <algorithm>
+#include <string.h>
+
+static const size_t ROWLOG_COMPACT_ROWS = 16;          // lápidas para compactar
+static const uint32_t ROWLOG_COMPACT_BYTES = 2048;     // o bytes muertos
+static const unsigned long ROWLOG_IDLE_MS = 10000;     // sin cambios en el archivo
+
+struct DeadSet {
+  const char *path;
+  std::vector<uint32_t> offs;   // ordenados
+  uint32_t deadBytes;
+  unsigned long lastChange;
+};
+
+static DeadSet g_sets[3];
+static size_t g_setCount = 0;
+static uint32_t g_compactions = 0;
+
+static DeadSet *setFor(const char *path) {
+  if (!path) return nullptr;
+  for (size_t i = 0; i < g_setCount; ++i)
+    if (g_sets[i].path == path || strcmp(g_sets[i].path, path) == 0) return &g_sets[i];
+  return nullptr;
+}
+
+static String sidecarPath(const char *path) { return String(path) + ".del"; }
+static String tempPath(const char *path) { return String(path) + ".tmp"; }
+
+// FNV-1a de la fila (ya sin \r\n ni espacios extremos)
+static uint32_t rowHash(const char *p, size_t n) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < n; ++i) { h ^= (uint8_t)p[i]; h *= 16777619UL; }
+  return h;
+}
+
+static String hex32(uint32_t v) {
+  char buf[9];
+  snprintf(buf, sizeof(buf), "%08lx", (unsigned long)v);
+  return String(buf);
+}
+
+// Compactación interrumpida: el temporal sólo es válido si el original ya se borró.
+static void recoverCompaction(const char *path) {
+  String tmp = tempPath(path);
+  if (!SPIFFS.exists(tmp)) return;
+  if (!SPIFFS.exists(path)) {
+    SPIFFS.rename(tmp, path);
+    Serial.printf("rowLog: compactación de %s completada tras reinicio\n", path);
+  } else {
+    SPIFFS.remove(tmp);
+  }
+}
+
+// Carga las lápidas de 'path' y descarta las que ya no apuntan a su fila.
+static void loadSidecar(DeadSet &s) {
+  s.offs.clear();
+  s.deadBytes = 0;
+  String side = sidecarPath(s.path);
+  if (!SPIFFS.exists(side)) return;
+  std::vector<std::pair<uint32_t, uint32_t>> marks;   // offset, hash
+  File f = SPIFFS.open(side, FILE_READ);
+  if (f) {
+    CsvReader r(f, false);
+    while (r.next()) {
+      if (r.size() < 2) continue;
+      marks.push_back(std::make_pair((uint32_t)r[0].toInt(), (uint32_t)strtoul(r.str(1).c_str(), nullptr, 16)));
+    }
+    f.close();
+  }
+  // s.offs sigue vacío durante la verificación: el lector no salta ninguna fila
+  std::vector<uint32_t> live;
+  size_t stale = 0;
+  File d = SPIFFS.open(s.path, FILE_READ);
+  for (auto &m : marks) {
+    bool ok = false;
+    if (d && d.seek(m.first)) {
+      CsvReader r(d, false);
+      if (r.next() && r.offset() == m.first) {
+        String line = r.lineString();
+        ok = rowHash(line.c_str(), line.length()) == m.second;
+        if (ok) s.deadBytes += line.length() + 2;
+      }
+    }
+    if (ok) live.push_back(m.first);
+    else stale++;
+  }
+  if (d) d.close();
+  std::sort(live.begin(), live.end());
+  live.erase(std::unique(live.begin(), live.end()), live.end());
+  s.offs.swap(live);
+  if (s.offs.empty()) SPIFFS.remove(side);
+  if (stale) Serial.printf("rowLog: %u lápidas obsoletas descartadas en %s\n", (unsigned)stale, s.path);
+}
+
+void rowLogBegin() {
+  const char *paths[] = { USERS_FILE, TEACHERS_FILE, NOTIF_FILE };
+  g_setCount = 0;
+  for (const char *p : paths) {
+    DeadSet &s = g_sets[g_setCount++];
+    s.path = p;
+    s.lastChange = 0;
+    recoverCompaction(p);
+    loadSidecar(s);
+  }
+  Serial.printf("rowLog: %u filas borradas pendientes de compactar\n", (unsigned)rowLogDeadCount());
+}
+
+const std::vector<uint32_t> *rowLogDeadRows(const char *path) {
+  DeadSet *s = setFor(path);
+  return (s && !s->offs.empty()) ? &s->offs : nullptr;
+}
+
+bool rowLogDelete(const char *path, uint32_t offset, const String &line) {
+  DeadSet *s = setFor(path);
+  if (!s) { Serial.printf("ERR rowLogDelete %s\n", path); return false; }
+  auto it = std::lower_bound(s->offs.begin(), s->offs.end(), offset);
+  if (it != s->offs.end() && *it == offset) return true;   // ya borrada
+  String t = line; t.trim();
+  String mark = "\"" + String(offset) + "\",\"" + hex32(rowHash(t.c_str(), t.length())) + "\"";
+  if (!appendLineToFile(sidecarPath(path).c_str(), mark)) return false;
+  s->offs.insert(it, offset);
+  s->deadBytes += t.length() + 2;
+  s->lastChange = millis();
+  accessTableReset(path);   // baja de alumno/maestro: la tabla de acceso se rehace
+  return true;
+}
+
+// Primero la fila nueva y después la lápida: si falla el append la fila vieja
+// sigue viva; si falla la lápida quedan las dos (visible y corregible), nunca ninguna.
+bool rowLogUpdate(const char *path, uint32_t offset, const String &oldLine, const String &newLine) {
+  if (!appendLineToFile(path, newLine)) return false;
+  if (!rowLogDelete(path, offset, oldLine)) {
+    Serial.printf("ERR rowLogUpdate %s: fila nueva añadida, la anterior (offset %lu) sigue viva\n",
+                  path, (unsigned long)offset);
+    return false;
+  }
+  return true;
+}
+
+void rowLogResetFile(const char *path) {
+  DeadSet *s = setFor(path);
+  if (!s || s->offs.empty()) return;
+  std::vector<uint32_t>().swap(s->offs);
+  s->deadBytes = 0;
+  SPIFFS.remove(sidecarPath(path));
+}
+
+bool rowLogCompact(const char *path) {
+  DeadSet *s = setFor(path);
+  if (!s || s->offs.empty()) return true;
+  unsigned long t0 = millis();
+  if (logWriterHandles(path)) logWriterSync();
+  String tmp = tempPath(path);
+  File in = SPIFFS.open(path, FILE_READ);
+  if (!in) return false;
+  File out = SPIFFS.open(tmp, FILE_WRITE);
+  if (!out) { in.close(); Serial.printf("ERR compact %s\n", path); return false; }
+  size_t dropped = s->offs.size();
+  size_t expected = 0, written = 0;
+  CsvReader r(in, false);               // cabecera incluida; salta las filas con lápida
+  while (r.next()) {
+    String line = r.lineString();
+    expected += line.length() + 2;      // println añade \r\n
+    written += out.println(line);
+  }
+  in.close();
+  size_t outSize = out.size();
+  out.close();
+  // Flash llena o fallo de escritura: el temporal está truncado. Se descarta y
+  // se conservan el original y sus lápidas (se reintentará más tarde).
+  if (written != expected || outSize != expected) {
+    SPIFFS.remove(tmp);
+    s->lastChange = millis();
+    Serial.printf("ERR compact %s: escritos %u de %u bytes, se conserva el original\n",
+                  path, (unsigned)outSize, (unsigned)expected);
+    return false;
+  }
+  SPIFFS.remove(path);
+  if (!SPIFFS.rename(tmp, path)) {
+    Serial.printf("ERR rename %s\n", tmp.c_str());
+    return false;                       // rowLogBegin() lo recupera al reiniciar
+  }
+  std::vector<uint32_t>().swap(s->offs);
+  s->deadBytes = 0;
+  SPIFFS.remove(sidecarPath(path));
+  if (uidIndexTracksFile(path)) uidIndexRebuildFile(path);   // los offsets cambiaron
+  if (strcmp(path, NOTIF_FILE) == 0) notifStoreResync();      // el tamaño guardado también
+  g_compactions++;
+  Serial.printf("rowLog: %s compactado (%u filas), %lums\n", path, (unsigned)dropped, millis() - t0);
+  return true;
+}
+
+void rowLogLoop() {
+  unsigned long now = millis();
+  for (size_t i = 0; i < g_setCount; ++i) {
+    DeadSet &s = g_sets[i];
+    if (s.offs.empty()) continue;
+    if (s.offs.size() < ROWLOG_COMPACT_ROWS && s.deadBytes < ROWLOG_COMPACT_BYTES) continue;
+    if (now - s.lastChange < ROWLOG_IDLE_MS) continue;
+    rowLogCompact(s.path);
+    return;   // un archivo por vuelta de loop()
+  }
+}
+
+size_t rowLogDeadCount() {
+  size_t n = 0;
+  for (size_t i = 0; i < g_setCount; ++i) n += g_sets[i].offs.size();
+  return n;
+}
+
+uint32_t rowLogCompactions() { return g_compactions; }
@@ -0,0 +1,193 @@
+// src/schedule_table.cpp
+#include "schedule_table.h"
+#include "globals.h"
+#include "config.h"
+#include "files_utils.h"
+#include <vector>
+#include <algorithm>
+
+// horario [from, to) dentro del índice de choques
+struct SchedInterval {
+  uint16_t from;
+  uint16_t to;
+  uint16_t maxTo;      // máximo 'to' de este y los anteriores (orden por inicio)
+  uint16_t row;        // índice en loadSchedules()
+};
+
+static const int SCHED_DAYS = SCHEDULE_WEEK_DAYS;
+static const int SLOT_MINUTES = 120;
+static std::shared_ptr<const ScheduleWeek> g_week;   // publicado (std::atomic_load/atomic_store)
+static std::vector<SchedInterval> g_ivals[SCHED_DAYS];
+static uint32_t g_compiledGen = 0;
+
+// último tramo encontrado (día, índice); se invalida al recompilar
+static int g_lastDay = -1;
+static size_t g_lastIdx = 0;
+
+// "H:MM" / " 7 : 05 " -> minutos del día; -1 si no es válido.
+int scheduleTableMinutes(const String &t) {
+  const char *p = t.c_str();
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p < '0' || *p > '9') return -1;
+  int h = 0;
+  while (*p >= '0' && *p <= '9') h = h * 10 + (*p++ - '0');
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p++ != ':') return -1;
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p < '0' || *p > '9') return -1;
+  int m = 0;
+  while (*p >= '0' && *p <= '9') m = m * 10 + (*p++ - '0');
+  if (h > 23 || m > 59) return -1;
+  return h * 60 + m;
+}
+
+int scheduleTableDayIndex(const String &day) {
+  String d = day; d.trim();
+  for (int i = 0; i < SCHED_DAYS; ++i) if (d == DAYS[i]) return i;
+  return -1;
+}
+
+static void compile() {
+  struct Raw { int from, to; CatalogId id; };
+  std::vector<Raw> raw[SCHED_DAYS];
+  for (int d = 0; d < SCHED_DAYS; ++d) g_ivals[d].clear();
+  const auto &schedules = loadSchedules();
+  for (size_t i = 0; i < schedules.size(); ++i) {
+    const ScheduleEntry &s = schedules[i];
+    int d = scheduleTableDayIndex(s.day);
+    if (d < 0) continue;
+    int a = scheduleTableMinutes(s.start), b = scheduleTableMinutes(s.end);
+    if (a < 0 || b < 0 || b < a) continue;
+    raw[d].push_back(Raw{a, b, (CatalogId)s.materiaId});
+    if (b > a) g_ivals[d].push_back(SchedInterval{(uint16_t)a, (uint16_t)b, 0, (uint16_t)i});
+  }
+  for (int d = 0; d < SCHED_DAYS; ++d) {
+    std::vector<SchedInterval> &iv = g_ivals[d];
+    std::stable_sort(iv.begin(), iv.end(), [](const SchedInterval &x, const SchedInterval &y) { return x.from < y.from; });
+    uint16_t mx = 0;
+    for (auto &x : iv) { if (x.to > mx) mx = x.to; x.maxTo = mx; }
+  }
+  ScheduleWeek *week = new ScheduleWeek();
+  for (int d = 0; d < SCHED_DAYS; ++d) {
+    std::vector<SchedSpan> &out = week->days[d];
+    // fronteras de todos los horarios del día; cada tramo elemental toma el
+    // primer horario (orden del archivo) que lo cubre
+    std::vector<int> cuts;
+    for (auto &r : raw[d]) { cuts.push_back(r.from); cuts.push_back(r.to + 1); }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+    for (size_t i = 0; i + 1 < cuts.size(); ++i) {
+      int a = cuts[i], b = cuts[i + 1] - 1;
+      const Raw *owner = nullptr;
+      for (auto &r : raw[d]) if (r.from <= a && b <= r.to) { owner = &r; break; }
+      if (!owner || !owner->id) continue;
+      if (!out.empty() && out.back().materiaId == owner->id && out.back().to + 1 == a) out.back().to = (uint16_t)b;
+      else out.push_back(SchedSpan{(uint16_t)a, (uint16_t)b, owner->id});
+    }
+  }
+  std::atomic_store(&g_week, std::shared_ptr<const ScheduleWeek>(week));
+  g_compiledGen = schedulesGeneration();
+  g_lastDay = -1;
+}
+
+static void ensureCompiled() {
+  if (!g_week || g_compiledGen != schedulesGeneration()) compile();
+}
+
+void scheduleTableBegin() {
+  compile();
+  Serial.printf("scheduleTable: %u tramos\n", (unsigned)scheduleTableSpans());
+}
+
+void scheduleTableLoop() { ensureCompiled(); }
+
+// Tramo de 'minute' en los tramos de un día; -1 si no hay clase.
+static long spanAt(const std::vector<SchedSpan> &v, int minute) {
+  auto it = std::upper_bound(v.begin(), v.end(), minute,
+                             [](int m, const SchedSpan &s) { return m < s.from; });
+  if (it == v.begin()) return -1;
+  --it;
+  if (minute > it->to) return -1;
+  return (long)(it - v.begin());
+}
+
+CatalogId ScheduleWeek::owner(int dayIndex, int minute) const {
+  if (dayIndex < 0 || dayIndex >= SCHED_DAYS) return 0;
+  long i = spanAt(days[dayIndex], minute);
+  return i < 0 ? 0 : days[dayIndex][i].materiaId;
+}
+
+std::shared_ptr<const ScheduleWeek> scheduleTableWeek() {
+  return std::atomic_load(&g_week);
+}
+
+CatalogId scheduleTableOwner(int dayIndex, int minute) {
+  ensureCompiled();
+  if (dayIndex < 0 || dayIndex >= SCHED_DAYS) return 0;
+  const std::vector<SchedSpan> &v = g_week->days[dayIndex];
+  if (g_lastDay == dayIndex && g_lastIdx < v.size()) {
+    const SchedSpan &s = v[g_lastIdx];
+    if (s.from <= minute && minute <= s.to) return s.materiaId;
+  }
+  long i = spanAt(v, minute);
+  if (i < 0) return 0;
+  g_lastDay = dayIndex;
+  g_lastIdx = (size_t)i;
+  return v[i].materiaId;
+}
+
+const ScheduleEntry *scheduleTableOverlap(int dayIndex, int from, int to, const String &owner) {
+  ensureCompiled();
+  if (dayIndex < 0 || dayIndex >= SCHED_DAYS || to <= from) return nullptr;
+  const std::vector<SchedInterval> &iv = g_ivals[dayIndex];
+  const auto &schedules = loadSchedules();
+  // candidatos: inicio < to; hacia atrás mientras el fin máximo acumulado pase de 'from'
+  size_t k = (size_t)(std::lower_bound(iv.begin(), iv.end(), to,
+                                       [](const SchedInterval &x, int t) { return x.from < t; }) - iv.begin());
+  const SchedInterval *best = nullptr;
+  for (size_t i = k; i-- > 0 && iv[i].maxTo > from; ) {
+    if (iv[i].to <= from) continue;
+    if (owner.length() && schedules[iv[i].row].materia != owner) continue;
+    best = &iv[i];
+  }
+  return best ? &schedules[best->row] : nullptr;
+}
+
+const ScheduleEntry *scheduleTableOverlap(const String &day, const String &start, const String &end) {
+  return scheduleTableOverlap(scheduleTableDayIndex(day), scheduleTableMinutes(start), scheduleTableMinutes(end));
+}
+
+const ScheduleEntry *scheduleTableStartingAt(const String &day, const String &start) {
+  ensureCompiled();
+  int d = scheduleTableDayIndex(day);
+  int a = scheduleTableMinutes(start);
+  if (d < 0 || a < 0) return nullptr;
+  const std::vector<SchedInterval> &iv = g_ivals[d];
+  auto it = std::lower_bound(iv.begin(), iv.end(), a, [](const SchedInterval &x, int t) { return x.from < t; });
+  if (it == iv.end() || it->from != a) return nullptr;
+  return &loadSchedules()[it->row];
+}
+
+std::vector<const ScheduleEntry *> scheduleTableGrid() {
+  ensureCompiled();
+  std::vector<const ScheduleEntry *> cells((size_t)SCHED_DAYS * SLOT_COUNT, nullptr);
+  const auto &schedules = loadSchedules();
+  for (int d = 0; d < SCHED_DAYS; ++d) {
+    const std::vector<SchedInterval> &iv = g_ivals[d];
+    size_t j = 0;
+    for (int s = 0; s < SLOT_COUNT; ++s) {
+      int a = SLOT_STARTS[s] * 60, b = a + SLOT_MINUTES;
+      while (j < iv.size() && iv[j].maxTo <= a) j++;    // todo lo anterior terminó antes del slot
+      for (size_t i = j; i < iv.size() && iv[i].from < b; ++i)
+        if (iv[i].to > a) { cells[(size_t)d * SLOT_COUNT + s] = &schedules[iv[i].row]; break; }
+    }
+  }
+  return cells;
+}
+
+size_t scheduleTableSpans() {
+  std::shared_ptr<const ScheduleWeek> w = scheduleTableWeek();
+  size_t n = 0;
+  if (w) for (int d = 0; d < SCHED_DAYS; ++d) n += w->days[d].size();
+  return n;
+}
@@ -1,88 +1,66 @@
 // src/time_utils.cpp
 #include "time_utils.h"
 #include "globals.h"
+#include "catalog.h"
+#include "schedule_table.h"
+#include "uid_key.h"
 #include <time.h>
 #include <sys/time.h>
 
 // Fallback offset si NTP no está disponible
 static const long LOCAL_TZ_OFFSET_SEC = -6L * 3600L;
 
-String nowISO() {
-  time_t epoch = time(nullptr);
+static void localTm(time_t epoch, struct tm &out) {
   time_t local_epoch = epoch + LOCAL_TZ_OFFSET_SEC;
-  struct tm tm_local;
 #if defined(_MSC_VER)
-  gmtime_s(&tm_local, &local_epoch);
+  gmtime_s(&out, &local_epoch);
 #else
-  gmtime_r(&local_epoch, &tm_local);
+  gmtime_r(&local_epoch, &out);
 #endif
+}
+
+String isoFromEpoch(time_t epoch) {
+  struct tm tm_local;
+  localTm(epoch, tm_local);
   char buf[32];
   strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm_local);
   return String(buf);
 }
 
-String uidBytesToString(byte *uid, byte len) {
-  String s;
-  s.reserve(len * 2);
-  for (byte i = 0; i < len; ++i) {
-    char tmp[3];
-    snprintf(tmp, sizeof(tmp), "%02X", uid[i]);
-    s += tmp;
-  }
-  s.toUpperCase();
-  return s;
+String nowISO() {
+  return isoFromEpoch(time(nullptr));
 }
 
-static bool parseHHMMPermissive(const String &t, int &outH, int &outM) {
-  String s = t; s.trim();
-  int colon = s.indexOf(':');
-  if (colon < 0) return false;
-  String hs = s.substring(0, colon);
-  String ms = s.substring(colon + 1);
-  hs.trim(); ms.trim();
-  if (hs.length() == 0 || ms.length() == 0) return false;
-  int h = hs.toInt();
-  int m = ms.toInt();
-  if (h < 0 || h > 23) return false;
-  if (m < 0 || m > 59) return false;
-  outH = h; outM = m; return true;
+// Posterior al 1-ene-2020: el reloj ya no es el epoch por defecto del arranque.
+bool timeIsSynced() {
+  return time(nullptr) > 1577836800;
 }
 
-String currentScheduledMateria() {
-  time_t epoch = time(nullptr);
-  time_t local_epoch = epoch + LOCAL_TZ_OFFSET_SEC;
+int localDayMinute(time_t epoch, int &minute) {
   struct tm tm_now;
-#if defined(_MSC_VER)
-  gmtime_s(&tm_now, &local_epoch);
-#else
-  gmtime_r(&local_epoch, &tm_now);
-#endif
-
+  localTm(epoch, tm_now);
+  minute = tm_now.tm_hour * 60 + tm_now.tm_min;
   int wday = tm_now.tm_wday;
-  int dayIndex = -1;
-  if (wday >= 1 && wday <= 6) dayIndex = wday - 1;
-  if (dayIndex < 0) return String();
+  return (wday >= 1 && wday <= 6) ? wday - 1 : -1;
+}
 
-  int nowMin = tm_now.tm_hour * 60 + tm_now.tm_min;
-  auto schedules = loadSchedules();
+// Texto hex en mayúsculas (formato de las filas CSV); ver uid_key.h.
+String uidBytesToString(byte *uid, byte len) {
+  return UidKey::fromBytes(uid, len).toString();
+}
 
-  for (auto &s : schedules) {
-    String schedDay = s.day; schedDay.trim();
-    if (schedDay != DAYS[dayIndex]) continue;
-    int sh, sm, eh, em;
-    if (!parseHHMMPermissive(s.start, sh, sm)) continue;
-    if (!parseHHMMPermissive(s.end, eh, em)) continue;
-    int smin = sh * 60 + sm;
-    int emin = eh * 60 + em;
-    if (smin <= nowMin && nowMin <= emin) {
-      String schedMat = s.materia;
-      int sep = schedMat.indexOf("||");
-      if (sep >= 0) schedMat = schedMat.substring(0, sep);
-      schedMat.trim();
-      return schedMat;
-    }
-  }
-  return String();
+// ID (catalog.h) de la materia con clase en este momento; 0 si no hay.
+uint16_t currentScheduledMateriaId() {
+  int minute = 0;
+  int dayIndex = localDayMinute(time(nullptr), minute);
+  if (dayIndex < 0) return 0;
+
+  // tabla semanal compilada (schedule_table.h): sin leer ni partir SCHEDULES_FILE
+  return scheduleTableOwner(dayIndex, minute);
+}
+
+String currentScheduledMateria() {
+  return catalogMateriaName(currentScheduledMateriaId());
 }
 
 void setTimeFromEpoch(uint32_t epoch_seconds) {
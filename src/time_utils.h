@@ -1,10 +1,15 @@
 // src/time_utils.h
 #pragma once
 #include <Arduino.h>
+#include <time.h>
 
 String nowISO();
+String isoFromEpoch(time_t epoch);                 // "YYYY-MM-DD HH:MM:SS" local
+bool timeIsSynced();                               // hora real (NTP o /debug_set_time)
+int localDayMinute(time_t epoch, int &minute);     // índice en DAYS[] (-1 domingo) y minuto del día
 String uidBytesToString(byte *uid, byte len);
 String currentScheduledMateria();
+uint16_t currentScheduledMateriaId();
 void setTimeFromEpoch(uint32_t epoch_seconds);
 uint32_t getEpochNow();
 void printLocalTimeToSerial();
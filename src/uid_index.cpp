@@ -0,0 +1,223 @@
+// src/uid_index.cpp
+#include "uid_index.h"
+#include "config.h"
+#include "globals.h"
+#include "csv_reader.h"
+#include "uid_key.h"
+#include <SPIFFS.h>
+#include <algorithm>
+#include <string.h>
+
+// Bit alto del offset: 1 = fila de TEACHERS_FILE, 0 = USERS_FILE
+static const uint32_t TEACHER_BIT = 0x80000000UL;
+static const size_t MIN_SLOTS = 256;
+
+struct UidSlot {
+  uint32_t hash;   // 0 = ranura libre
+  uint32_t off;    // offset de la fila (+ TEACHER_BIT)
+};
+
+// Tabla hash con sondeo lineal; misma estructura para UID y para cuenta.
+struct SlotTable {
+  std::vector<UidSlot> slots;
+  size_t used = 0;
+};
+
+static SlotTable g_uids;       // uidKeyHash(uid) -> fila
+static SlotTable g_accounts;   // hash(account)   -> fila
+
+// FNV-1a de 32 bits; el 0 se reserva para ranura libre.
+static uint32_t hashBytes(const char *p, size_t n) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= (uint8_t)p[i];
+    h *= 16777619UL;
+  }
+  return h ? h : 1;
+}
+
+// Clave de 64 bits del UID (uid_key.h) plegada a 32; mismo valor desde el texto
+// de la fila o desde los bytes leídos de la tarjeta.
+static uint32_t foldUid(uint64_t k) {
+  uint32_t h = (uint32_t)(k ^ (k >> 32));
+  return h ? h : 1;
+}
+
+static uint32_t hashUid(const char *p, size_t n) { return foldUid(uidKeyHash(p, n)); }
+
+static void insertSlot(SlotTable &t, uint32_t h, uint32_t off);
+
+static void rehash(SlotTable &t, size_t newCap) {
+  std::vector<UidSlot> old;
+  old.swap(t.slots);
+  t.slots.assign(newCap, UidSlot{0, 0});
+  t.used = 0;
+  for (auto &s : old) if (s.hash) insertSlot(t, s.hash, s.off);
+}
+
+static void insertSlot(SlotTable &t, uint32_t h, uint32_t off) {
+  if (t.slots.empty()) t.slots.assign(MIN_SLOTS, UidSlot{0, 0});
+  if ((t.used + 1) * 10 > t.slots.size() * 7) rehash(t, t.slots.size() * 2);
+  size_t mask = t.slots.size() - 1;
+  size_t i = h & mask;
+  while (t.slots[i].hash) i = (i + 1) & mask;
+  t.slots[i].hash = h;
+  t.slots[i].off = off;
+  t.used++;
+}
+
+// Quita de la tabla las ranuras de un archivo (antes de reescribirlo).
+static void resetTable(SlotTable &t, bool teacher) {
+  std::vector<UidSlot> keep;
+  keep.reserve(t.used);
+  for (auto &s : t.slots) {
+    if (s.hash && (((s.off & TEACHER_BIT) != 0) != teacher)) keep.push_back(s);
+  }
+  size_t cap = MIN_SLOTS;
+  while (keep.size() * 10 > cap * 7) cap *= 2;
+  std::vector<UidSlot>(cap, UidSlot{0, 0}).swap(t.slots); // libera la capacidad sobrante
+  t.used = 0;
+  for (auto &s : keep) insertSlot(t, s.hash, s.off);
+}
+
+// Recorre las ranuras del hash h y devuelve los offsets de un archivo.
+static std::vector<uint32_t> offsetsFor(const SlotTable &t, uint32_t h, bool teacher) {
+  std::vector<uint32_t> out;
+  if (t.slots.empty()) return out;
+  size_t mask = t.slots.size() - 1;
+  size_t i = h & mask;
+  while (t.slots[i].hash) {
+    const UidSlot &s = t.slots[i];
+    if (s.hash == h && (((s.off & TEACHER_BIT) != 0) == teacher)) out.push_back(s.off & ~TEACHER_BIT);
+    i = (i + 1) & mask;
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+// Lee las filas en los offsets dados y se queda con las que realmente tienen 'key'
+// en la columna 'col' (USERS_UID: misma clave de UID; USERS_ACCOUNT: mismo texto).
+// rows == nullptr: sólo comprobar existencia (sin copiar filas).
+// Una fila borrada (row_log) la salta el lector: se descarta al no coincidir el offset.
+static size_t readRows(const SlotTable &t, int col, const char *path, const String &key, bool teacher,
+                       std::vector<String> *rows, std::vector<uint32_t> *rowOffs = nullptr) {
+  if (key.length() == 0) return 0;
+  bool byUid = (col == USERS_UID);
+  uint64_t uidKey = byUid ? uidKeyHash(key) : 0;
+  auto offs = offsetsFor(t, byUid ? foldUid(uidKey) : hashBytes(key.c_str(), key.length()), teacher);
+  if (offs.empty()) return 0;
+  File f = SPIFFS.open(path, FILE_READ);
+  if (!f) return 0;
+  size_t found = 0;
+  for (uint32_t off : offs) {
+    if (!f.seek(off)) continue;
+    CsvReader r(f, false);
+    if (!r.next() || r.offset() != off) continue;
+    if (byUid ? uidKeyHash(r[col].ptr, r[col].len) != uidKey : !r[col].equals(key)) continue;
+    found++;
+    if (!rows) break;
+    rows->push_back(r.lineString());
+    if (rowOffs) rowOffs->push_back(off);
+  }
+  f.close();
+  return found;
+}
+
+static void insertRow(bool teacher, uint32_t offset, const CsvField &uid, const CsvField &account) {
+  if (uid.empty() || uid.equals("uid")) return; // cabecera
+  uint32_t off = offset | (teacher ? TEACHER_BIT : 0);
+  insertSlot(g_uids, hashUid(uid.ptr, uid.len), off);
+  if (!account.empty()) insertSlot(g_accounts, hashBytes(account.ptr, account.len), off);
+}
+
+static void indexFile(const char *path) {
+  File f = SPIFFS.open(path, FILE_READ);
+  if (!f) return;
+  bool teacher = (strcmp(path, TEACHERS_FILE) == 0);
+  CsvReader r(f, false);                        // la cabecera la descarta insertRow
+  while (r.next()) insertRow(teacher, r.offset(), r[USERS_UID], r[USERS_ACCOUNT]);
+  f.close();
+}
+
+bool uidIndexTracksFile(const char *path) {
+  return path && (strcmp(path, USERS_FILE) == 0 || strcmp(path, TEACHERS_FILE) == 0);
+}
+
+void uidIndexBuild() {
+  unsigned long t0 = millis();
+  std::vector<UidSlot>().swap(g_uids.slots);
+  std::vector<UidSlot>().swap(g_accounts.slots);
+  g_uids.used = 0;
+  g_accounts.used = 0;
+  indexFile(USERS_FILE);
+  indexFile(TEACHERS_FILE);
+  Serial.printf("uidIndexBuild: %u filas, %u bytes, %lums\n",
+                (unsigned)g_uids.used, (unsigned)uidIndexRamBytes(), millis() - t0);
+}
+
+// Tras compactar un archivo (row_log) sus filas cambian de offset.
+void uidIndexRebuildFile(const char *path) {
+  if (!uidIndexTracksFile(path)) return;
+  uidIndexResetFile(path);
+  indexFile(path);
+}
+
+void uidIndexResetFile(const char *path) {
+  if (!uidIndexTracksFile(path)) return;
+  bool teacher = (strcmp(path, TEACHERS_FILE) == 0);
+  resetTable(g_uids, teacher);
+  resetTable(g_accounts, teacher);
+}
+
+void uidIndexNoteRow(const char *path, uint32_t offset, const String &line) {
+  if (!uidIndexTracksFile(path)) return;
+  CsvFields c;
+  if (c.split(line) == 0) return;
+  insertRow(strcmp(path, TEACHERS_FILE) == 0, offset, c[USERS_UID], c[USERS_ACCOUNT]);
+}
+
+bool uidIndexHasUser(const String &uid) {
+  return readRows(g_uids, USERS_UID, USERS_FILE, uid, false, nullptr) > 0;
+}
+
+bool uidIndexHasTeacher(const String &uid) {
+  return readRows(g_uids, USERS_UID, TEACHERS_FILE, uid, true, nullptr) > 0;
+}
+
+std::vector<String> uidIndexUserRows(const String &uid, std::vector<uint32_t> *offsets) {
+  std::vector<String> rows;
+  readRows(g_uids, USERS_UID, USERS_FILE, uid, false, &rows, offsets);
+  return rows;
+}
+
+std::vector<String> uidIndexTeacherRows(const String &uid, std::vector<uint32_t> *offsets) {
+  std::vector<String> rows;
+  readRows(g_uids, USERS_UID, TEACHERS_FILE, uid, true, &rows, offsets);
+  return rows;
+}
+
+bool uidIndexFindAccount(const String &account, String &uidOut, bool &teacherOut) {
+  std::vector<String> rows;
+  // primero usuarios y después maestros (mismo orden que el recorrido anterior)
+  teacherOut = false;
+  if (readRows(g_accounts, USERS_ACCOUNT, USERS_FILE, account, false, &rows) == 0) {
+    if (readRows(g_accounts, USERS_ACCOUNT, TEACHERS_FILE, account, true, &rows) == 0) return false;
+    teacherOut = true;
+  }
+  CsvFields c;
+  c.split(rows[0]);   // offsets ordenados: la primera fila del archivo
+  uidOut = c.str(USERS_UID);
+  return true;
+}
+
+std::vector<String> uidIndexAccountUserRows(const String &account) {
+  std::vector<String> rows;
+  readRows(g_accounts, USERS_ACCOUNT, USERS_FILE, account, false, &rows);
+  return rows;
+}
+
+size_t uidIndexRowCount() { return g_uids.used; }
+
+size_t uidIndexRamBytes() {
+  return (g_uids.slots.capacity() + g_accounts.slots.capacity()) * sizeof(UidSlot);
+}
@@ -0,0 +1,78 @@
+// src/uid_key.cpp
+#include "uid_key.h"
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// FNV-1a de 64 bits.
+static uint64_t fnv64(const uint8_t *p, size_t n) {
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+UidKey UidKey::fromBytes(const uint8_t *p, uint8_t n) {
+  UidKey k{};
+  k.len = n < MAX_LEN ? n : (uint8_t)MAX_LEN;
+  memcpy(k.bytes, p, k.len);
+  return k;
+}
+
+bool UidKey::parse(const char *p, size_t n, UidKey &out) {
+  // los espacios alrededor vienen de CSV editados a mano
+  while (n && (*p == ' ' || *p == '\t')) { ++p; --n; }
+  while (n && (p[n - 1] == ' ' || p[n - 1] == '\t' || p[n - 1] == '\r')) --n;
+  if (n == 0 || (n & 1) || n / 2 > MAX_LEN) return false;
+  UidKey k{};
+  k.len = (uint8_t)(n / 2);
+  for (uint8_t i = 0; i < k.len; ++i) {
+    int hi = hexValue(p[2 * i]), lo = hexValue(p[2 * i + 1]);
+    if (hi < 0 || lo < 0) return false;
+    k.bytes[i] = (uint8_t)((hi << 4) | lo);
+  }
+  out = k;
+  return true;
+}
+
+// Hasta 7 bytes: la longitud en el byte alto y los bytes debajo (exacta).
+// 8 a 10 bytes: FNV-1a de los bytes.
+uint64_t UidKey::hash() const {
+  if (len <= 7) {
+    uint64_t h = (uint64_t)len << 56;
+    for (uint8_t i = 0; i < len; ++i) h |= (uint64_t)bytes[i] << (8 * (6 - i));
+    return h;
+  }
+  return fnv64(bytes, len);
+}
+
+size_t UidKey::format(char *out, size_t cap) const {
+  if (cap == 0) return 0;
+  size_t n = 0;
+  for (uint8_t i = 0; i < len && n + 2 < cap; ++i) {
+    out[n++] = HEX_DIGITS[bytes[i] >> 4];
+    out[n++] = HEX_DIGITS[bytes[i] & 0x0F];
+  }
+  out[n] = '\0';
+  return n;
+}
+
+String UidKey::toString() const {
+  char buf[TEXT_LEN];
+  format(buf, sizeof(buf));
+  return String(buf);
+}
+
+uint64_t uidKeyHash(const char *p, size_t n) {
+  UidKey k{};
+  if (UidKey::parse(p, n, k)) return k.hash();
+  return fnv64((const uint8_t *)p, n);
+}
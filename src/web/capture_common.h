@@ -8,6 +8,7 @@
 
 #include "globals.h"
 #include "files_utils.h"
+#include "csv_reader.h"
 #include "self_register.h"
 
 #ifndef CAPTURE_QUEUE_FILE
@@ -27,10 +28,8 @@ static inline std::vector<String> readCaptureQueue() {
   if (!SPIFFS.exists(CAPTURE_QUEUE_FILE)) return out;
   File f = SPIFFS.open(CAPTURE_QUEUE_FILE, FILE_READ);
   if (!f) return out;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (l.length()) out.push_back(l);
-  }
+  CsvReader r(f, false);  // un UID por línea, sin cabecera
+  while (r.next()) out.push_back(r.lineString());
   f.close();
   return out;
 }
@@ -9,6 +9,8 @@
 #include "globals.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "uid_index.h"
+#include "csv_reader.h"
 #include "display.h"
 #include "edit.h"   // <-- delegado para /capture_edit
 
@@ -43,7 +45,7 @@ static String escapeHTML(const String &s) {
 // Infer professor if materia has exactly 1 professor
 static String inferProfessorForMateria(const String &materia) {
   if (materia.length() == 0) return String();
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   String found = "";
   int count = 0;
   for (auto &c : courses) {
@@ -61,7 +63,7 @@ static String inferProfessorForMateria(const String &materia) {
 static std::vector<String> getProfessorsForMateriaLocal(const String &materia) {
   std::vector<String> out;
   if (materia.length() == 0) return out;
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     if (c.materia == materia) {
       bool ok = true;
@@ -74,55 +76,18 @@ static std::vector<String> getProfessorsForMateriaLocal(const String &materia) {
 
 // Comprueba existencia exacta uid+materia en USERS_FILE
 static bool userExistsUidMateriaExact(const String &uid, const String &materia) {
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (l.length() == 0) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 4) {
-      String uidc = c[0];
-      String matc = c[3];
-      if (uidc == uid && matc == materia) { f.close(); return true; }
-    }
-  }
-  f.close();
-  return false;
+  return existsUserUidMateria(uid, materia);
 }
 
 // Busca por cuenta; devuelve pair(uid,source) o ("","") si no existe.
 // source = "users" o "teachers"
 static std::pair<String,String> findByAccount(const String &account) {
   if (account.length() == 0) return std::make_pair(String(""), String(""));
-  // buscar users
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (f) {
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim(); if (l.length()==0) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 3) {
-        String uid = c[0];
-        String acc = c[2];
-        if (acc == account) { f.close(); return std::make_pair(uid, String("users")); }
-      }
-    }
-    f.close();
-  }
-  // buscar teachers
-  File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (ft) {
-    while (ft.available()) {
-      String l = ft.readStringUntil('\n'); l.trim(); if (l.length()==0) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 3) {
-        String uid = c[0];
-        String acc = c[2];
-        if (acc == account) { ft.close(); return std::make_pair(uid, String("teachers")); }
-      }
-    }
-    ft.close();
-  }
-  return std::make_pair(String(""), String(""));
+  // índice por cuenta (uid_index.h): usuarios primero, luego maestros
+  String uid;
+  bool teacher = false;
+  if (!uidIndexFindAccount(account, uid, teacher)) return std::make_pair(String(""), String(""));
+  return std::make_pair(uid, String(teacher ? "teachers" : "users"));
 }
 
 // reusa findAnyUserByUID de files_utils (devuelve línea completa o "")
@@ -132,50 +97,26 @@ static String findAnyUserLineByUID(const String &uid) {
 
 // Comprueba si uid existe en USERS_FILE
 static bool uidExistsInUsers(const String &uid) {
-  if (uid.length() == 0) return false;
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 1 && c[0] == uid) { f.close(); return true; }
-  }
-  f.close();
-  return false;
+  return uidIndexHasUser(uid);
 }
 
 // Comprueba si uid existe en TEACHERS_FILE
 static bool uidExistsInTeachers(const String &uid) {
-  if (uid.length() == 0) return false;
-  File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 1 && c[0] == uid) { f.close(); return true; }
-  }
-  f.close();
-  return false;
+  return uidIndexHasTeacher(uid);
 }
 
 // Devuelve el nombre del usuario para uid+materia si existe, si no el primer nombre encontrado para uid, si no vacio
 static String getUserNameForUidMateria(const String &uid, const String &materia) {
   String name = "";
-  if (uid.length() == 0) return name;
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return name;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 1 && c[0] == uid) {
-      if (c.size() > 1 && c[1].length()) {
-        // prefer exact materia match if provided
-        if (materia.length() > 0 && c.size() > 3 && c[3] == materia) { name = c[1]; break; }
-        if (name.length() == 0) name = c[1]; // keep first found as fallback
-      }
+  CsvFields c;
+  for (auto &l : uidIndexUserRows(uid)) {
+    c.split(l);
+    if (c.size() > 1 && !c[USERS_NAME].empty()) {
+      // prefer exact materia match if provided
+      if (materia.length() > 0 && c.size() > 3 && c[USERS_MATERIA].equals(materia)) { name = c.str(USERS_NAME); break; }
+      if (name.length() == 0) name = c.str(USERS_NAME); // keep first found as fallback
     }
   }
-  f.close();
   return name;
 }
 
@@ -211,7 +152,7 @@ void capture_individual_page() {
   // preparar lista materias si es students
   std::vector<String> materias;
   if (target == "students") {
-    auto courses = loadCourses();
+    const auto &courses = loadCourses();
     for (auto &c : courses) {
       bool ok = true;
       for (auto &m : materias) if (m == c.materia) { ok = false; break; }
@@ -556,9 +497,10 @@ void capture_individual_poll() {
   // Try to get stored name/account (from either file)
   String storedLine = findAnyUserLineByUID(uidSnapshot);
   if (storedLine.length() > 0) {
-    auto parts = parseQuotedCSVLine(storedLine);
-    if (parts.size() > 1) nameOut = parts[1];
-    if (parts.size() > 2) accountOut = parts[2];
+    CsvFields parts;
+    parts.split(storedLine);
+    if (parts.size() > 1) nameOut = parts.str(USERS_NAME);
+    if (parts.size() > 2) accountOut = parts.str(USERS_ACCOUNT);
     // intentionally do NOT set materia/profesor here to allow re-capture assignment
   }
 
@@ -687,39 +629,15 @@ void capture_individual_confirm() {
     // gather name & materias for foundUID
     String foundName = "";
     std::vector<String> materiasList;
-    if (foundSource == "users") {
-      File fu = SPIFFS.open(USERS_FILE, FILE_READ);
-      if (fu) {
-        while (fu.available()) {
-          String l = fu.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-          auto p = parseQuotedCSVLine(l);
-          if (p.size() >= 1 && p[0] == foundUID) {
-            if (p.size() > 1) foundName = p[1];
-            if (p.size() > 3 && p[3].length()) {
-              bool exists = false;
-              for (auto &m : materiasList) if (m == p[3]) { exists = true; break; }
-              if (!exists) materiasList.push_back(p[3]);
-            }
-          }
-        }
-        fu.close();
-      }
-    } else { // teachers
-      File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-      if (ft) {
-        while (ft.available()) {
-          String l = ft.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-          auto p = parseQuotedCSVLine(l);
-          if (p.size() >= 1 && p[0] == foundUID) {
-            if (p.size() > 1) foundName = p[1];
-            if (p.size() > 3 && p[3].length()) {
-              bool exists = false;
-              for (auto &m : materiasList) if (m == p[3]) { exists = true; break; }
-              if (!exists) materiasList.push_back(p[3]);
-            }
-          }
-        }
-        ft.close();
+    auto foundRows = (foundSource == "users") ? uidIndexUserRows(foundUID) : uidIndexTeacherRows(foundUID);
+    CsvFields p;
+    for (auto &l : foundRows) {
+      p.split(l);
+      if (p.size() > 1) foundName = p.str(USERS_NAME);
+      if (p.size() > 3 && !p[USERS_MATERIA].empty()) {
+        bool exists = false;
+        for (auto &m : materiasList) if (p[USERS_MATERIA].equals(m)) { exists = true; break; }
+        if (!exists) materiasList.push_back(p.str(USERS_MATERIA));
       }
     }
 
@@ -778,22 +696,16 @@ void capture_individual_confirm() {
       // tarjeta ya usada como alumno -> denegar
       String foundName="", foundAccount="";
       std::vector<String> materiasList;
-      File fu = SPIFFS.open(USERS_FILE, FILE_READ);
-      if (fu) {
-        while (fu.available()) {
-          String l = fu.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-          auto p = parseQuotedCSVLine(l);
-          if (p.size() >= 1 && p[0] == uid) {
-            if (p.size() > 1) foundName = p[1];
-            if (p.size() > 2) foundAccount = p[2];
-            if (p.size() > 3 && p[3].length()) {
-              bool exists = false;
-              for (auto &m : materiasList) if (m == p[3]) { exists = true; break; }
-              if (!exists) materiasList.push_back(p[3]);
-            }
-          }
+      CsvFields p;
+      for (auto &l : uidIndexUserRows(uid)) {
+        p.split(l);
+        if (p.size() > 1) foundName = p.str(USERS_NAME);
+        if (p.size() > 2) foundAccount = p.str(USERS_ACCOUNT);
+        if (p.size() > 3 && !p[USERS_MATERIA].empty()) {
+          bool exists = false;
+          for (auto &m : materiasList) if (p[USERS_MATERIA].equals(m)) { exists = true; break; }
+          if (!exists) materiasList.push_back(p.str(USERS_MATERIA));
         }
-        fu.close();
       }
 
       String html = htmlHeader("No permitido - Tarjeta en uso");
@@ -824,17 +736,11 @@ void capture_individual_confirm() {
     if (uidExistsInTeachers(uid)) {
       // tarjeta ya usada como maestro -> denegar
       String foundName="", foundAccount="";
-      File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-      if (ft) {
-        while (ft.available()) {
-          String l = ft.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-          auto p = parseQuotedCSVLine(l);
-          if (p.size() >= 1 && p[0] == uid) {
-            if (p.size() > 1) foundName = p[1];
-            if (p.size() > 2) foundAccount = p[2];
-          }
-        }
-        ft.close();
+      CsvFields p;
+      for (auto &l : uidIndexTeacherRows(uid)) {
+        p.split(l);
+        if (p.size() > 1) foundName = p.str(USERS_NAME);
+        if (p.size() > 2) foundAccount = p.str(USERS_ACCOUNT);
       }
 
       String html = htmlHeader("No permitido - Tarjeta en uso");
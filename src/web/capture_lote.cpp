@@ -4,6 +4,8 @@
 #include "web_common.h"
 #include "globals.h"
 #include "files_utils.h"
+#include "uid_index.h"
+#include "csv_reader.h"
 
 #include <FS.h>
 #include <SPIFFS.h>
@@ -68,54 +70,25 @@ static String computeScheduleBaseMat() {
 // Función para verificar si un alumno ya está registrado en una materia específica
 static bool studentExistsInMateria(const String &uid, const String &materia) {
   if (uid.length() == 0 || materia.length() == 0) return false;
-
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return false;
-
-  while (f.available()) {
-    String l = f.readStringUntil('\n');
-    l.trim();
-    if (l.length() == 0) continue;
-
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 4) {
-      String uidc = c[0];
-      String matc = c[3];
-      if (uidc == uid && matc == materia) {
-        f.close();
-        return true;
-      }
-    }
-  }
-  f.close();
-  return false;
+  return existsUserUidMateria(uid, materia);
 }
 
 // uidExistsInTeachers/uidExistsInUsers (idénticas a capture_individual)
 static bool uidExistsInTeachers(const String &uid) {
-  if (uid.length() == 0) return false;
-  File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 1 && c[0] == uid) { f.close(); return true; }
-  }
-  f.close();
-  return false;
+  return uidIndexHasTeacher(uid);
 }
 
 static bool uidExistsInUsers(const String &uid) {
-  if (uid.length() == 0) return false;
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 1 && c[0] == uid) { f.close(); return true; }
-  }
-  f.close();
-  return false;
+  return uidIndexHasUser(uid);
+}
+
+// Nombre del maestro (columna 1 de su fila en TEACHERS_FILE) o "" si no existe
+static String teacherNameForUID(const String &uid) {
+  String row = findTeacherByUID(uid);
+  if (row.length() == 0) return String();
+  CsvFields c;
+  c.split(row);
+  return c.str(USERS_NAME);
 }
 
 // Helper: elimina UIDs de maestro desde el vector y devuelve lista de maestros eliminados (detalles)
@@ -125,16 +98,7 @@ static std::vector<String> filterOutTeachersFromList(std::vector<String> &list)
     String uid = list[i];
     if (uidExistsInTeachers(uid)) {
       // obtener nombre si está en teachers file
-      String teacherName = "";
-      File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-      if (ft) {
-        while (ft.available()) {
-          String l = ft.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-          auto c = parseQuotedCSVLine(l);
-          if (c.size() >= 2 && c[0] == uid) { teacherName = c[1]; break; }
-        }
-        ft.close();
-      }
+      String teacherName = teacherNameForUID(uid);
       String entry = uid + (teacherName.length() ? String(" - ") + teacherName : "");
       removed.push_back(entry);
       list.erase(list.begin() + i);
@@ -171,7 +135,7 @@ void capture_lote_page() {
   // Prepare server-side options for global select if needed
   String coursesOptionsHtml = "";
   if (scheduleBaseMat.length() == 0) {
-    auto courses = loadCourses();
+    const auto &courses = loadCourses();
     for (size_t i = 0; i < courses.size(); ++i) {
       String label = courses[i].materia;
       if (courses[i].profesor.length()) label += " (" + courses[i].profesor + ")";
@@ -432,19 +396,7 @@ void capture_lote_batchPollGET() {
         appendLineToFile(DENIED_FILE, recDenied);
 
         // Notificación (solo una vez por bloqueo)
-        String teacherName = "";
-        File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-        if (ft) {
-          while (ft.available()) {
-            String l = ft.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-            auto c = parseQuotedCSVLine(l);
-            if (c.size() >= 2 && c[0] == captureUID) {
-              teacherName = c[1];
-              break;
-            }
-          }
-          ft.close();
-        }
+        String teacherName = teacherNameForUID(captureUID);
 
         String notificationMsg = "Tarjeta de maestro BLOQUEADA en captura por lote: " +
                                 (teacherName.length() ? teacherName : "Sin nombre") +
@@ -542,10 +494,11 @@ send_response:
     bool reg = rec.length() > 0;
     String name="", account="", materia="";
     if (reg) {
-      auto c = parseQuotedCSVLine(rec);
-      if (c.size() > 1) name = c[1];
-      if (c.size() > 2) account = c[2];
-      if (c.size() > 3) materia = c[3];
+      CsvFields c;
+      c.split(rec);
+      name = c.str(USERS_NAME);
+      account = c.str(USERS_ACCOUNT);
+      materia = c.str(USERS_MATERIA);
     }
     if (scheduleBaseMat.length() > 0) materia = scheduleBaseMat;
     else materia = String("");
@@ -664,16 +617,7 @@ void capture_lote_generateLinksPOST() {
     String uid = lines[i];
     if (uidExistsInTeachers(uid)) {
       // obtener nombre si está en teachers file
-      String teacherName = "";
-      File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-      if (ft) {
-        while (ft.available()) {
-          String l = ft.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-          auto c = parseQuotedCSVLine(l);
-          if (c.size() >= 2 && c[0] == uid) { teacherName = c[1]; break; }
-        }
-        ft.close();
-      }
+      String teacherName = teacherNameForUID(uid);
       teacherList.push_back(uid + (teacherName.length() ? String(" - ") + teacherName : ""));
       lines.erase(lines.begin() + i);
       // log
@@ -798,17 +742,11 @@ void capture_lote_finishPOST() {
     // VERIFICAR SI EL ALUMNO YA ESTÁ REGISTRADO EN ESTA MATERIA
     if (studentExistsInMateria(uid, chosenMateria)) {
       String studentName = "";
-      File fu = SPIFFS.open(USERS_FILE, FILE_READ);
-      if (fu) {
-        while (fu.available()) {
-          String l = fu.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-          auto c = parseQuotedCSVLine(l);
-          if (c.size() >= 2 && c[0] == uid) {
-            studentName = c[1];
-            break;
-          }
-        }
-        fu.close();
+      String urow = findAnyUserByUID(uid);
+      if (urow.length()) {
+        CsvFields c;
+        c.split(urow);
+        studentName = c.str(USERS_NAME);
       }
       duplicateList.push_back(uid + " - " + (studentName.length() ? studentName : "Sin nombre"));
       continue;
@@ -818,9 +756,10 @@ void capture_lote_finishPOST() {
     String rec = findAnyUserByUID(uid);
 
     if (rec.length() > 0) {
-      auto c = parseQuotedCSVLine(rec);
-      String name = (c.size() > 1 ? c[1] : "");
-      String account = (c.size() > 2 ? c[2] : "");
+      CsvFields c;
+      c.split(rec);
+      String name = c.str(USERS_NAME);
+      String account = c.str(USERS_ACCOUNT);
 
       // Añadir fila en USERS_FILE para esta materia
       String userRow = "\"" + uid + "\"," + "\"" + name + "\"," + "\"" + account + "\"," + "\"" + chosenMateria + "\"," + "\"" + nowISO() + "\"";
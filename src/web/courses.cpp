@@ -2,6 +2,9 @@
 #include "courses.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "csv_reader.h"
+#include "catalog.h"
+#include "schedule_table.h"
 #include "config.h"
 #include "globals.h"
 #include <SPIFFS.h>
@@ -57,35 +60,29 @@ static String jsonEscape(const String &s) {
 
 // ---------- Helper: contar cursos con nombre dado ----------
 static int countCoursesWithName(const String &materia) {
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   int cnt = 0;
   for (auto &c : courses) if (c.materia == materia) cnt++;
   return cnt;
 }
 
 static bool coursePairExists(const String &materia, const String &profesor) {
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     if (c.materia == materia && c.profesor == profesor) return true;
   }
   return false;
 }
 
-static bool slotOccupiedLocal(const String &day, const String &start, String *ownerOut = nullptr) {
-  auto schedules = loadSchedules();
-  for (auto &s : schedules) {
-    if (s.day == day && s.start == start) {
-      if (ownerOut) *ownerOut = s.materia;
-      return true;
-    }
-  }
-  return false;
-}
-
 static bool addScheduleSlotSafeLocalKey(const String &courseKey, const String &day, const String &start, const String &end, String *err = nullptr) {
-  String owner;
-  if (slotOccupiedLocal(day, start, &owner)) {
-    if (owner != courseKey) {
+  if (scheduleTableDayIndex(day) < 0 || scheduleTableMinutes(start) < 0 || scheduleTableMinutes(end) <= scheduleTableMinutes(start)) {
+    if (err) *err = "horario invalido";
+    return false;
+  }
+  // cualquier solape con otro horario del día (schedule_table.h), no sólo el mismo inicio
+  const ScheduleEntry *clash = scheduleTableOverlap(day, start, end);
+  if (clash) {
+    if (clash->materia != courseKey) {
       if (err) *err = "ocupado por otra materia";
       return false;
     }
@@ -99,7 +96,7 @@ static bool addScheduleSlotSafeLocalKey(const String &courseKey, const String &d
 // Devuelve lista única de nombres de materia (sin repetir por profesor)
 static std::vector<String> getUniqueMateriaNamesLocal() {
   std::vector<String> out;
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     bool found = false;
     for (auto &x : out) if (x == c.materia) { found = true; break; }
@@ -111,7 +108,7 @@ static std::vector<String> getUniqueMateriaNamesLocal() {
 // Devuelve lista de profesores para una materia (puede haber varios)
 static std::vector<String> getProfessorsForMateriaLocal(const String &materia) {
   std::vector<String> out;
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     if (c.materia == materia) {
       bool found = false;
@@ -133,20 +130,12 @@ static std::vector<String> loadRegisteredTeachersNamesLocal() {
   if (!SPIFFS.exists(TEACHERS_FILE)) return out;
   File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
   if (!f) return out;
-  // saltar header si existe
-  if (f.available()) {
-    String header = f.readStringUntil('\n');
-    (void)header;
-  }
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (l.length() == 0) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 2) {
-      String name = c[1];
+  CsvReader r(f);  // salta la cabecera
+  while (r.next()) {
+    if (r.size() >= 2) {
       bool found = false;
-      for (auto &x : out) if (x == name) { found = true; break; }
-      if (!found) out.push_back(name);
+      for (auto &x : out) if (r[USERS_NAME].equals(x)) { found = true; break; }
+      if (!found) out.push_back(r.str(USERS_NAME));
     }
   }
   f.close();
@@ -163,7 +152,7 @@ std::vector<String> loadRegisteredTeachersNames() {
 void handleMaterias() {
   String html = htmlHeader("Materias");
   html += "<div class='card'><h2>Materias disponibles</h2>";
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   html += "<p class='small'>Pulse 'Agregar nueva materia' para registrar una materia. Desde aquí puede administrar estudiantes o ver el historial por días.</p>";
 
   html += "<div class='filters'><input id='f_mat' placeholder='Filtrar por materia'><input id='f_prof' placeholder='Filtrar por profesor'><button class='search-btn btn btn-blue' onclick='applyMateriaFilters()'>Buscar</button><button class='search-btn btn btn-green' onclick='clearMateriaFilters()'>Limpiar</button></div>";
@@ -171,25 +160,19 @@ void handleMaterias() {
   if (courses.size() == 0) {
     html += "<p>No hay materias registradas.</p>";
   } else {
-    auto schedules = loadSchedules();
+    const auto &schedules = loadSchedules();
     html += "<table id='materias_table'><tr><th>Materia</th><th>Profesor</th><th>Creado</th><th>Horarios</th><th>Acción</th></tr>";
     for (auto &c : courses) {
+      // cursos con la misma materia (por ID): un horario sin profesor sólo se atribuye si es único
+      int sameMateria = 0;
+      for (auto &o : courses) if (o.materiaId == c.materiaId) sameMateria++;
       String schedStr = "";
       for (auto &s : schedules) {
-        String schedOwner = s.materia;
-        String ownerMat, ownerProf;
-        if (splitCourseKey(schedOwner, ownerMat, ownerProf)) {
-          if (ownerMat == c.materia && ownerProf == c.profesor) {
-            if (schedStr.length()) schedStr += "; ";
-            schedStr += s.day + " " + s.start + "-" + s.end;
-          }
-        } else {
-          if (schedOwner == c.materia) {
-            if (countCoursesWithName(c.materia) == 1) {
-              if (schedStr.length()) schedStr += "; ";
-              schedStr += s.day + " " + s.start + "-" + s.end;
-            }
-          }
+        if (s.materiaId != c.materiaId) continue;
+        bool mine = s.profesorId ? (s.profesorId == c.profesorId) : (sameMateria == 1);
+        if (mine) {
+          if (schedStr.length()) schedStr += "; ";
+          schedStr += s.day + " " + s.start + "-" + s.end;
         }
       }
       if (schedStr.length() == 0) schedStr = "-";
@@ -303,7 +286,7 @@ void handleMateriasNewScheduleGET() {
   if (!coursePairExists(mat, prof)) { server.send(404, "text/plain", "Curso no encontrado"); return; }
 
   bool fromNewFlow = (server.hasArg("new") && server.arg("new") == "1");
-  auto schedules = loadSchedules();
+  auto cells = scheduleTableGrid();   // dueños de las 36 celdas en una pasada
   String headerTitle = String("Asignar horarios - ") + mat + " (" + prof + ")";
   String html = htmlHeader(headerTitle.c_str());
   html += "<div class='card'><h2>Horarios para: " + mat + " — " + prof + "</h2>";
@@ -323,10 +306,11 @@ void handleMateriasNewScheduleGET() {
       String day = DAYS[d];
       String start = String(h) + ":00";
       String end = String(h + 2) + ":00";
-      String owner;
-      bool occ = slotOccupiedLocal(day, start, &owner);
+      const ScheduleEntry *cell = cells[(size_t)d * SLOT_COUNT + s];
       html += "<td style='min-width:150px'>";
-      if (occ) {
+      if (cell) {
+        String owner = cell->materia;
+        start = cell->start;   // un horario que empieza dentro del slot se borra por su propio inicio
         String ownerMat, ownerProf;
         if (splitCourseKey(owner, ownerMat, ownerProf)) {
           if (owner == courseKey) {
@@ -423,17 +407,12 @@ void handleMateriasNewScheduleDelPOST() {
   File f = SPIFFS.open(SCHEDULES_FILE, FILE_READ);
   std::vector<String> slines;
   if (f) {
-    String header = f.readStringUntil('\n');
-    slines.push_back(header);
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String owner = c[0];
-        String dayc = c[1];
-        String startc = c[2];
-        if (dayc == day && startc == start) {
+    CsvReader r(f);
+    slines.push_back(r.lineString());  // cabecera
+    while (r.next()) {
+      if (r.size() >= 4) {
+        String owner = r.str(SCHED_MATERIA);
+        if (r[SCHED_DAY].equals(day) && r[SCHED_START].equals(start)) {
           String ownerMat, ownerProf;
           if (splitCourseKey(owner, ownerMat, ownerProf)) {
             if (owner == courseKey) continue;
@@ -442,7 +421,7 @@ void handleMateriasNewScheduleDelPOST() {
           }
         }
       }
-      slines.push_back(l);
+      slines.push_back(r.lineString());
     }
     f.close();
     writeAllLines(SCHEDULES_FILE, slines);
@@ -456,7 +435,7 @@ void handleMateriasEditGET() {
   if (!server.hasArg("materia") || !server.hasArg("profesor")) { server.send(400, "text/plain", "materia y profesor requeridos"); return; }
   String mat = server.arg("materia"); mat.trim();
   String prof = server.arg("profesor"); prof.trim();
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   int idx = -1;
   for (int i = 0; i < (int)courses.size(); i++) {
     if (courses[i].materia == mat && courses[i].profesor == prof) { idx = i; break; }
@@ -554,16 +533,14 @@ void handleMateriasEditPOST() {
   File f = SPIFFS.open(SCHEDULES_FILE, FILE_READ);
   std::vector<String> slines;
   if (f) {
-    String header = f.readStringUntil('\n'); slines.push_back(header);
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String owner = c[0];
-        String day = c[1];
-        String start = c[2];
-        String rest = c[3];
+    CsvReader r(f);
+    slines.push_back(r.lineString());  // cabecera
+    while (r.next()) {
+      if (r.size() >= 4) {
+        String owner = r.str(SCHED_MATERIA);
+        String day = r.str(SCHED_DAY);
+        String start = r.str(SCHED_START);
+        String rest = r.str(SCHED_END);
         if (owner == oldKey) {
           String newline = "\"" + newKey + "\"," + "\"" + day + "\"," + "\"" + start + "\"," + "\"" + rest + "\"";
           slines.push_back(newline);
@@ -577,7 +554,7 @@ void handleMateriasEditPOST() {
           }
         }
       }
-      slines.push_back(l);
+      slines.push_back(r.lineString());
     }
     f.close();
     writeAllLines(SCHEDULES_FILE, slines);
@@ -586,22 +563,19 @@ void handleMateriasEditPOST() {
   File fu = SPIFFS.open(USERS_FILE, FILE_READ);
   std::vector<String> ulines;
   if (fu) {
-    String uheader = fu.readStringUntil('\n');
-    ulines.push_back(uheader);
-    while (fu.available()) {
-      String l = fu.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String uid = c[0], name = c[1], acc = c[2], mm = c[3];
-        String created = (c.size() > 4 ? c[4] : "");
+    CsvReader r(fu);
+    ulines.push_back(r.lineString());  // cabecera
+    while (r.next()) {
+      if (r.size() >= 4) {
+        String uid = r.str(USERS_UID), name = r.str(USERS_NAME), acc = r.str(USERS_ACCOUNT), mm = r.str(USERS_MATERIA);
+        String created = r.str(USERS_CREATED);
         if (mm == oldMat && countCoursesWithName(oldMat) == 1) mm = mat;
         String umat, uprof;
         if (splitCourseKey(mm, umat, uprof)) {
           if (mm == oldKey) mm = newKey;
         }
         ulines.push_back("\"" + uid + "\"," + "\"" + name + "\"," + "\"" + acc + "\"," + "\"" + mm + "\"," + "\"" + created + "\"");
-      } else ulines.push_back(l);
+      } else ulines.push_back(r.lineString());
     }
     fu.close();
     writeAllLines(USERS_FILE, ulines);
@@ -617,7 +591,7 @@ void handleMateriasDeletePOST() {
   String prof = server.arg("profesor"); prof.trim();
   if (mat.length() == 0 || prof.length() == 0) { server.send(400, "text/plain", "materia/profesor vacio"); return; }
 
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   std::vector<Course> newCourses;
   for (auto &c : courses) {
     if (!(c.materia == mat && c.profesor == prof)) newCourses.push_back(c);
@@ -629,19 +603,16 @@ void handleMateriasDeletePOST() {
   File f = SPIFFS.open(SCHEDULES_FILE, FILE_READ);
   std::vector<String> slines;
   if (f) {
-    String header = f.readStringUntil('\n'); slines.push_back(header);
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String owner = c[0];
-        if (owner == targetKey) continue;
-        if (owner == mat) {
+    CsvReader r(f);
+    slines.push_back(r.lineString());  // cabecera
+    while (r.next()) {
+      if (r.size() >= 4) {
+        if (r[SCHED_MATERIA].equals(targetKey)) continue;
+        if (r[SCHED_MATERIA].equals(mat)) {
           if (countCoursesWithName(mat) == 0) continue;
         }
       }
-      slines.push_back(l);
+      slines.push_back(r.lineString());
     }
     f.close();
     writeAllLines(SCHEDULES_FILE, slines);
@@ -650,17 +621,14 @@ void handleMateriasDeletePOST() {
   File fu = SPIFFS.open(USERS_FILE, FILE_READ);
   std::vector<String> ulines;
   if (fu) {
-    String uheader = fu.readStringUntil('\n'); ulines.push_back(uheader);
-    while (fu.available()) {
-      String l = fu.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String uid = c[0], name = c[1], acc = c[2], mm = c[3];
-        if (mm == makeCourseKey(mat, prof)) continue;
-        if (mm == mat && countCoursesWithName(mat) == 0) continue;
-        ulines.push_back(l);
-      } else ulines.push_back(l);
+    CsvReader r(fu);
+    ulines.push_back(r.lineString());  // cabecera
+    while (r.next()) {
+      if (r.size() >= 4) {
+        if (r[USERS_MATERIA].equals(targetKey)) continue;
+        if (r[USERS_MATERIA].equals(mat) && countCoursesWithName(mat) == 0) continue;
+      }
+      ulines.push_back(r.lineString());
     }
     fu.close();
     writeAllLines(USERS_FILE, ulines);
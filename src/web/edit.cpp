@@ -4,10 +4,14 @@
 #include <SPIFFS.h>
 #include <ctype.h>
 #include <vector>
+#include <algorithm>
 
 #include "globals.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "uid_index.h"
+#include "csv_reader.h"
+#include "row_log.h"
 #include "edit.h"
 #include "courses.h"    // loadCourses(), writeCourses()
 #include "schedules.h"  // SCHEDULES_FILE (si lo usas) - opcional, solo para consistencia
@@ -28,51 +32,16 @@ static String sanitizeReturnToLocal(const String &rt) {
   return String("/students_all");
 }
 
-static bool uidExistsInFile(const char* filename, const String &uid) {
-  if (!uid.length()) return false;
-  if (!SPIFFS.exists(filename)) return false;
-  File f = SPIFFS.open(filename, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 1 && c[0] == uid) { f.close(); return true; }
-  }
-  f.close();
-  return false;
-}
-static bool uidExistsInUsers(const String &uid) { return uidExistsInFile(USERS_FILE, uid); }
-static bool uidExistsInTeachers(const String &uid) { return uidExistsInFile(TEACHERS_FILE, uid); }
+static bool uidExistsInUsers(const String &uid) { return uidIndexHasUser(uid); }
+static bool uidExistsInTeachers(const String &uid) { return uidIndexHasTeacher(uid); }
 
 static std::pair<String,String> findByAccountLocal(const String &account) {
   if (account.length() == 0) return std::make_pair(String(""), String(""));
-
-  File fu = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (fu) {
-    while (fu.available()) {
-      String l = fu.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-      auto p = parseQuotedCSVLine(l);
-      if (p.size() >= 3) {
-        if (p[2] == account) { fu.close(); return std::make_pair(p[0], String("users")); }
-      }
-    }
-    fu.close();
-  }
-
-  File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (ft) {
-    while (ft.available()) {
-      String l = ft.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-      auto p = parseQuotedCSVLine(l);
-      if (p.size() >= 3) {
-        if (p[2] == account) { ft.close(); return std::make_pair(p[0], String("teachers")); }
-      }
-    }
-    ft.close();
-  }
-
-  return std::make_pair(String(""), String(""));
+  // índice por cuenta (uid_index.h): usuarios primero, luego maestros
+  String uid;
+  bool teacher = false;
+  if (!uidIndexFindAccount(account, uid, teacher)) return std::make_pair(String(""), String(""));
+  return std::make_pair(uid, String(teacher ? "teachers" : "users"));
 }
 
 // ---------------- render / lógica compartida ----------------
@@ -86,55 +55,37 @@ static void renderEditPage(const String &uid, const String &return_to_in, const
   String source = "users";
   std::vector<String> foundMaterias; // para alumnos: todas las materias asociadas
 
-  // leer USERS_FILE (acumular todas las filas que tengan uid)
-  File fu = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (fu) {
-    String header = fu.readStringUntil('\n'); (void)header;
-    while (fu.available()) {
-      String l = fu.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 1 && c[0] == uid) {
-        if (!found) {
-          foundName = (c.size() > 1 ? c[1] : "");
-          foundAccount = (c.size() > 2 ? c[2] : "");
-          foundCreated = (c.size() > 4 ? c[4] : nowISO());
-          found = true;
-          source = "users";
-        }
-        String mat = (c.size() > 3 ? c[3] : "");
-        foundMaterias.push_back(mat);
-      }
+  // filas de USERS_FILE con este uid (índice en RAM)
+  CsvFields c;
+  for (auto &l : uidIndexUserRows(uid)) {
+    c.split(l);
+    if (!found) {
+      foundName = c.str(USERS_NAME);
+      foundAccount = c.str(USERS_ACCOUNT);
+      foundCreated = (c.size() > 4 ? c.str(USERS_CREATED) : nowISO());
+      found = true;
+      source = "users";
     }
-    fu.close();
+    foundMaterias.push_back(c.str(USERS_MATERIA));
   }
 
   // si no encontrado en users, buscar en teachers (única fila esperada)
   if (!found) {
-    File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-    if (ft) {
-      String header = ft.readStringUntil('\n'); (void)header;
-      while (ft.available()) {
-        String l = ft.readStringUntil('\n'); l.trim();
-        if (!l.length()) continue;
-        auto c = parseQuotedCSVLine(l);
-        if (c.size() >= 1 && c[0] == uid) {
-          foundName = (c.size() > 1 ? c[1] : "");
-          foundAccount = (c.size() > 2 ? c[2] : "");
-          foundCreated = (c.size() > 4 ? c[4] : nowISO());
-          found = true;
-          source = "teachers";
-          break;
-        }
-      }
-      ft.close();
+    String trow = findTeacherByUID(uid);
+    if (trow.length()) {
+      c.split(trow);
+      foundName = c.str(USERS_NAME);
+      foundAccount = c.str(USERS_ACCOUNT);
+      foundCreated = (c.size() > 4 ? c.str(USERS_CREATED) : nowISO());
+      found = true;
+      source = "teachers";
     }
   }
 
   if (!found) { server.send(404, "text/plain", "Usuario no encontrado"); return; }
 
   // cargar materias disponibles
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   std::vector<String> materias;
   for (auto &c : courses) {
     bool ok = true;
@@ -594,52 +545,36 @@ static void processEditPostAndRedirect(const String &redirect_to) {
       return;
     }
 
-    // leer USERS_FILE y construir nuevo contenido
-    File f = SPIFFS.open(USERS_FILE, FILE_READ);
-    std::vector<String> lines;
-    String header = "";
-    if (f) {
-      header = f.readStringUntil('\n');
-      lines.push_back(header);
-      while (f.available()) {
-        String l = f.readStringUntil('\n'); l.trim();
-        if (!l.length()) continue;
-        auto c = parseQuotedCSVLine(l);
-        if (c.size() >= 1 && c[0] == uid) {
-          // omitimos las filas antiguas de este uid
-          continue;
-        }
-        lines.push_back(l);
-      }
-      f.close();
-    } else {
-      header = "\"uid\",\"name\",\"account\",\"materia\",\"created\"";
-      lines.push_back(header);
-    }
+    // filas actuales del uid (vía índice) y su offset en USERS_FILE
+    std::vector<uint32_t> offs;
+    std::vector<String> rows = uidIndexUserRows(uid, &offs);
 
     // intentar conservar created timestamp si existía
     String created = nowISO();
-    File fu2 = SPIFFS.open(USERS_FILE, FILE_READ);
-    if (fu2) {
-      String h = fu2.readStringUntil('\n'); (void)h;
-      while (fu2.available()) {
-        String l = fu2.readStringUntil('\n'); l.trim();
-        if (!l.length()) continue;
-        auto c = parseQuotedCSVLine(l);
-        if (c.size() >= 1 && c[0] == uid) {
-          if (c.size() > 4 && c[4].length()) { created = c[4]; break; }
-        }
-      }
-      fu2.close();
+    CsvFields c;
+    for (auto &l : rows) {
+      if (c.split(l) > 4 && !c[USERS_CREATED].empty()) { created = c.str(USERS_CREATED); break; }
     }
 
-    // agregar filas por materia
+    // sin reescribir USERS_FILE: una fila nueva por materia y después lápida
+    // sobre las antiguas. Si falla un append (flash llena) el alumno conserva
+    // sus filas anteriores y se quitan las nuevas que sí se escribieron.
+    bool appended = true;
     for (auto &mp : materias) {
       String newline = "\"" + uid + "\",\"" + name + "\",\"" + account + "\",\"" + mp.first + "\",\"" + created + "\"";
-      lines.push_back(newline);
+      if (!appendLineToFile(USERS_FILE, newline)) { appended = false; break; }
+    }
+    if (!appended) {
+      std::vector<uint32_t> nowOffs;
+      std::vector<String> nowRows = uidIndexUserRows(uid, &nowOffs);
+      for (size_t i = 0; i < nowRows.size(); ++i)
+        if (std::find(offs.begin(), offs.end(), nowOffs[i]) == offs.end()) rowLogDelete(USERS_FILE, nowOffs[i], nowRows[i]);
+      server.send(500, "text/plain", "Error guardando usuarios");
+      return;
+    }
+    for (size_t i = 0; i < rows.size(); ++i) {
+      if (!rowLogDelete(USERS_FILE, offs[i], rows[i])) { server.send(500, "text/plain", "Error guardando usuarios"); return; }
     }
-
-    if (!writeAllLines(USERS_FILE, lines)) { server.send(500, "text/plain", "Error guardando usuarios"); return; }
 
     server.sendHeader("Location", return_to);
     server.send(303, "text/plain", "Updated");
@@ -648,30 +583,20 @@ static void processEditPostAndRedirect(const String &redirect_to) {
 
   // flujo teachers (única fila)
   if (source == "teachers") {
-    const char* targetFile = TEACHERS_FILE;
-    File f = SPIFFS.open(targetFile, FILE_READ);
-    if (!f) { server.send(500, "text/plain", "no file"); return; }
-    std::vector<String> lines;
-    String header = f.readStringUntil('\n'); lines.push_back(header);
-    bool updated = false;
+    // fila(s) del uid vía índice; la edición es lápida + fila nueva (row_log)
+    std::vector<uint32_t> offs;
+    std::vector<String> rows = uidIndexTeacherRows(uid, &offs);
+    if (rows.empty()) { server.send(404, "text/plain", "Usuario no encontrado"); return; }
     String oldName = "";
 
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 1 && c[0] == uid) {
-        if (c.size() > 1) oldName = c[1];
-        String created = (c.size() > 4 ? c[4] : nowISO());
-        String newline = "\"" + uid + "\",\"" + name + "\",\"" + account + "\",\"\",\"" + created + "\"";
-        lines.push_back(newline);
-        updated = true;
-      } else lines.push_back(l);
+    CsvFields r;
+    for (size_t i = 0; i < rows.size(); ++i) {
+      r.split(rows[i]);
+      if (r.size() > 1) oldName = r.str(USERS_NAME);
+      String created = (r.size() > 4 ? r.str(USERS_CREATED) : nowISO());
+      String newline = "\"" + uid + "\",\"" + name + "\",\"" + account + "\",\"\",\"" + created + "\"";
+      if (!rowLogUpdate(TEACHERS_FILE, offs[i], rows[i], newline)) { server.send(500, "text/plain", "Error guardando"); return; }
     }
-    f.close();
-
-    if (!updated) { server.send(404, "text/plain", "Usuario no encontrado"); return; }
-    if (!writeAllLines(targetFile, lines)) { server.send(500, "text/plain", "Error guardando"); return; }
 
     // Propagar renombre si es necesario
     if (oldName.length() && oldName != name) {
@@ -687,29 +612,27 @@ static void processEditPostAndRedirect(const String &redirect_to) {
       File fs = SPIFFS.open(SCHEDULES_FILE, FILE_READ);
       if (fs) {
         std::vector<String> slines;
-        String sheader = fs.readStringUntil('\n'); slines.push_back(sheader);
-        while (fs.available()) {
-          String l = fs.readStringUntil('\n'); l.trim();
-          if (!l.length()) continue;
-          auto p = parseQuotedCSVLine(l);
+        CsvReader p(fs);
+        slines.push_back(p.lineString());  // cabecera
+        while (p.next()) {
           if (p.size() >= 4) {
-            String owner = p[0];
+            String owner = p.str(SCHED_MATERIA);
             int idx = owner.indexOf("||");
             if (idx >= 0) {
               String ownerMat = owner.substring(0, idx);
               String ownerProf = owner.substring(idx + 2);
               if (ownerProf == oldName) {
                 String newOwner = ownerMat + String("||") + name;
-                String day = p[1];
-                String start = p[2];
-                String rest = p[3];
+                String day = p.str(SCHED_DAY);
+                String start = p.str(SCHED_START);
+                String rest = p.str(SCHED_END);
                 String newline = "\"" + newOwner + "\"," + "\"" + day + "\"," + "\"" + start + "\"," + "\"" + rest + "\"";
                 slines.push_back(newline);
                 continue;
               }
             }
           }
-          slines.push_back(l);
+          slines.push_back(p.lineString());
         }
         fs.close();
         writeAllLines(SCHEDULES_FILE, slines);
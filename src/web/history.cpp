@@ -2,6 +2,12 @@
 #include "history.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "log_writer.h"
+#include "att_store.h"
+#include "att_rollup.h"
+#include "att_index.h"
+#include "catalog.h"
+#include "csv_reader.h"
 #include "config.h"
 #include "globals.h"
 #include <SPIFFS.h>
@@ -74,55 +80,38 @@ void handleHistoryPage() {
   html += "<a class='btn btn-green' href='" + csvLink + "'>📥 Descargar (filtrado)</a> ";
   html += "<form style='display:inline' method='POST' action='/history_clear' onsubmit='return confirm(\"Borrar todo el historial? Esta acción es irreversible.\")'>"
           "<input class='btn btn-red' type='submit' value='🗑️ Borrar Historial'></form> ";
+  html += "<form style='display:inline' method='POST' action='/history_clear' onsubmit='return confirm(\"Borrar los días anteriores a la fecha indicada?\")'>"
+          "<input type='date' name='before' required> <input class='btn btn-red' type='submit' value='🗑️ Borrar anteriores'></form> ";
+  html += "<form style='display:inline' method='POST' action='/history_rollup_rebuild' onsubmit='return confirm(\"Recalcular totales e índices leyendo todo el historial?\")'>"
+          "<input class='btn btn-orange' type='submit' value='🔄 Recalcular totales e índices'></form> ";
   html += "<a class='btn btn-blue' href='/'>Inicio</a></p>";
 
-  // Abrir archivo de attendance
-  if (!SPIFFS.exists(ATT_FILE)) {
+  // Segmentos diarios que cubren el filtro de fecha (antes vaciar registros encolados)
+  logWriterSync();
+  if (attSegments().empty()) {
     html += "<p>No hay historial.</p>";
     html += htmlFooter();
     server.send(200,"text/html",html);
     return;
   }
-
-  File f = SPIFFS.open(ATT_FILE, FILE_READ);
-  if (!f) {
-    html += "<p>No se pudo abrir archivo de historial.</p>";
-    html += htmlFooter();
-    server.send(200,"text/html",html);
-    return;
-  }
+  if (uidFilter.length())
+    html += "<p class='small'>Registros totales de " + htmlEscape(uidFilter) + ": <b>" + String(attRollupUidTotal(uidFilter)) + "</b></p>";
 
   // Tabla con registros
-  String header = f.readStringUntil('\n');
   html += "<table id='history_table'><tr><th>Timestamp</th><th>Nombre</th><th>Cuenta</th><th>Materia</th><th>Modo</th></tr>";
 
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    String ts   = (c.size()>0?c[0]:"");
-    String uid  = (c.size()>1?c[1]:"");
-    String name = (c.size()>2?c[2]:"");
-    String acc  = (c.size()>3?c[3]:"");
-    String mat  = (c.size()>4?c[4]:"");
-    String mode = (c.size()>5?c[5]:"");
-
-    // Aplicar filtros del servidor (si vienen por query string)
-    if (uidFilter.length()) {
-      String utrim = uid; utrim.trim();
-      if (utrim != uidFilter) continue;
-    }
-    if (materiaFilter.length()) {
-      String matTrim = mat; matTrim.trim();
-      String mfTrim = materiaFilter; mfTrim.trim();
-      if (matTrim != mfTrim) continue;
-    }
-    if (dateFilter.length()) {
-      if (ts.indexOf(dateFilter) != 0) continue;
-    }
+  String mfTrim = materiaFilter; mfTrim.trim();
+  String profFilterLc = profFilter; profFilterLc.toLowerCase(); profFilterLc.trim();
+  auto emitRow = [&](CsvReader &r) {
+    // Aplicar filtros del servidor (si vienen por query string) sobre los campos sin copiarlos
+    if (uidFilter.length() && !r[ATT_UID].trimmed().equals(uidFilter)) return;
+    if (materiaFilter.length() && !r[ATT_MATERIA].trimmed().equals(mfTrim)) return;
+    if (dateFilter.length() && !r[ATT_TS].startsWith(dateFilter)) return;
+    if (nameFilter.length() && !r[ATT_NAME].containsIgnoreCase(nameFilter)) return;
+    String mat = r.str(ATT_MATERIA);
     if (profFilter.length()) {
       bool okProf=false;
-      auto courses = loadCourses();
-      String profFilterLc = profFilter; profFilterLc.toLowerCase(); profFilterLc.trim();
+      const auto &courses = loadCourses();
       for (auto &co : courses) {
         String cm = co.materia; cm.trim();
         if (cm == mat) {
@@ -130,17 +119,23 @@ void handleHistoryPage() {
           if (profLc.indexOf(profFilterLc) != -1) { okProf=true; break; }
         }
       }
-      if (!okProf) continue;
-    }
-    if (nameFilter.length()) {
-      String nameLc = name; nameLc.toLowerCase();
-      String nf = nameFilter; nf.toLowerCase();
-      if (nameLc.indexOf(nf) == -1) continue;
+      if (!okProf) return;
     }
 
-    html += "<tr><td>" + ts + "</td><td>" + name + "</td><td>" + acc + "</td><td>" + mat + "</td><td>" + mode + "</td></tr>";
+    html += "<tr><td>" + r.str(ATT_TS) + "</td><td>" + r.str(ATT_NAME) + "</td><td>" + r.str(ATT_ACCOUNT) + "</td><td>" + mat + "</td><td>" + r.str(ATT_MODE) + "</td></tr>";
+  };
+  // con uid= o materia= se leen sólo las filas de esa clave (att_index.h)
+  if (uidFilter.length()) attIndexForUid(uidFilter, dateFilter, emitRow);
+  else if (mfTrim.length()) attIndexForMateria(mfTrim, dateFilter, emitRow);
+  else {
+    for (auto &path : attSegmentPathsFor(dateFilter)) {
+      File f = SPIFFS.open(path, FILE_READ);
+      if (!f) continue;
+      CsvReader r(f);
+      while (r.next()) emitRow(r);
+      f.close();
+    }
   }
-  f.close();
   html += "</table>";
 
   // Scripts cliente para filtrar la tabla sin recargar (incluye filtro por profesor usando courses)
@@ -188,39 +183,44 @@ void handleHistoryCSV() {
   String tsFilter      = server.hasArg("ts") ? server.arg("ts") : String();
   String uidFilter     = server.hasArg("uid") ? server.arg("uid") : String();
 
-  if (!SPIFFS.exists(ATT_FILE)) { server.send(404,"text/plain","no history"); return; }
-  File f = SPIFFS.open(ATT_FILE, FILE_READ);
+  logWriterSync();
+  if (attSegments().empty()) { server.send(404,"text/plain","no history"); return; }
   String out = "\"timestamp\",\"uid\",\"name\",\"account\",\"materia\",\"mode\"\r\n";
-  String header = f.readStringUntil('\n');
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    String ts = (c.size()>0?c[0]:"");
-    String uid = (c.size()>1?c[1]:"");
-    String mat = (c.size()>4?c[4]:"");
-
-    if (uidFilter.length()) {
-      String utrim = uid; utrim.trim();
-      if (utrim != uidFilter) continue;
-    }
-    if (materiaFilter.length()) {
-      String matTrim = mat; matTrim.trim();
-      String mfTrim = materiaFilter; mfTrim.trim();
-      if (matTrim != mfTrim) continue;
-    }
-    if (tsFilter.length()) {
-      if (ts.indexOf(tsFilter) != 0) continue;
+  String mfTrim = materiaFilter; mfTrim.trim();
+  auto emitRow = [&](CsvReader &r) {
+    if (uidFilter.length() && !r[ATT_UID].trimmed().equals(uidFilter)) return;
+    if (materiaFilter.length() && !r[ATT_MATERIA].trimmed().equals(mfTrim)) return;
+    if (tsFilter.length() && !r[ATT_TS].startsWith(tsFilter)) return;
+    out += r.lineString();
+    out += "\r\n";
+  };
+  if (uidFilter.length()) attIndexForUid(uidFilter, tsFilter, emitRow);
+  else if (mfTrim.length()) attIndexForMateria(mfTrim, tsFilter, emitRow);
+  else {
+    for (auto &path : attSegmentPathsFor(tsFilter)) {
+      File f = SPIFFS.open(path, FILE_READ);
+      if (!f) continue;
+      CsvReader r(f);
+      while (r.next()) emitRow(r);
+      f.close();
     }
-    out += l + "\r\n";
   }
-  f.close();
   server.sendHeader("Content-Disposition","attachment; filename=history.csv");
   server.send(200,"text/csv",out);
 }
 
-// /history_clear (POST) - Borra (resetea) el archivo de attendance dejando solo la cabecera.
+// /history_clear (POST) - Borra todo el historial, o sólo los días anteriores a
+// 'before' (YYYY-MM-DD) eliminando sus segmentos diarios.
 void handleHistoryClearPOST() {
-  writeAllLines(ATT_FILE, std::vector<String>{String("\"timestamp\",\"uid\",\"name\",\"account\",\"materia\",\"mode\"")});
+  String before = server.hasArg("before") ? server.arg("before") : String();
+  before.trim();
+  logWriterSync();
+  if (before.length()) {
+    if (before.length() != 10) { server.send(400,"text/plain","before debe ser YYYY-MM-DD"); return; }
+    attStoreDropBefore(before);
+  } else {
+    attStoreClear();
+  }
   server.sendHeader("Location","/history");
   server.send(303,"text/plain","Historial borrado");
 }
@@ -231,26 +231,11 @@ void handleMateriaHistoryGET() {
   String materia = server.arg("materia");
   materia.trim();
   if (!courseExists(materia)) { server.send(404,"text/plain","Materia no encontrada"); return; }
-  std::vector<String> dates;
-  if (!SPIFFS.exists(ATT_FILE)) { server.send(404,"text/plain","no history"); return; }
-  File f = SPIFFS.open(ATT_FILE, FILE_READ);
-  if (f) {
-    String header = f.readStringUntil('\n');
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size()>4 && c[4]==materia) {
-        String ts = c[0];
-        if (ts.length() >= 10) {
-          String day = ts.substring(0,10); // YYYY-MM-DD
-          bool found=false;
-          for (auto &d : dates) if (d==day) { found=true; break; }
-          if (!found) dates.push_back(day);
-        }
-      }
-    }
-    f.close();
-  }
+  logWriterSync();
+  if (attSegments().empty()) { server.send(404,"text/plain","no history"); return; }
+  // días con registros y alumnos distintos: del resumen incremental (att_rollup.h)
+  CatalogId mid = catalogFindMateria(materia);
+  auto dates = mid ? attRollupForMateria(mid) : std::vector<AttDayCount>();
   String html = htmlHeader(("Historial por días - " + materia).c_str());
   html += "<div class='card'><h2>Historial por días - " + materia + "</h2>";
   html += "<p class='small'>Seleccione un día para descargar la lista de asistencia de esa materia.</p>";
@@ -258,7 +243,8 @@ void handleMateriaHistoryGET() {
   else {
     html += "<ul>";
     for (auto &d : dates) {
-      html += "<li>" + d + " <a class='btn btn-blue' href='/history.csv?materia=" + urlEncodeLocal(materia) + "&ts=" + urlEncodeLocal(d) + "'>⬇️ Descargar CSV</a></li>";
+      html += "<li>" + d.day + " — " + String(d.records) + " registros, " + String(d.students) + " alumnos"
+              " <a class='btn btn-blue' href='/history.csv?materia=" + urlEncodeLocal(materia) + "&ts=" + urlEncodeLocal(d.day) + "'>⬇️ Descargar CSV</a></li>";
     }
     html += "</ul>";
   }
@@ -266,3 +252,13 @@ void handleMateriaHistoryGET() {
   html += htmlFooter();
   server.send(200,"text/html",html);
 }
+
+// /history_rollup_rebuild (POST) - Recalcula los totales (att_rollup.h) y los
+// índices por UID/materia (att_index.h) leyendo todos los segmentos.
+void handleHistoryRollupRebuildPOST() {
+  logWriterSync();
+  attRollupRebuild();
+  attIndexRebuild();
+  server.sendHeader("Location","/history");
+  server.send(303,"text/plain","Totales recalculados");
+}
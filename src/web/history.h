@@ -5,3 +5,4 @@ void handleHistoryPage();
 void handleHistoryCSV();
 void handleHistoryClearPOST();
 void handleMateriaHistoryGET();
+void handleHistoryRollupRebuildPOST();
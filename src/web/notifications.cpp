@@ -2,66 +2,15 @@
 #include "notifications.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "log_writer.h"
+#include "csv_reader.h"
+#include "row_log.h"
+#include "notif_store.h"
 #include "config.h"
 #include "globals.h"
 #include <SPIFFS.h>
 #include <algorithm>
 
-// Ruta interna para marcar leídos (archivo simple con claves)
-static const char *NOTIF_READ_FILE_LOCAL = "/.notif_read";
-
-// Construye clave única para una notificación (ts + uid + principio de nota)
-static String notifKey(const String &ts, const String &uid, const String &note) {
-  String k = ts + "|" + uid;
-  String frag = note;
-  if (frag.length() > 80) frag = frag.substring(0, 80);
-  frag.replace("\n", " ");
-  frag.replace("\r", " ");
-  k += "|" + frag;
-  return k;
-}
-
-// Marca / unmarca helpers
-static void markNotifReadLocal(const String &key) {
-  if (!SPIFFS.exists(NOTIF_READ_FILE_LOCAL)) {
-    File f = SPIFFS.open(NOTIF_READ_FILE_LOCAL, FILE_WRITE);
-    if (!f) return;
-    f.close();
-  }
-  File f = SPIFFS.open(NOTIF_READ_FILE_LOCAL, FILE_READ);
-  if (f) {
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim();
-      if (l == key) { f.close(); return; }
-    }
-    f.close();
-  }
-  appendLineToFile(NOTIF_READ_FILE_LOCAL, key);
-}
-static void unmarkNotifReadLocal(const String &key) {
-  if (!SPIFFS.exists(NOTIF_READ_FILE_LOCAL)) return;
-  File f = SPIFFS.open(NOTIF_READ_FILE_LOCAL, FILE_READ);
-  if (!f) return;
-  std::vector<String> lines;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (l.length() && l != key) lines.push_back(l);
-  }
-  f.close();
-  writeAllLines(NOTIF_READ_FILE_LOCAL, lines);
-}
-static bool isNotifReadLocal(const String &key) {
-  if (!SPIFFS.exists(NOTIF_READ_FILE_LOCAL)) return false;
-  File f = SPIFFS.open(NOTIF_READ_FILE_LOCAL, FILE_READ);
-  if (!f) return false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (l == key) { f.close(); return true; }
-  }
-  f.close();
-  return false;
-}
-
 // Escapa texto para HTML
 static String htmlEscapeLocal(const String &s) {
   String r; r.reserve(s.length());
@@ -167,18 +116,12 @@ void handleNotificationsPage() {
     return;
   }
 
-  // separar leídas/no leídas
+  // separar leídas/no leídas (por seq; búsqueda en RAM)
   std::vector<size_t> unreadIdx; std::vector<size_t> readIdx;
-  std::vector<String> parsedLines; parsedLines.reserve(nots.size());
+  CsvFields c;
   for (size_t i=0;i<nots.size();++i) {
-    String ln = nots[i];
-    parsedLines.push_back(ln);
-    auto c = parseQuotedCSVLine(ln);
-    String ts = (c.size()>0?c[0]:"");
-    String uid = (c.size()>1?c[1]:"");
-    String note = (c.size()>4?c[4]:"");
-    String key = notifKey(ts, uid, note);
-    if (isNotifReadLocal(key)) readIdx.push_back(i);
+    c.split(nots[i]);
+    if (notifStoreIsRead((uint32_t)c[NOTIF_SEQ].toInt())) readIdx.push_back(i);
     else unreadIdx.push_back(i);
   }
 
@@ -224,13 +167,12 @@ void handleNotificationsPage() {
   html += "<div id='list_unread_container'><h3 id='hdr_unread'>No leídas (" + String(unreadIdx.size()) + ")</h3><div id='list_unread' class='notif-list'>";
   for (size_t idxPos=0; idxPos<unreadIdx.size(); ++idxPos) {
     size_t i = unreadIdx[idxPos];
-    String ln = parsedLines[i];
-    auto c = parseQuotedCSVLine(ln);
-    String ts = (c.size()>0?c[0]:"");
-    String uid = (c.size()>1?c[1]:"");
-    String name = (c.size()>2?c[2]:"");
-    String acc = (c.size()>3?c[3]:"");
-    String note = (c.size()>4?c[4]:"");
+    c.split(nots[i]);
+    String ts = c.str(NOTIF_TS);
+    String uid = c.str(NOTIF_UID);
+    String name = c.str(NOTIF_NAME);
+    String acc = c.str(NOTIF_ACCOUNT);
+    String note = c.str(NOTIF_NOTE);
     String tipo = detectNotificationType(note);
     String materiaFromNote = extractFieldFromNote(note, "Materia,Materia:,materia");
     String profFromNote = extractFieldFromNote(note, "Profesor,Profesor:,Maestro,Maestro:,Teacher,Teacher:");
@@ -244,9 +186,9 @@ void handleNotificationsPage() {
     String accEsc = htmlEscapeLocal(acc);
     String tsEsc = htmlEscapeLocal(ts);
     String uidEsc = htmlEscapeLocal(uid);
-    String key = notifKey(ts, uid, note);
+    String seq = c.str(NOTIF_SEQ);
 
-    String dataAttrs = " data-ts='" + tsEsc + "' data-uid='" + uidEsc + "' data-name='" + nameEsc + "' data-note='" + htmlEscapeLocal(note) + "'";
+    String dataAttrs = " data-seq='" + seq + "' data-ts='" + tsEsc + "' data-uid='" + uidEsc + "' data-name='" + nameEsc + "' data-note='" + htmlEscapeLocal(note) + "'";
     if (materiaFromNote.length()) dataAttrs += " data-materia='" + htmlEscapeLocal(materiaFromNote) + "'";
     if (profFromNote.length()) dataAttrs += " data-prof='" + htmlEscapeLocal(profFromNote) + "'";
     // entire item clickable -> openNotif(i)
@@ -277,7 +219,7 @@ void handleNotificationsPage() {
     html += "<div id='notif_ts_" + String(i) + "' style='display:none'>" + tsEsc + "</div>";
     html += "<div id='notif_name_" + String(i) + "' style='display:none'>" + nameEsc + "</div>";
     html += "<div id='notif_acc_" + String(i) + "' style='display:none'>" + accEsc + "</div>";
-    html += "<div id='notif_key_" + String(i) + "' style='display:none'>" + htmlEscapeLocal(key) + "</div>";
+    html += "<div id='notif_seq_" + String(i) + "' style='display:none'>" + seq + "</div>";
 
     html += "</div>";
   }
@@ -287,13 +229,12 @@ void handleNotificationsPage() {
   html += "<div id='list_read_container' style='display:none;'><h3 id='hdr_read'>Leídas (" + String(readIdx.size()) + ")</h3><div id='list_read' class='notif-list'>";
   for (size_t idxPos=0; idxPos<readIdx.size(); ++idxPos) {
     size_t i = readIdx[idxPos];
-    String ln = parsedLines[i];
-    auto c = parseQuotedCSVLine(ln);
-    String ts = (c.size()>0?c[0]:"");
-    String uid = (c.size()>1?c[1]:"");
-    String name = (c.size()>2?c[2]:"");
-    String acc = (c.size()>3?c[3]:"");
-    String note = (c.size()>4?c[4]:"");
+    c.split(nots[i]);
+    String ts = c.str(NOTIF_TS);
+    String uid = c.str(NOTIF_UID);
+    String name = c.str(NOTIF_NAME);
+    String acc = c.str(NOTIF_ACCOUNT);
+    String note = c.str(NOTIF_NOTE);
     String tipo = detectNotificationType(note);
     String materiaFromNote = extractFieldFromNote(note, "Materia,Materia:,materia");
     String profFromNote = extractFieldFromNote(note, "Profesor,Profesor:,Maestro,Maestro:,Teacher,Teacher:");
@@ -307,9 +248,9 @@ void handleNotificationsPage() {
     String accEsc = htmlEscapeLocal(acc);
     String tsEsc = htmlEscapeLocal(ts);
     String uidEsc = htmlEscapeLocal(uid);
-    String key = notifKey(ts, uid, note);
+    String seq = c.str(NOTIF_SEQ);
 
-    String dataAttrs = " data-ts='" + tsEsc + "' data-uid='" + uidEsc + "' data-name='" + nameEsc + "' data-note='" + htmlEscapeLocal(note) + "'";
+    String dataAttrs = " data-seq='" + seq + "' data-ts='" + tsEsc + "' data-uid='" + uidEsc + "' data-name='" + nameEsc + "' data-note='" + htmlEscapeLocal(note) + "'";
     if (materiaFromNote.length()) dataAttrs += " data-materia='" + htmlEscapeLocal(materiaFromNote) + "'";
     if (profFromNote.length()) dataAttrs += " data-prof='" + htmlEscapeLocal(profFromNote) + "'";
     html += "<div class='notif-item' style='background:" + bg + ";' data-idx='" + String(i) + "'" + dataAttrs + " onclick='openNotif(" + String(i) + ")'>";
@@ -333,7 +274,7 @@ void handleNotificationsPage() {
     html += "<div id='notif_ts_" + String(i) + "' style='display:none'>" + tsEsc + "</div>";
     html += "<div id='notif_name_" + String(i) + "' style='display:none'>" + nameEsc + "</div>";
     html += "<div id='notif_acc_" + String(i) + "' style='display:none'>" + accEsc + "</div>";
-    html += "<div id='notif_key_" + String(i) + "' style='display:none'>" + htmlEscapeLocal(key) + "</div>";
+    html += "<div id='notif_seq_" + String(i) + "' style='display:none'>" + seq + "</div>";
     html += "</div>";
   }
   html += "</div></div>"; // end read container
@@ -429,24 +370,20 @@ void handleNotificationsPage() {
       // marcar directamente sin abrir modal (boton inline) => marca leído
       function markInline(idx){
         try {
-          var noteEl = document.getElementById('notif_note_raw_' + idx);
-          var uidEl  = document.getElementById('notif_uid_' + idx);
-          var tsEl   = document.getElementById('notif_ts_' + idx);
-          if (!noteEl) return;
-          var note = noteEl.textContent || noteEl.innerText || '';
-          var uid  = uidEl ? (uidEl.textContent || uidEl.innerText || '') : '';
-          var ts   = tsEl ? (tsEl.textContent || tsEl.innerText || '') : '';
+          var seqEl = document.getElementById('notif_seq_' + idx);
+          if (!seqEl) return;
+          var seq = seqEl.textContent || seqEl.innerText || '';
           fetch('/notifications_mark', {
             method:'POST',
             headers:{'Content-Type':'application/x-www-form-urlencoded'},
-            body: 'action=mark&ts=' + encodeURIComponent(ts) + '&uid=' + encodeURIComponent(uid) + '&note=' + encodeURIComponent(note)
+            body: 'action=mark&seq=' + encodeURIComponent(seq)
           }).then(function(resp){
             if (resp.ok) {
               try {
                 var nodes = document.querySelectorAll('#list_unread .notif-item');
                 for (var i=0;i<nodes.length;i++){
                   var el = nodes[i];
-                  if ((el.getAttribute('data-ts')||'') === ts && (el.getAttribute('data-uid')||'') === uid && ((el.getAttribute('data-note')||'').indexOf((note||'').slice(0,20))!==-1)) {
+                  if ((el.getAttribute('data-seq')||'') === seq) {
                     var badge = el.querySelector('.badge-new'); if (badge) badge.parentNode.removeChild(badge);
                     el.parentNode.removeChild(el);
                     var rl = document.getElementById('list_read');
@@ -464,24 +401,20 @@ void handleNotificationsPage() {
       // marcar inline desde leídas -> volver a no leída (unmark)
       function toggleInline(idx){
         try {
-          var noteEl = document.getElementById('notif_note_raw_' + idx);
-          var uidEl  = document.getElementById('notif_uid_' + idx);
-          var tsEl   = document.getElementById('notif_ts_' + idx);
-          if (!noteEl) return;
-          var note = noteEl.textContent || noteEl.innerText || '';
-          var uid  = uidEl ? (uidEl.textContent || uidEl.innerText || '') : '';
-          var ts   = tsEl ? (tsEl.textContent || tsEl.innerText || '') : '';
+          var seqEl = document.getElementById('notif_seq_' + idx);
+          if (!seqEl) return;
+          var seq = seqEl.textContent || seqEl.innerText || '';
           fetch('/notifications_mark', {
             method:'POST',
             headers:{'Content-Type':'application/x-www-form-urlencoded'},
-            body: 'action=unmark&ts=' + encodeURIComponent(ts) + '&uid=' + encodeURIComponent(uid) + '&note=' + encodeURIComponent(note)
+            body: 'action=unmark&seq=' + encodeURIComponent(seq)
           }).then(function(resp){
             if (resp.ok) {
               try {
                 var nodes = document.querySelectorAll('#list_read .notif-item');
                 for (var i=0;i<nodes.length;i++){
                   var el = nodes[i];
-                  if ((el.getAttribute('data-ts')||'') === ts && (el.getAttribute('data-uid')||'') === uid && ((el.getAttribute('data-note')||'').indexOf((note||'').slice(0,20))!==-1)) {
+                  if ((el.getAttribute('data-seq')||'') === seq) {
                     // add badge-new
                     var b = document.createElement('div'); b.className='badge-new'; b.textContent='Nuevo';
                     var meta = el.querySelector('.notif-meta');
@@ -511,6 +444,8 @@ void handleNotificationsPage() {
         var note = noteEl.textContent || noteEl.innerText || '';
         var uid  = uidEl ? (uidEl.textContent || uidEl.innerText || '') : '';
         var ts   = tsEl ? (tsEl.textContent || tsEl.innerText || '') : '';
+        var seqEl = document.getElementById('notif_seq_' + idx);
+        var seq  = seqEl ? (seqEl.textContent || seqEl.innerText || '') : '';
         var name = nameEl ? (nameEl.textContent || nameEl.innerText || '') : '';
         var acc  = accEl ? (accEl.textContent || accEl.innerText || '') : '';
 
@@ -592,14 +527,14 @@ void handleNotificationsPage() {
         fetch('/notifications_mark', {
           method:'POST',
           headers:{'Content-Type':'application/x-www-form-urlencoded'},
-          body: 'action=mark&ts=' + encodeURIComponent(ts) + '&uid=' + encodeURIComponent(uid) + '&note=' + encodeURIComponent(note)
+          body: 'action=mark&seq=' + encodeURIComponent(seq)
         }).then(function(resp){
           if (resp.ok) {
             try {
               var nodes = document.querySelectorAll('#list_unread .notif-item');
               for (var i=0;i<nodes.length;i++){
                 var el = nodes[i];
-                if ((el.getAttribute('data-ts')||'') === ts && (el.getAttribute('data-uid')||'') === uid && ((el.getAttribute('data-note')||'').indexOf((note||'').slice(0,20))!==-1)) {
+                if ((el.getAttribute('data-seq')||'') === seq) {
                   var badge = el.querySelector('.badge-new'); if (badge) badge.parentNode.removeChild(badge);
                   el.parentNode.removeChild(el);
                   var rl = document.getElementById('list_read');
@@ -620,13 +555,11 @@ void handleNotificationsPage() {
       // toggle mark from modal (works both ways)
       function toggleMark(){
         if (currentIdx < 0) return;
-        var ts = document.getElementById('notif_ts_' + currentIdx).textContent;
-        var uid = document.getElementById('notif_uid_' + currentIdx).textContent;
-        var note = document.getElementById('notif_note_raw_' + currentIdx).textContent;
+        var seq = document.getElementById('notif_seq_' + currentIdx).textContent;
         fetch('/notifications_mark', {
           method:'POST',
           headers:{'Content-Type':'application/x-www-form-urlencoded'},
-          body: 'action=toggle&ts=' + encodeURIComponent(ts) + '&uid=' + encodeURIComponent(uid) + '&note=' + encodeURIComponent(note)
+          body: 'action=toggle&seq=' + encodeURIComponent(seq)
         }).then(function(r){ return r.json(); }).then(function(j){
           if (j && j.status) {
             try {
@@ -635,7 +568,7 @@ void handleNotificationsPage() {
                 var nodes = document.querySelectorAll('#list_unread .notif-item');
                 for (var i=0;i<nodes.length;i++){
                   var el = nodes[i];
-                  if ((el.getAttribute('data-ts')||'') === ts && (el.getAttribute('data-uid')||'') === uid && ((el.getAttribute('data-note')||'').indexOf((note||'').slice(0,20))!==-1)) {
+                  if ((el.getAttribute('data-seq')||'') === seq) {
                     var badge = el.querySelector('.badge-new'); if (badge) badge.parentNode.removeChild(badge);
                     el.parentNode.removeChild(el);
                     document.getElementById('list_read').insertBefore(el, document.getElementById('list_read').firstChild);
@@ -649,7 +582,7 @@ void handleNotificationsPage() {
                 var nodes = document.querySelectorAll('#list_read .notif-item');
                 for (var i=0;i<nodes.length;i++){
                   var el = nodes[i];
-                  if ((el.getAttribute('data-ts')||'') === ts && (el.getAttribute('data-uid')||'') === uid && ((el.getAttribute('data-note')||'').indexOf((note||'').slice(0,20))!==-1)) {
+                  if ((el.getAttribute('data-seq')||'') === seq) {
                     var badge = document.createElement('div'); badge.className='badge-new'; badge.textContent='Nuevo';
                     var meta = el.querySelector('.notif-meta');
                     if (meta) el.insertBefore(badge, meta);
@@ -670,20 +603,18 @@ void handleNotificationsPage() {
       function deleteNotif(){
         if (currentIdx < 0) return;
         if (!confirm('Eliminar esta notificación?')) return;
-        var ts = document.getElementById('notif_ts_' + currentIdx).textContent;
-        var uid = document.getElementById('notif_uid_' + currentIdx).textContent;
-        var note = document.getElementById('notif_note_raw_' + currentIdx).textContent;
+        var seq = document.getElementById('notif_seq_' + currentIdx).textContent;
         fetch('/notifications_delete', {
           method:'POST',
           headers:{'Content-Type':'application/x-www-form-urlencoded'},
-          body: 'ts=' + encodeURIComponent(ts) + '&uid=' + encodeURIComponent(uid) + '&note=' + encodeURIComponent(note)
+          body: 'seq=' + encodeURIComponent(seq)
         }).then(function(r){ if (r.ok) {
           try {
             var sel = '#list_unread .notif-item, #list_read .notif-item';
             var nodes = document.querySelectorAll(sel);
             for (var i=0;i<nodes.length;i++){
               var el = nodes[i];
-              if ((el.getAttribute('data-ts')||'') === ts && (el.getAttribute('data-uid')||'') === uid && ((el.getAttribute('data-note')||'').indexOf((note||'').slice(0,20))!==-1)) {
+              if ((el.getAttribute('data-seq')||'') === seq) {
                 el.parentNode.removeChild(el); updateCounts(); break;
               }
             }
@@ -712,70 +643,49 @@ void handleNotificationsPage() {
   server.send(200, "text/html", html);
 }
 
-// POST /notifications_clear -> borrar archivo
+// POST /notifications_clear -> borrar archivo (y las leídas)
 void handleNotificationsClearPOST() {
   clearNotifications();
-  if (SPIFFS.exists(NOTIF_READ_FILE_LOCAL)) SPIFFS.remove(NOTIF_READ_FILE_LOCAL);
   server.sendHeader("Location", "/notifications");
   server.send(303, "text/plain", "Notificaciones borradas");
 }
 
-// POST /notifications_delete -> borrar una notificación específica (by ts+uid+note)
+// POST /notifications_delete -> borrar una notificación específica (by seq)
 void handleNotificationsDeletePOST() {
-  if (!server.hasArg("ts") || !server.hasArg("uid") || !server.hasArg("note")) {
+  uint32_t seq = server.hasArg("seq") ? (uint32_t)server.arg("seq").toInt() : 0;
+  if (seq == 0) {
     server.send(400, "text/plain", "faltan parametros");
     return;
   }
-  String ts = server.arg("ts");
-  String uid = server.arg("uid");
-  String note = server.arg("note");
 
   if (!SPIFFS.exists(NOTIF_FILE)) {
     server.send(404, "text/plain", "no notifs");
     return;
   }
 
-  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
-  std::vector<String> lines;
-  if (!f) { server.send(500, "text/plain", "no file"); return; }
-  bool firstLineHandled = false;
-  while (f.available()) {
-    String l = f.readStringUntil('\n');
-    if (!firstLineHandled) { firstLineHandled = true; lines.push_back(l); continue; }
-    l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    String lts = (c.size()>0?c[0]:"");
-    String luid = (c.size()>1?c[1]:"");
-    String lnote = (c.size()>4?c[4]:"");
-    if (lts == ts && luid == uid && lnote == note) continue;
-    lines.push_back(l);
-  }
-  f.close();
-
-  writeAllLines(NOTIF_FILE, lines);
-  String key = notifKey(ts, uid, note);
-  unmarkNotifReadLocal(key);
+  // fila por seq vía notif_store (salto a la marca más cercana, sin recorrer el archivo);
+  // lápida sobre la fila: la compactación la retira del archivo más tarde
+  uint32_t off = 0;
+  String line;
+  if (notifStoreFindRow(seq, off, line) && rowLogDelete(NOTIF_FILE, off, line)) notifStoreRemoved(seq);
   server.send(200, "text/plain", "deleted");
 }
 
-// POST /notifications_mark -> action=mark|unmark|toggle
+// POST /notifications_mark -> action=mark|unmark|toggle, seq=<n>
 void handleNotificationsMarkPOST() {
-  if (!server.hasArg("action") || !server.hasArg("ts") || !server.hasArg("uid") || !server.hasArg("note")) {
+  uint32_t seq = server.hasArg("seq") ? (uint32_t)server.arg("seq").toInt() : 0;
+  if (!server.hasArg("action") || seq == 0) {
     server.send(400, "application/json", "{\"error\":\"missing\"}");
     return;
   }
   String action = server.arg("action");
-  String ts = server.arg("ts");
-  String uid = server.arg("uid");
-  String note = server.arg("note");
-  String key = notifKey(ts, uid, note);
 
   bool nowRead = false;
-  if (action == "mark") { markNotifReadLocal(key); nowRead = true; }
-  else if (action == "unmark") { unmarkNotifReadLocal(key); nowRead = false; }
+  if (action == "mark") { notifStoreMark(seq); nowRead = true; }
+  else if (action == "unmark") { notifStoreUnmark(seq); nowRead = false; }
   else if (action == "toggle") {
-    if (isNotifReadLocal(key)) { unmarkNotifReadLocal(key); nowRead = false; }
-    else { markNotifReadLocal(key); nowRead = true; }
+    if (notifStoreIsRead(seq)) { notifStoreUnmark(seq); nowRead = false; }
+    else { notifStoreMark(seq); nowRead = true; }
   } else {
     server.send(400, "application/json", "{\"error\":\"unknown action\"}");
     return;
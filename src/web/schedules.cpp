@@ -4,8 +4,10 @@
 #include "schedules.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "csv_reader.h"
 #include "config.h"
 #include "globals.h"
+#include "schedule_table.h"
 #include <SPIFFS.h>
 #include <vector>
 
@@ -33,7 +35,7 @@ static String urlEncodeLocal(const String &str) {
 
 static std::vector<String> getUniqueMateriaNamesLocal() {
   std::vector<String> out;
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     bool found = false;
     for (auto &x : out) if (x == c.materia) { found = true; break; }
@@ -44,7 +46,7 @@ static std::vector<String> getUniqueMateriaNamesLocal() {
 
 static std::vector<String> getProfessorsForMateriaLocal(const String &materia) {
   std::vector<String> out;
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     if (c.materia == materia) {
       bool found = false;
@@ -56,7 +58,7 @@ static std::vector<String> getProfessorsForMateriaLocal(const String &materia) {
 }
 
 static bool courseExistsLocal(const String &materia) {
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) if (c.materia == materia) return true;
   return false;
 }
@@ -65,21 +67,16 @@ static int countProfessorsForMateriaLocal(const String &materia) {
   return (int)getProfessorsForMateriaLocal(materia).size();
 }
 
-static bool slotOccupiedSched(const String &day, const String &start, String *ownerOut = nullptr) {
-  auto sched = loadSchedules();
-  for (auto &e : sched) {
-    if (e.day == day && e.start == start) {
-      if (ownerOut) *ownerOut = e.materia;
-      return true;
-    }
-  }
-  return false;
+// Día LUN..SAB y "HH:MM" de inicio < fin (las consultas de choque usan minutos).
+static bool validSlotLocal(const String &day, const String &start, const String &end) {
+  int a = scheduleTableMinutes(start), b = scheduleTableMinutes(end);
+  return scheduleTableDayIndex(day) >= 0 && a >= 0 && b > a;
 }
 
 // ---------- Vistas ----------
 
 void handleSchedulesGrid() {
-  auto schedules = loadSchedules();
+  auto cells = scheduleTableGrid();   // dueños de las 36 celdas en una pasada
   String html = htmlHeader("Horarios - Grilla");
   html += "<div class='card'><h2>Horarios del Laboratorio (LUN - SAB)</h2>";
   html += "<p class='small'>Vista de los horarios registrados. Para editar/agregar/quitar horarios pulsa <b>Editar Horarios</b> arriba.</p>";
@@ -93,21 +90,17 @@ void handleSchedulesGrid() {
     snprintf(lbl, sizeof(lbl), "%02d:00 - %02d:00", h, h + 2);
     html += "<tr><th>" + String(lbl) + "</th>";
     for (int d = 0; d < 6; d++) {
-      String day = DAYS[d];
-      String start = String(h) + ":00";
+      const ScheduleEntry *e = cells[(size_t)d * SLOT_COUNT + s];
       String ownerMat = "";
       String ownerProf = "";
-      for (auto &e : schedules) {
-        if (e.day == day && e.start == start) {
-          int idx = e.materia.indexOf("||");
-          if (idx >= 0) {
-            ownerMat = e.materia.substring(0, idx);
-            ownerProf = e.materia.substring(idx + 2);
-          } else {
-            ownerMat = e.materia;
-            ownerProf = "";
-          }
-          break;
+      if (e) {
+        int idx = e->materia.indexOf("||");
+        if (idx >= 0) {
+          ownerMat = e->materia.substring(0, idx);
+          ownerProf = e->materia.substring(idx + 2);
+        } else {
+          ownerMat = e->materia;
+          ownerProf = "";
         }
       }
 
@@ -134,7 +127,7 @@ void handleSchedulesGrid() {
 }
 
 void handleSchedulesEditGrid() {
-  auto schedules = loadSchedules();
+  auto cells = scheduleTableGrid();
   String html = htmlHeader("Horarios - Editar (Global)");
   html += "<div class='card'><h2>Editar horarios (Global)</h2>";
   html += "<p class='small'>Seleccione una materia registrada para asignar al slot vacío, o elimine materias asignadas. La columna <b>Profesor</b> siempre está visible. Si una materia tiene varios profesores, deberá escoger uno; si tiene uno solo, se rellenará automáticamente.</p>";
@@ -155,10 +148,12 @@ void handleSchedulesEditGrid() {
       String day = DAYS[d];
       String start = String(h) + ":00";
       String end = String(h + 2) + ":00";
+      const ScheduleEntry *cell = cells[(size_t)d * SLOT_COUNT + s];
+      bool occupied = cell != nullptr;
       String cellOwner;
-      bool occupied = false;
-      for (auto &e : schedules) {
-        if (e.day == day && e.start == start) { occupied = true; cellOwner = e.materia; break; }
+      if (cell) {
+        cellOwner = cell->materia;
+        start = cell->start;   // se borra por el inicio real del horario
       }
 
       html += "<td style='min-width:170px;vertical-align:top;'>";
@@ -402,7 +397,7 @@ void handleSchedulesAddSlot() {
       return;
     }
     bool pairExists = false;
-    auto courses = loadCourses();
+    const auto &courses = loadCourses();
     for (auto &c : courses) if (c.materia == materia && c.profesor == profesor) { pairExists = true; break; }
     if (!pairExists) {
       server.send(400, "text/plain", "Curso (materia+profesor) no registrado"); return;
@@ -417,8 +412,8 @@ void handleSchedulesAddSlot() {
     return;
   }
 
-  String owner;
-  if (slotOccupiedSched(day, start, &owner)) {
+  if (!validSlotLocal(day, start, end)) { server.send(400, "text/plain", "Horario invalido (dia LUN..SAB, HH:MM inicio < fin)"); return; }
+  if (scheduleTableOverlap(day, start, end)) {
     server.sendHeader("Location", "/schedules?msg=ocupado");
     server.send(303, "text/plain", "Slot ocupado");
     return;
@@ -446,26 +441,14 @@ void handleSchedulesDel() {
   if (!f) { server.send(500, "text/plain", "no file"); return; }
 
   std::vector<String> lines;
-  String header = f.readStringUntil('\n');
-  lines.push_back(header);
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 4) {
-      String owner = c[0];
-      String dayc = c[1];
-      String startc = c[2];
-      if (dayc == day && startc == start) {
-        if (profesor.length() > 0) {
-          String key = mat + String("||") + profesor;
-          if (owner == key) continue;
-        } else {
-          if (owner == mat) continue;
-        }
-      }
+  CsvReader r(f);
+  lines.push_back(r.lineString());  // cabecera
+  String key = profesor.length() > 0 ? mat + String("||") + profesor : mat;
+  while (r.next()) {
+    if (r.size() >= 4 && r[SCHED_DAY].equals(day) && r[SCHED_START].equals(start)) {
+      if (r[SCHED_MATERIA].equals(key)) continue;
     }
-    lines.push_back(l);
+    lines.push_back(r.lineString());
   }
   f.close();
   writeAllLines(SCHEDULES_FILE, lines);
@@ -478,7 +461,7 @@ void handleSchedulesForMateriaGET() {
   String materia = server.arg("materia"); materia.trim();
   if (!courseExistsLocal(materia)) { server.send(404, "text/plain", "Materia no encontrada"); return; }
 
-  auto schedules = loadSchedules();
+  const auto &schedules = loadSchedules();
   String title = "Horarios - " + materia;
   String html = htmlHeader(title.c_str());
   html += "<div class='card'><h2>Horarios para: " + materia + "</h2>";
@@ -540,8 +523,8 @@ void handleSchedulesForMateriaAddPOST() {
   }
   if (!courseExistsLocal(materia)) { server.send(400, "text/plain", "Materia no registrada"); return; }
 
-  String owner;
-  if (slotOccupiedSched(day, start, &owner)) {
+  if (!validSlotLocal(day, start, end)) { server.send(400, "text/plain", "Horario invalido (dia LUN..SAB, HH:MM inicio < fin)"); return; }
+  if (scheduleTableOverlap(day, start, end)) {
     server.sendHeader("Location", "/schedules?msg=ocupado");
     server.send(303, "text/plain", "Slot ocupado");
     return;
@@ -561,11 +544,12 @@ void handleSchedulesForMateriaDelPOST() {
   String day = server.arg("day"); day.trim();
   String start = server.arg("start"); start.trim();
 
-  String owner;
-  if (!slotOccupiedSched(day, start, &owner)) {
+  const ScheduleEntry *e = scheduleTableStartingAt(day, start);
+  if (!e) {
     server.send(400, "text/plain", "El horario no existe");
     return;
   }
+  String owner = e->materia;
   bool allowed = false;
   if (owner == mat) allowed = true;
   int idx = owner.indexOf("||");
@@ -583,21 +567,11 @@ void handleSchedulesForMateriaDelPOST() {
   if (!f) { server.send(500, "text/plain", "no file"); return; }
 
   std::vector<String> lines;
-  String header = f.readStringUntil('\n');
-  lines.push_back(header);
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 4) {
-      String ownerc = c[0];
-      String dayc = c[1];
-      String startc = c[2];
-      if (dayc == day && startc == start) {
-        continue;
-      }
-    }
-    lines.push_back(l);
+  CsvReader r(f);
+  lines.push_back(r.lineString());  // cabecera
+  while (r.next()) {
+    if (r.size() >= 4 && r[SCHED_DAY].equals(day) && r[SCHED_START].equals(start)) continue;
+    lines.push_back(r.lineString());
   }
   f.close();
   writeAllLines(SCHEDULES_FILE, lines);
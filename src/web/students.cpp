@@ -9,6 +9,9 @@
 #include "globals.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "uid_index.h"
+#include "csv_reader.h"
+#include "row_log.h"
 
 // Pequeña función de escape HTML usada localmente
 static String htmlEscape(const String &s) {
@@ -76,12 +79,13 @@ void handleStudentsForMateria() {
     html += "<p>No hay alumnos registrados para esta materia.</p>";
   } else {
     html += "<table id='students_mat_table'><tr><th>Nombre</th><th>Cuenta</th><th>Registro</th><th>Acciones</th></tr>";
+    CsvFields c;
     for (auto &ln : users) {
-      auto c = parseQuotedCSVLine(ln);
-      String uid = (c.size() > 0 ? c[0] : "");
-      String name = (c.size() > 1 ? c[1] : "");
-      String acc = (c.size() > 2 ? c[2] : "");
-      String created = (c.size() > 4 ? c[4] : nowISO());
+      c.split(ln);
+      String uid = c.str(USERS_UID);
+      String name = c.str(USERS_NAME);
+      String acc = c.str(USERS_ACCOUNT);
+      String created = (c.size() > 4 ? c.str(USERS_CREATED) : nowISO());
 
       html += "<tr><td>" + name + "</td><td>" + acc + "</td><td>" + created + "</td>";
 
@@ -132,18 +136,19 @@ void handleStudentsAll() {
   File f = SPIFFS.open(USERS_FILE, FILE_READ);
   if (!f) { html += "<p>No hay archivo de usuarios.</p>"; html += htmlFooter(); server.send(200,"text/html",html); return; }
 
-  String header = f.readStringUntil('\n');
   struct SRec { String name; String acc; std::vector<String> mats; String created; String uid; };
   std::vector<String> uids;
   std::vector<SRec> recs;
 
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
+  CsvReader c(f);
+  while (c.next()) {
     if (c.size() >= 3) {
-      String uid = c[0]; String name = c[1]; String acc = c[2]; String mat = (c.size() > 3 ? c[3] : ""); String created = (c.size() > 4 ? c[4] : nowISO());
-      int idx=-1; for (int i=0;i<(int)uids.size();i++) if (uids[i]==uid) { idx=i; break; }
-      if (idx==-1) { uids.push_back(uid); SRec r; r.name=name; r.acc=acc; r.created = created; r.uid = uid; if (mat.length()) r.mats.push_back(mat); recs.push_back(r); }
+      String mat = c.str(USERS_MATERIA);
+      int idx=-1; for (int i=0;i<(int)uids.size();i++) if (c[USERS_UID].equals(uids[i])) { idx=i; break; }
+      if (idx==-1) {
+        String uid = c.str(USERS_UID);
+        uids.push_back(uid); SRec r; r.name=c.str(USERS_NAME); r.acc=c.str(USERS_ACCOUNT); r.created = (c.size() > 4 ? c.str(USERS_CREATED) : nowISO()); r.uid = uid; if (mat.length()) r.mats.push_back(mat); recs.push_back(r);
+      }
       else { if (mat.length()) recs[idx].mats.push_back(mat); }
     }
   }
@@ -217,54 +222,32 @@ void handleStudentRemoveCourse() {
   String return_to = server.hasArg("return_to") ? server.arg("return_to") : String();
   bool hideCapture = server.hasArg("hide_capture") && server.arg("hide_capture") == "1";
 
-  // Abrir archivo y leer todas las líneas (sin header)
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) { server.send(500,"text/plain","no file"); return; }
-
-  String header = f.readStringUntil('\n');
-  std::vector<String> origLines;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    origLines.push_back(l);
-  }
-  f.close();
-
-  // Contar cuántas líneas existen para este uid (puede haber varias - diferentes materias)
-  int uidCount = 0;
-  for (auto &l : origLines) {
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 1 && c[0] == uid) uidCount++;
-  }
+  // Filas del uid (puede haber varias - diferentes materias) con su offset, vía índice
+  std::vector<uint32_t> offs;
+  std::vector<String> rows = uidIndexUserRows(uid, &offs);
+  int uidCount = (int)rows.size();
 
   // Construir cadenas de comparación: materia simple y posible clave materia||profesor
   String match1 = materia;
   String match2 = "";
   if (profesor.length()) match2 = materia + String("||") + profesor;
 
-  std::vector<String> outLines;
-  outLines.push_back(header);
-
-  for (auto &l : origLines) {
-    auto c = parseQuotedCSVLine(l);
-    if (c.size() >= 4 && c[0] == uid && (c[3] == match1 || (match2.length() && c[3] == match2))) {
-      // Es la línea que vincula este uid con la materia que queremos quitar.
-      if (uidCount > 1) {
-        // hay otras líneas para el mismo uid -> ELIMINAR esta línea (quitar solo esa materia)
-        // (no push)
-        continue;
-      } else {
-        // es la única línea del uid -> conservamos el alumno pero dejamos el campo materia vacío
-        String created = (c.size() > 4 ? c[4] : "");
-        outLines.push_back("\"" + c[0] + "\"," + "\"" + c[1] + "\"," + "\"" + c[2] + "\"," + "\"\"" + "," + "\"" + created + "\"");
-        continue;
-      }
+  // Sin reescribir USERS_FILE: lápida (o lápida + fila nueva) sobre la fila afectada
+  CsvFields c;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    if (c.split(rows[i]) < 4 || !(c[USERS_MATERIA].equals(match1) || (match2.length() && c[USERS_MATERIA].equals(match2)))) continue;
+    // Es la línea que vincula este uid con la materia que queremos quitar.
+    if (uidCount > 1) {
+      // hay otras líneas para el mismo uid -> ELIMINAR esta línea (quitar solo esa materia)
+      rowLogDelete(USERS_FILE, offs[i], rows[i]);
+    } else {
+      // es la única línea del uid -> conservamos el alumno pero dejamos el campo materia vacío
+      String created = c.str(USERS_CREATED);
+      String line = "\"" + c.str(USERS_UID) + "\"," + "\"" + c.str(USERS_NAME) + "\"," + "\"" + c.str(USERS_ACCOUNT) + "\"," + "\"\"" + "," + "\"" + created + "\"";
+      rowLogUpdate(USERS_FILE, offs[i], rows[i], line);
     }
-    // linea no afectada -> preservar
-    outLines.push_back(l);
   }
 
-  writeAllLines(USERS_FILE, outLines);
-
   // construir redirect a la misma lista de estudiantes (preservando return_to, profesor y hide_capture)
   String redirect = String("/students?materia=") + urlEncode(materia);
   if (profesor.length()) redirect += "&profesor=" + urlEncode(profesor);
@@ -279,17 +262,10 @@ void handleStudentRemoveCourse() {
 void handleStudentDelete() {
   if (!server.hasArg("uid")) { server.send(400,"text/plain","faltan"); return; }
   String uid = server.arg("uid");
-  File f = SPIFFS.open(USERS_FILE, FILE_READ);
-  if (!f) { server.send(500,"text/plain","no file"); return; }
-  std::vector<String> lines; String header = f.readStringUntil('\n'); lines.push_back(header);
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size()>=1 && c[0]==uid) continue;
-    lines.push_back(l);
-  }
-  f.close();
-  writeAllLines(USERS_FILE, lines);
+  // una lápida por cada fila del uid (offsets del índice, sin recorrer USERS_FILE)
+  std::vector<uint32_t> offs;
+  std::vector<String> rows = uidIndexUserRows(uid, &offs);
+  for (size_t i = 0; i < rows.size(); ++i) rowLogDelete(USERS_FILE, offs[i], rows[i]);
   server.sendHeader("Location","/students_all");
   server.send(303,"text/plain","Deleted");
 }
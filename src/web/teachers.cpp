@@ -9,6 +9,9 @@
 #include "globals.h"
 #include "web_common.h"
 #include "files_utils.h"
+#include "csv_reader.h"
+#include "uid_index.h"
+#include "row_log.h"
 
 // Pequeña función de escape HTML
 static String htmlEscape(const String &s) {
@@ -55,7 +58,7 @@ struct MetaRec {
 
 static std::vector<String> profsFromCoursesForMateria(const String &materia) {
   std::vector<String> out;
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     if (c.materia == materia) {
       bool found = false;
@@ -76,10 +79,10 @@ static std::vector<String> getProfessorsForMateriaCombined(const String &materia
     if (!f) out.push_back(p);
   }
   auto fromFile = teachersForMateriaFile(materia); // usa la función centralizada
+  CsvFields c;
   for (auto &ln : fromFile) {
-    auto c = parseQuotedCSVLine(ln);
-    if (c.size() >= 2) {
-      String name = c[1];
+    if (c.split(ln) >= 2) {
+      String name = c.str(USERS_NAME);
       bool f = false;
       for (auto &x : out) if (x == name) { f = true; break; }
       if (!f) out.push_back(name);
@@ -93,17 +96,14 @@ static std::vector<MetaRec> buildTeacherMetaList() {
   std::vector<MetaRec> out;
   File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
   if (!f) return out;
-  String header = f.readStringUntil('\n'); (void)header;
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim();
-    if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
+  CsvReader c(f);
+  while (c.next()) {
     if (c.size() >= 2) {
       MetaRec r;
-      r.uid = (c.size() > 0 ? c[0] : "");
-      r.name = (c.size() > 1 ? c[1] : "");
-      r.acc = (c.size() > 2 ? c[2] : "-");
-      r.created = (c.size() > 4 ? c[4] : nowISO());
+      r.uid = c.str(USERS_UID);
+      r.name = c.str(USERS_NAME);
+      r.acc = (c.size() > 2 ? c.str(USERS_ACCOUNT) : String("-"));
+      r.created = (c.size() > 4 ? c.str(USERS_CREATED) : nowISO());
       out.push_back(r);
     }
   }
@@ -190,7 +190,7 @@ void handleTeachersAll() {
   std::vector<MetaRec> recs = buildTeacherMetaList();
 
   // Ensure any professors in courses that are not in recs get added
-  auto courses = loadCourses();
+  const auto &courses = loadCourses();
   for (auto &c : courses) {
     bool found = false;
     for (auto &r : recs) {
@@ -216,19 +216,14 @@ void handleTeachersAll() {
           std::vector<String> mats;
           File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
           if (f) {
-            String header = f.readStringUntil('\n'); (void)header;
-            while (f.available()) {
-              String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-              auto c = parseQuotedCSVLine(l);
+            CsvReader c(f);
+            while (c.next()) {
               if (c.size() >= 4) {
-                String rowUid = c[0];
-                String name = (c.size() > 1 ? c[1] : "");
-                String mat  = (c.size() > 3 ? c[3] : "");
-                if (rowUid == r.uid || name == r.name) {
-                  if (mat.length()) {
+                if (c[USERS_UID].equals(r.uid) || c[USERS_NAME].equals(r.name)) {
+                  if (!c[USERS_MATERIA].empty()) {
                     bool fnd = false;
-                    for (auto &m : mats) if (m == mat) { fnd = true; break; }
-                    if (!fnd) mats.push_back(mat);
+                    for (auto &m : mats) if (c[USERS_MATERIA].equals(m)) { fnd = true; break; }
+                    if (!fnd) mats.push_back(c.str(USERS_MATERIA));
                   }
                 }
               }
@@ -270,20 +265,15 @@ void handleTeachersAll() {
         // from TEACHERS_FILE rows
         File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
         if (f) {
-          String header = f.readStringUntil('\n'); (void)header;
-          while (f.available()) {
-            String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-            auto c = parseQuotedCSVLine(l);
+          CsvReader c(f);
+          while (c.next()) {
             if (c.size() >= 4) {
-              String uid = c[0];
-              String name = (c.size() > 1 ? c[1] : "");
-              String mat  = (c.size() > 3 ? c[3] : "");
               // match by uid if available, otherwise by name
-              if ((r.uid.length() && uid == r.uid) || (r.uid.length()==0 && name == r.name)) {
-                if (mat.length()) {
+              if ((r.uid.length() && c[USERS_UID].equals(r.uid)) || (r.uid.length()==0 && c[USERS_NAME].equals(r.name))) {
+                if (!c[USERS_MATERIA].empty()) {
                   bool fnd = false;
-                  for (auto &m : mats) if (m == mat) { fnd = true; break; }
-                  if (!fnd) mats.push_back(mat);
+                  for (auto &m : mats) if (c[USERS_MATERIA].equals(m)) { fnd = true; break; }
+                  if (!fnd) mats.push_back(c.str(USERS_MATERIA));
                 }
               }
             }
@@ -335,21 +325,13 @@ void handleTeachersAll() {
 void handleTeacherRemoveCourse() {
   if (!server.hasArg("uid") || !server.hasArg("materia")) { server.send(400,"text/plain","faltan"); return; }
   String uid = server.arg("uid"); String materia = server.arg("materia");
-  File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (!f) { server.send(500,"text/plain","no file"); return; }
-  std::vector<String> lines; String header = f.readStringUntil('\n'); lines.push_back(header);
-  while (f.available()) {
-    String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-    auto c = parseQuotedCSVLine(l);
-    if (c.size()>=4) {
-      String rowUid = c[0];
-      String rowMat = c[3];
-      if (rowUid == uid && rowMat == materia) continue;
-    }
-    lines.push_back(l);
+  // lápida sobre las filas uid+materia (offsets del índice, sin reescribir TEACHERS_FILE)
+  std::vector<uint32_t> offs;
+  std::vector<String> rows = uidIndexTeacherRows(uid, &offs);
+  CsvFields c;
+  for (size_t i = 0; i < rows.size(); ++i) {
+    if (c.split(rows[i]) >= 4 && c[USERS_MATERIA].equals(materia)) rowLogDelete(TEACHERS_FILE, offs[i], rows[i]);
   }
-  f.close();
-  writeAllLines(TEACHERS_FILE, lines);
   server.sendHeader("Location","/teachers?materia=" + urlEncodeLocal(materia));
   server.send(303,"text/plain","Removed");
 }
@@ -360,19 +342,10 @@ void handleTeacherDelete() {
 
   // 1) Find teacher name (if any) and collect materias taught by that teacher (from courses)
   String teacherName = "";
-  File ft = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  if (ft) {
-    String header = ft.readStringUntil('\n'); (void)header;
-    while (ft.available()) {
-      String l = ft.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 2 && c[0] == uid) {
-        teacherName = c[1];
-        break;
-      }
-    }
-    ft.close();
+  String trow = findTeacherByUID(uid);
+  if (trow.length()) {
+    CsvFields c;
+    if (c.split(trow) >= 2) teacherName = c.str(USERS_NAME);
   }
 
   // Build list of materias that will be removed because professor==teacherName
@@ -386,23 +359,10 @@ void handleTeacherDelete() {
     }
   }
 
-  // 2) Remove TEACHERS_FILE rows with that uid
-  File f = SPIFFS.open(TEACHERS_FILE, FILE_READ);
-  std::vector<String> newTeacherLines;
-  if (f) {
-    String header = f.readStringUntil('\n'); newTeacherLines.push_back(header);
-    while (f.available()) {
-      String l = f.readStringUntil('\n'); l.trim(); if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 1) {
-        String rowUid = c[0];
-        if (rowUid == uid) continue; // skip this teacher
-      }
-      newTeacherLines.push_back(l);
-    }
-    f.close();
-    writeAllLines(TEACHERS_FILE, newTeacherLines);
-  }
+  // 2) Remove TEACHERS_FILE rows with that uid (lápidas; offsets del índice)
+  std::vector<uint32_t> toffs;
+  std::vector<String> trows = uidIndexTeacherRows(uid, &toffs);
+  for (size_t i = 0; i < trows.size(); ++i) rowLogDelete(TEACHERS_FILE, toffs[i], trows[i]);
 
   // 3) Remove courses where profesor == teacherName
   if (teacherName.length()) {
@@ -418,13 +378,11 @@ void handleTeacherDelete() {
   File fs = SPIFFS.open(SCHEDULES_FILE, FILE_READ);
   std::vector<String> slines;
   if (fs) {
-    String header = fs.readStringUntil('\n'); slines.push_back(header);
-    while (fs.available()) {
-      String l = fs.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String owner = c[0];
+    CsvReader r(fs);
+    slines.push_back(r.lineString());  // cabecera
+    while (r.next()) {
+      if (r.size() >= 4) {
+        String owner = r.str(SCHED_MATERIA);
         bool skip = false;
         for (auto &m : materiasToRemove) {
           String key = m + String("||") + teacherName;
@@ -433,48 +391,45 @@ void handleTeacherDelete() {
         if (skip) continue;
         for (auto &m : materiasToRemove) {
           bool still = false;
-          auto remCourses = loadCourses();
+          const auto &remCourses = loadCourses();
           for (auto &rc : remCourses) if (rc.materia == m) { still = true; break; }
           if (!still && owner == m) { skip = true; break; }
         }
         if (skip) continue;
       }
-      slines.push_back(l);
+      slines.push_back(r.lineString());
     }
     fs.close();
     writeAllLines(SCHEDULES_FILE, slines);
   }
 
   // 5) Clean USERS_FILE: if a materia got fully removed (no courses remain for it), remove users with that materia
+  //    (se juntan las filas y se marcan con lápida al cerrar el lector)
   File fu = SPIFFS.open(USERS_FILE, FILE_READ);
-  std::vector<String> ulines;
+  std::vector<std::pair<uint32_t, String>> deadUsers;
   if (fu) {
-    String uheader = fu.readStringUntil('\n'); ulines.push_back(uheader);
-    while (fu.available()) {
-      String l = fu.readStringUntil('\n'); l.trim();
-      if (!l.length()) continue;
-      auto c = parseQuotedCSVLine(l);
-      if (c.size() >= 4) {
-        String uid_u = c[0], name = c[1], acc = c[2], mm = c[3];
+    CsvReader r(fu);
+    while (r.next()) {
+      if (r.size() >= 4) {
+        String mm = r.str(USERS_MATERIA);
         bool removeUser = false;
         for (auto &m : materiasToRemove) {
           if (mm == m) {
             bool still = false;
-            auto remCourses = loadCourses();
+            const auto &remCourses = loadCourses();
             for (auto &rc : remCourses) if (rc.materia == m) { still = true; break; }
             if (!still) removeUser = true;
             break;
           }
         }
         if (removeUser) {
-          addNotification(uid_u, name, acc, String("Cuenta eliminada: materia removida al borrar maestro ") + teacherName);
-          continue; // skip this user row
+          addNotification(r.str(USERS_UID), r.str(USERS_NAME), r.str(USERS_ACCOUNT), String("Cuenta eliminada: materia removida al borrar maestro ") + teacherName);
+          deadUsers.push_back(std::make_pair(r.offset(), r.lineString()));
         }
-        ulines.push_back("\"" + uid_u + "\"," + "\"" + name + "\"," + "\"" + acc + "\"," + "\"" + mm + "\"," + "\"" + (c.size()>4?c[4]:"") + "\"");
-      } else ulines.push_back(l);
+      }
     }
     fu.close();
-    writeAllLines(USERS_FILE, ulines);
+    for (auto &d : deadUsers) rowLogDelete(USERS_FILE, d.first, d.second);
   }
 
   server.sendHeader("Location","/teachers_all");
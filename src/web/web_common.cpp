@@ -6,71 +6,28 @@
 #include "web_common.h"
 #include "globals.h"
 #include "config.h"
-#include "files_utils.h"   // necesario para parseQuotedCSVLine()
+#include "files_utils.h"
+#include "csv_reader.h"
+#include "uid_index.h"
+#include "log_writer.h"
+#include "att_store.h"
+#include "att_rollup.h"
+#include "row_log.h"
+#include "catalog.h"
+#include "notif_store.h"
+#include "schedule_table.h"
+#include "access_table.h"
+#include "door.h"
+#include "rfid_reader.h"
+#include "rfid_handler.h"
+#include "card_journal.h"
+#include "latency_stats.h"
+#include "boot_info.h"
 #include <vector>
 
-// Helper local: construye la misma key que notifications.cpp (ts|uid|nota-truncada)
-static String _makeNotifKeyLocal(const String &ts, const String &uid, const String &note) {
-  String k = ts + "|" + uid;
-  String frag = note;
-  if (frag.length() > 80) frag = frag.substring(0, 80);
-  frag.replace("\n", " ");
-  frag.replace("\r", " ");
-  k += "|" + frag;
-  return k;
-}
-
-// Cuenta solo las notificaciones NO LEÍDAS (buscando coincidencias con /.notif_read)
+// Cuenta solo las notificaciones NO LEÍDAS (contadores de notif_store.h, sin leer archivos)
 int unreadNotifCount() {
-  const char *readFile = "/.notif_read";
-  if (!SPIFFS.exists(NOTIF_FILE)) return 0;
-
-  // 1) leer notificaciones y construir keys
-  std::vector<String> notifKeys;
-  File f = SPIFFS.open(NOTIF_FILE, FILE_READ);
-  if (!f) return 0;
-  bool firstLine = true;
-  while (f.available()) {
-    String l = f.readStringUntil('\n');
-    if (firstLine) { firstLine = false; continue; } // saltar header
-    l.trim();
-    if (!l.length()) continue;
-    auto cols = parseQuotedCSVLine(l);
-    String ts = (cols.size()>0?cols[0]:"");
-    String uid = (cols.size()>1?cols[1]:"");
-    String note = (cols.size()>4?cols[4]:"");
-    String key = _makeNotifKeyLocal(ts, uid, note);
-    notifKeys.push_back(key);
-  }
-  f.close();
-
-  int total = (int)notifKeys.size();
-  if (total == 0) return 0;
-
-  // 2) si no existe archivo de leídos, todo es no-leído
-  if (!SPIFFS.exists(readFile)) return total;
-
-  // 3) leer claves leídas
-  File rf = SPIFFS.open(readFile, FILE_READ);
-  if (!rf) return total;
-  std::vector<String> readKeys;
-  while (rf.available()) {
-    String l = rf.readStringUntil('\n'); l.trim();
-    if (l.length()) readKeys.push_back(l);
-  }
-  rf.close();
-
-  // 4) contar coincidencias (leídas)
-  int matched = 0;
-  for (auto &k : notifKeys) {
-    for (auto &rk : readKeys) {
-      if (k == rk) { matched++; break; }
-    }
-  }
-
-  int unread = total - matched;
-  if (unread < 0) unread = 0;
-  return unread;
+  return notifStoreUnreadCount();
 }
 
 // ==================== CABECERA HTML GLOBAL ====================
@@ -736,6 +693,19 @@ void handleRoot() {
   server.send(200,"text/html",html);
 }
 
+// ==================== LATENCIA POR ETAPA ====================
+// Histogramas desde el arranque (latency_stats.h), en µs; texto plano para
+// comparar entre versiones.
+void handleLatency() {
+  String out = "etapa,muestras,p50_us,p95_us,p99_us,max_us\n";
+  for (int i = 0; i < LAT_STAGES; ++i) {
+    LatSummary l = latencySummary((LatStage)i);
+    out += String(latencyStageName((LatStage)i)) + "," + String(l.count) + "," + String(l.p50) + "," +
+           String(l.p95) + "," + String(l.p99) + "," + String(l.max) + "\n";
+  }
+  server.send(200, "text/plain", out);
+}
+
 // ==================== ESTADO DEL DISPOSITIVO ====================
 // Muestra información básica del ESP32: IP, uptime, memoria y conteo de usuarios.
 void handleStatus() {
@@ -753,11 +723,27 @@ void handleStatus() {
   File fu = SPIFFS.open(USERS_FILE, FILE_READ);
   int usersCount = 0;
   if (fu) {
-    fu.readStringUntil('\n');
-    while (fu.available()) { String l = fu.readStringUntil('\n'); l.trim(); if (l.length()) usersCount++; }
+    CsvReader r(fu);
+    while (r.next()) usersCount++;
     fu.close();
   }
   html += "<p><b>Usuarios registrados:</b> " + String(usersCount) + "</p>";
+  html += "<p><b>Registros (attendance/denied/notif):</b> " + String(logWriterRecordCount()) + " en " + String(logWriterFlushCount()) + " escrituras, " + String((unsigned)logWriterPending()) + " pendientes, " + String(logWriterDropped()) + " descartados</p>";
+  html += "<p><b>Historial:</b> " + String(attRecordCount()) + " registros en " + String((unsigned)attSegments().size()) + " días</p>";
+  html += "<p><b>Resumen de asistencia:</b> " + String((unsigned)attRollupRows()) + " filas día/materia, " + String((unsigned)attRollupUids()) + " UIDs</p>";
+  html += "<p><b>Índice UID:</b> " + String((unsigned)uidIndexRowCount()) + " filas, " + String((unsigned)uidIndexRamBytes()) + " bytes RAM</p>";
+  html += "<p><b>Filas borradas:</b> " + String((unsigned)rowLogDeadCount()) + " pendientes de compactar (" + String((unsigned)rowLogCompactions()) + " compactaciones)</p>";
+  html += "<p><b>Catálogo:</b> " + String((unsigned)catalogSize()) + " materias/profesores/cursos con ID</p>";
+  html += "<p><b>Lector RFID:</b> " + String((unsigned)rfidReaderReads()) + " lecturas, " + String((unsigned)rfidReaderDrops()) + " descartadas, cola máx. " + String((unsigned)rfidReaderMaxDepth()) + "; " + String((unsigned)rfidRepeatTaps()) + " pasadas repetidas sin registro, " + String((unsigned)rfidNoClockDecisions()) + " decididas sin hora</p>";
+  html += "<p><b>Diario de lecturas (RTC):</b> " + String((unsigned)cardJournalPending()) + " sin confirmar en flash, " + String((unsigned)cardJournalReplayed()) + " recuperadas al arrancar, " + String((unsigned)cardJournalDrops()) + " descartadas (lleno)</p>";
+  LatSummary lt = latencySummary(LAT_TOTAL), ld = latencySummary(LAT_DECIDE), lf = latencySummary(LAT_FLUSH);
+  html += "<p><b>Latencia por tarjeta:</b> lectura→pantalla p50 " + String(lt.p50) + " / p95 " + String(lt.p95) + " / p99 " + String(lt.p99) + " µs (máx " + String(lt.max) + ", " + String(lt.count) + " lecturas); decisión p95 " + String(ld.p95) + " µs; escritura flash p95 " + String(lf.p95) + " µs <a href='/latency'>por etapa</a></p>";
+  auto bootMs = [](uint32_t ms) { return ms ? String(ms) + " ms" : String("pendiente"); };
+  html += "<p><b>Arranque:</b> acceso listo " + bootMs(bootAccessReadyMs()) + ", red y servidor " + bootMs(bootNetReadyMs()) + ", hora " + bootMs(bootTimeSyncedMs()) + ", primera tarjeta " + bootMs(bootFirstTapMs()) + "</p>";
+  html += "<p><b>Puerta:</b> " + String(doorStateName()) + " (" + String(doorOpenCycles()) + " aperturas, " + String(doorRetriggers()) + " accesos dentro de una apertura)</p>";
+  html += "<p><b>Tabla de acceso:</b> " + String((unsigned)accessTableSize()) + " UIDs, " + String((unsigned)accessTableRamBytes()) + " bytes RAM</p>";
+  html += "<p><b>Horario compilado:</b> " + String((unsigned)scheduleTableSpans()) + " tramos en la semana</p>";
+  html += "<p><b>Notificaciones:</b> " + String(notifStoreLiveCount()) + " (" + String(notifStoreUnreadCount()) + " no leídas, leídas en " + String((unsigned)notifStoreRangeCount()) + " rangos)</p>";
   html += "<div style='margin-top:10px'><a class='btn btn-blue' href='/users.csv'>Descargar Usuarios</a> "
           "<a class='btn btn-blue' href='/'>Volver</a></div></div>";
   html += htmlFooter();
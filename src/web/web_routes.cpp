@@ -18,6 +18,9 @@
 #include "self_register.h"  // declara handlers para self-registration
 #include "teachers.h"       // handlers para maestros
 #include "edit.h"           // si no existiera, quítalo o crea el header correspondiente
+#include "log_writer.h"     // logWriterSync() antes de descargar CSV de registros
+#include "att_store.h"      // segmentos diarios de attendance
+#include "csv_reader.h"     // descargas sin las filas borradas (lápidas de row_log)
 // Nota: no incluimos aquí capture_lote.h ni registramos rutas capture_lote_*
 // a menos que tengas implementado ese módulo completo (header + .cpp).
 
@@ -36,6 +39,28 @@ void handleNotificationsMarkPOST();
 
 // El endpoint que devuelve profesores por materia debe existir en courses.cpp
 void handleProfesoresForMateriaGET();
+
+// Descarga de un CSV con lápidas (row_log.h): CsvReader salta las filas
+// borradas o reemplazadas que siguen en el archivo hasta la compactación, así
+// que se envía cabecera + filas vivas, en trozos.
+static void streamLiveCsv(const char *path, const char *missing) {
+  if (!SPIFFS.exists(path)) { server.send(404, "text/plain", missing); return; }
+  File f = SPIFFS.open(path, FILE_READ);
+  if (!f) { server.send(500, "text/plain", "ERR open"); return; }
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  CsvReader r(f);
+  server.send(200, "text/csv", r.lineString() + "\r\n");   // cabecera
+  String chunk;
+  chunk.reserve(600);
+  while (r.next()) {
+    chunk += r.lineString();
+    chunk += "\r\n";
+    if (chunk.length() >= 512) { server.sendContent(chunk); chunk = ""; }
+  }
+  f.close();
+  if (chunk.length()) server.sendContent(chunk);
+  server.sendContent("");
+}
 // ------------------------------------------------------------------------------
 
 void registerRoutes() {
@@ -145,6 +170,7 @@ void registerRoutes() {
   server.on("/capture_edit_post", HTTP_POST, handleCaptureEditPost);
 
   server.on("/status", handleStatus);
+  server.on("/latency", HTTP_GET, handleLatency);
 
   server.on("/schedules", HTTP_GET, handleSchedulesGrid);
   server.on("/schedules/edit", HTTP_GET, handleSchedulesEditGrid);
@@ -172,29 +198,43 @@ void registerRoutes() {
   server.on("/self_register_cancel", HTTP_POST, handleSelfRegisterCancelPOST);
 
   // CSV endpoints (descarga directa)
-  server.on("/users.csv", [](){
-    if (!SPIFFS.exists(USERS_FILE)) { server.send(404,"text/plain","No users"); return; }
-    File f = SPIFFS.open(USERS_FILE, FILE_READ); server.streamFile(f, "text/csv"); f.close();
-  });
+  server.on("/users.csv", [](){ streamLiveCsv(USERS_FILE, "No users"); });
 
+  // attendance: una cabecera + el cuerpo de cada segmento diario, en trozos
   server.on("/attendance.csv", [](){
-    if (!SPIFFS.exists(ATT_FILE)) { server.send(404,"text/plain","no att"); return; }
-    File f = SPIFFS.open(ATT_FILE, FILE_READ); server.streamFile(f,"text/csv"); f.close();
+    logWriterSync();
+    if (attSegments().empty()) { server.send(404,"text/plain","no att"); return; }
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "text/csv", "\"timestamp\",\"uid\",\"name\",\"account\",\"materia\",\"mode\"\r\n");
+    char buf[512];
+    for (auto &seg : attSegments()) {
+      File f = SPIFFS.open(attSegmentPath(seg.day), FILE_READ);
+      if (!f) continue;
+      while (f.available()) {     // saltar la cabecera del segmento
+        int ch = f.read();
+        if (ch < 0 || ch == '\n') break;
+      }
+      while (f.available()) {
+        size_t n = f.read((uint8_t*)buf, sizeof(buf));
+        if (n == 0) break;
+        server.sendContent(buf, n);
+      }
+      f.close();
+    }
+    server.sendContent("");
   });
 
   server.on("/notifications.csv", [](){
-    if (!SPIFFS.exists(NOTIF_FILE)) { server.send(404,"text/plain","no"); return; }
-    File f = SPIFFS.open(NOTIF_FILE, FILE_READ); server.streamFile(f,"text/csv"); f.close();
+    logWriterSync();
+    streamLiveCsv(NOTIF_FILE, "no");
   });
 
   // Teachers CSV
-  server.on("/teachers.csv", [](){
-    if (!SPIFFS.exists(TEACHERS_FILE)) { server.send(404,"text/plain","No teachers"); return; }
-    File f = SPIFFS.open(TEACHERS_FILE, FILE_READ); server.streamFile(f, "text/csv"); f.close();
-  });
+  server.on("/teachers.csv", [](){ streamLiveCsv(TEACHERS_FILE, "No teachers"); });
 
   server.on("/history", handleHistoryPage);
   server.on("/history.csv", handleHistoryCSV);
   server.on("/history_clear", HTTP_POST, handleHistoryClearPOST);
   server.on("/materia_history", handleMateriaHistoryGET);
+  server.on("/history_rollup_rebuild", HTTP_POST, handleHistoryRollupRebuildPOST);
 }